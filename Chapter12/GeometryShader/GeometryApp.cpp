@@ -164,18 +164,7 @@ void GeometryApp::UpdateWaves(const Timer& gt)
 	mWaves->Update(gt.GetDeltaTime());
 
 	auto currWavesVB = mFrameWaves[mCurrFrameResourceIndex].get();
-	for (int i = 0; i < mWaves->VertexCount(); ++i)
-	{
-		Vertex v;
-
-		v.Pos = mWaves->Position(i);
-		v.Normal = mWaves->Normal(i);
-
-		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
-		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
-
-		currWavesVB->WavesVB->CopyData(i, v);
-	}
+	currWavesVB->WavesVersion = mWaves->StreamVertices(currWavesVB->WavesVB->MappedData(), currWavesVB->WavesVersion);
 
 	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->WavesVB->Resource();
 }
@@ -30,41 +30,16 @@ float MathHelper::AngleFromXY(float x, float y)
 
 XMVECTOR MathHelper::RandUnitVec3()
 {
-	XMVECTOR One = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
-
-	while (true)
-	{
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
-
-		if (XMVector3Greater(XMVector3LengthSq(v), One))
-		{
-			continue;
-		}
-
-		return XMVector3Normalize(v);
-	}
+	return Random::ThreadLocal().NextUnitVec3();
 }
 
 XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
 {
-	XMVECTOR One = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
-
-	while (true)
+	// Mirroring the lower half onto the upper one keeps the distribution uniform.
+	XMVECTOR v = RandUnitVec3();
+	if (XMVector3Less(XMVector3Dot(n, v), XMVectorZero()))
 	{
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
-
-		if (XMVector3Greater(XMVector3LengthSq(v), One))
-		{
-			continue;
-		}
-
-		if (XMVector3Less(XMVector3Dot(n, v), Zero))
-		{
-			continue;
-		}
-
-		return XMVector3Normalize(v);
+		v = XMVectorNegate(v);
 	}
+	return v;
 }
\ No newline at end of file
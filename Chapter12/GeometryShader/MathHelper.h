@@ -3,26 +3,29 @@
 #include <Windows.h>
 #include <DirectXMath.h>
 #include <cstdint>
+#include "Random.h"
 
 using namespace DirectX;
 
 class MathHelper
 {
 public:
+	// The Rand functions draw from the calling thread's generator, see Random::ThreadLocal.
 	static float RandF()
 	{
-		return (float)(rand()) / (float)RAND_MAX;
+		return Random::ThreadLocal().NextFloat();
 	}
 
 	// [a, b)
 	static float RandF(float a, float b)
 	{
-		return a + RandF() * (b - a);
+		return Random::ThreadLocal().NextFloat(a, b);
 	}
 
+	// [a, b]
 	static int Rand(int a, int b)
 	{
-		return a + rand() % ((b - a) + 1);
+		return Random::ThreadLocal().NextInt(a, b);
 	}
 
 	template<typename T>
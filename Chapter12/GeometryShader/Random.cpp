@@ -0,0 +1,227 @@
+#include "Random.h"
+#include <atomic>
+
+using namespace std;
+
+namespace
+{
+	atomic<uint64_t> gSeed(Random::DefaultSeed);
+	atomic<uint64_t> gNextStream(0);
+	atomic<uint32_t> gGeneration(0);
+
+	uint64_t SplitMix64(uint64_t& state)
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	template<int K>
+	__m128i Rotl(__m128i x)
+	{
+		return _mm_or_si128(_mm_slli_epi32(x, K), _mm_srli_epi32(x, 32 - K));
+	}
+
+	// The top 24 bits as a float in [0, 1).
+	XMVECTOR ToUnitFloat(__m128i bits)
+	{
+		return XMVectorScale(_mm_cvtepi32_ps(_mm_srli_epi32(bits, 8)), 1.0f / 16777216.0f);
+	}
+
+	float ToUnitFloat(uint32_t bits)
+	{
+		return (float)(bits >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// High half of bits * range: an integer in [0, range) without a division.
+	__m128i ScaleToRange(__m128i bits, __m128i range)
+	{
+		__m128i even = _mm_srli_epi64(_mm_mul_epu32(bits, range), 32);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(bits, 32), range);
+		return _mm_or_si128(even, _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+	}
+
+	// z uniform in (-1, 1] and an angle around it give a uniform point on the sphere.
+	void UnitVec3(XMVECTOR u, XMVECTOR v, XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+	{
+		z = XMVectorNegativeMultiplySubtract(u, XMVectorReplicate(2.0f), XMVectorReplicate(1.0f));
+		XMVECTOR r = XMVectorSqrt(XMVectorMax(XMVectorNegativeMultiplySubtract(z, z, XMVectorReplicate(1.0f)), XMVectorZero()));
+
+		XMVECTOR sinPhi, cosPhi;
+		XMVectorSinCos(&sinPhi, &cosPhi, XMVectorScale(v, XM_2PI));
+		x = XMVectorMultiply(r, cosPhi);
+		y = XMVectorMultiply(r, sinPhi);
+	}
+}
+
+Random::Random(uint64_t seed, uint64_t stream)
+{
+	Seed(seed, stream);
+}
+
+void Random::Seed(uint64_t seed, uint64_t stream)
+{
+	// Streams start from unrelated points of the SplitMix64 sequence rather than neighbouring ones.
+	uint64_t streamState = stream;
+	uint64_t state = seed ^ SplitMix64(streamState);
+
+	alignas(16) uint32_t words[4][4];
+	for (int i = 0; i < 16; i += 2)
+	{
+		uint64_t z = SplitMix64(state);
+		words[i / 4][i % 4] = (uint32_t)z;
+		words[i / 4][i % 4 + 1] = (uint32_t)(z >> 32);
+	}
+
+	for (int i = 0; i < 4; ++i)
+	{
+		mState[i] = _mm_load_si128((const __m128i*)words[i]);
+	}
+	mCursor = 4;
+}
+
+__m128i Random::Step()
+{
+	__m128i s1 = mState[1];
+
+	// rotl(s1 * 5, 7) * 9, with the multiplications as shifts and adds.
+	__m128i result = Rotl<7>(_mm_add_epi32(_mm_slli_epi32(s1, 2), s1));
+	result = _mm_add_epi32(_mm_slli_epi32(result, 3), result);
+
+	__m128i t = _mm_slli_epi32(s1, 9);
+	mState[2] = _mm_xor_si128(mState[2], mState[0]);
+	mState[3] = _mm_xor_si128(mState[3], mState[1]);
+	mState[1] = _mm_xor_si128(mState[1], mState[2]);
+	mState[0] = _mm_xor_si128(mState[0], mState[3]);
+	mState[2] = _mm_xor_si128(mState[2], t);
+	mState[3] = Rotl<11>(mState[3]);
+
+	return result;
+}
+
+uint32_t Random::NextUInt()
+{
+	if (mCursor == 4)
+	{
+		_mm_storeu_si128((__m128i*)mBuffer, Step());
+		mCursor = 0;
+	}
+	return mBuffer[mCursor++];
+}
+
+float Random::NextFloat()
+{
+	return ToUnitFloat(NextUInt());
+}
+
+float Random::NextFloat(float a, float b)
+{
+	return a + NextFloat() * (b - a);
+}
+
+int Random::NextInt(int a, int b)
+{
+	uint32_t range = (uint32_t)(b - a) + 1;
+	return a + (int)(((uint64_t)NextUInt() * range) >> 32);
+}
+
+XMVECTOR Random::NextUnitVec3()
+{
+	float u = NextFloat();
+	float v = NextFloat();
+
+	XMVECTOR x, y, z;
+	UnitVec3(XMVectorReplicate(u), XMVectorReplicate(v), x, y, z);
+	return XMVectorSet(XMVectorGetX(x), XMVectorGetX(y), XMVectorGetX(z), 0.0f);
+}
+
+void Random::Fill(uint32_t* values, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_si128((__m128i*)(values + i), Step());
+	}
+	for (; i < count; ++i)
+	{
+		values[i] = NextUInt();
+	}
+}
+
+void Random::FillFloat(float* values, size_t count, float a, float b)
+{
+	XMVECTOR offset = XMVectorReplicate(a);
+	XMVECTOR scale = XMVectorReplicate(b - a);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(values + i, XMVectorMultiplyAdd(ToUnitFloat(Step()), scale, offset));
+	}
+	for (; i < count; ++i)
+	{
+		values[i] = NextFloat(a, b);
+	}
+}
+
+void Random::FillInt(int* values, size_t count, int a, int b)
+{
+	__m128i offset = _mm_set1_epi32(a);
+	__m128i range = _mm_set1_epi32((int)((uint32_t)(b - a) + 1));
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_si128((__m128i*)(values + i), _mm_add_epi32(ScaleToRange(Step(), range), offset));
+	}
+	for (; i < count; ++i)
+	{
+		values[i] = NextInt(a, b);
+	}
+}
+
+void Random::FillUnitVec3(XMFLOAT3* values, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		XMVECTOR u = ToUnitFloat(Step());
+		XMVECTOR v = ToUnitFloat(Step());
+
+		XMVECTOR x, y, z;
+		UnitVec3(u, v, x, y, z);
+
+		XMVECTOR w = XMVectorZero();
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		XMStoreFloat3(&values[i], x);
+		XMStoreFloat3(&values[i + 1], y);
+		XMStoreFloat3(&values[i + 2], z);
+		XMStoreFloat3(&values[i + 3], w);
+	}
+	for (; i < count; ++i)
+	{
+		XMStoreFloat3(&values[i], NextUnitVec3());
+	}
+}
+
+Random& Random::ThreadLocal()
+{
+	thread_local Random random;
+	thread_local uint32_t generation = ~0u;
+
+	uint32_t current = gGeneration.load();
+	if (generation != current)
+	{
+		generation = current;
+		random.Seed(gSeed.load(), gNextStream++);
+	}
+	return random;
+}
+
+void Random::SetSeed(uint64_t seed)
+{
+	gSeed = seed;
+	gNextStream = 0;
+	++gGeneration;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <emmintrin.h>
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+// xoshiro128** run as four independent generators, one per SSE lane. Every step yields four
+// numbers, which the scalar calls hand out one at a time and the fills store directly. The state
+// is derived from a seed and a stream number only, so equal seeds replay equal sequences.
+class Random
+{
+public:
+	static const uint64_t DefaultSeed = 0x853c49e6748fea9bull;
+
+	explicit Random(uint64_t seed = DefaultSeed, uint64_t stream = 0);
+
+	void Seed(uint64_t seed, uint64_t stream = 0);
+
+	uint32_t NextUInt();
+
+	// [0, 1)
+	float NextFloat();
+
+	// [a, b)
+	float NextFloat(float a, float b);
+
+	// [a, b]
+	int NextInt(int a, int b);
+
+	// Uniform on the unit sphere, w = 0.
+	XMVECTOR NextUnitVec3();
+
+	// The fills consume the stream four numbers at a time. Their output differs from the same
+	// number of scalar calls, but is just as repeatable.
+	void Fill(uint32_t* values, size_t count);
+	void FillFloat(float* values, size_t count, float a = 0.0f, float b = 1.0f);
+	void FillInt(int* values, size_t count, int a, int b);
+	void FillUnitVec3(XMFLOAT3* values, size_t count);
+
+	// The generator of the calling thread. Threads get consecutive streams of the global seed in the
+	// order they first ask for one, so they never contend or share numbers; work that has to replay
+	// exactly across threads should own a Random seeded with its own stream instead.
+	static Random& ThreadLocal();
+
+	// Reseeds every thread's generator on its next use. Thread streams are numbered again from 0.
+	static void SetSeed(uint64_t seed);
+
+private:
+	__m128i Step();
+
+private:
+	__m128i mState[4];
+
+	uint32_t mBuffer[4];
+	int mCursor = 4;
+};
@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <vector>
 #include <cassert>
+#include <cmath>
+#include <xmmintrin.h>
 
 using namespace DirectX;
 
@@ -28,6 +30,12 @@ Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
 	mCurrSolution.resize(m * n);
 	mNormals.resize(m * n);
 	mTangentX.resize(m * n);
+	mTexC.resize(m * n);
+	mRowVersions.assign(m, mVersion);
+
+	mTileRows = (m + TileSize - 1) / TileSize;
+	mTileCols = (n + TileSize - 1) / TileSize;
+	mTileImpulses.resize(mTileRows * mTileCols);
 
 	float halfWidth = (n - 1) * dx * 0.5f;
 	float halfDepth = (m - 1) * dx * 0.5f;
@@ -43,6 +51,7 @@ Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
 			mCurrSolution[i * n + j] = XMFLOAT3(x, 0.0f, z);
 			mNormals[i * n + j] = XMFLOAT3(0.0f, 1.0f, 0.0f);
 			mTangentX[i * n + j] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+			mTexC[i * n + j] = XMFLOAT2(0.5f + x / Width(), 0.5f - z / Depth());
 		}
 	}
 }
@@ -74,6 +83,7 @@ void Waves::Update(float dt)
 			});
 
 		std::swap(mPrevSolution, mCurrSolution);
+		MarkRowsDirty(1, mNumRows - 2);
 
 		t = 0.0f;
 
@@ -113,4 +123,165 @@ void Waves::Disturb(int i, int j, float magnitude)
 	mCurrSolution[i * mNumCols + j - 1].y += halfMag;
 	mCurrSolution[(i + 1) * mNumCols + j].y += halfMag;
 	mCurrSolution[(i - 1) * mNumCols + j].y += halfMag;
-}
\ No newline at end of file
+
+	MarkRowsDirty(i - 1, i + 1);
+}
+
+void Waves::Disturb(const vector<WaveImpulse>& impulses)
+{
+	for (auto& bin : mTileImpulses)
+	{
+		bin.clear();
+	}
+
+	for (int k = 0; k < (int)impulses.size(); ++k)
+	{
+		int rowBegin, rowEnd, colBegin, colEnd;
+		if (!ImpulseBounds(impulses[k], rowBegin, rowEnd, colBegin, colEnd))
+		{
+			continue;
+		}
+
+		for (int ti = rowBegin / TileSize; ti <= (rowEnd - 1) / TileSize; ++ti)
+		{
+			for (int tj = colBegin / TileSize; tj <= (colEnd - 1) / TileSize; ++tj)
+			{
+				mTileImpulses[ti * mTileCols + tj].push_back(k);
+			}
+		}
+
+		MarkRowsDirty(rowBegin, rowEnd - 1);
+	}
+
+	concurrency::parallel_for(0, mTileRows * mTileCols, [this, &impulses](int tile)
+		{
+			const auto& bin = mTileImpulses[tile];
+
+			int tileRowBegin = (tile / mTileCols) * TileSize;
+			int tileColBegin = (tile % mTileCols) * TileSize;
+
+			for (int k : bin)
+			{
+				int rowBegin, rowEnd, colBegin, colEnd;
+				ImpulseBounds(impulses[k], rowBegin, rowEnd, colBegin, colEnd);
+
+				ApplyImpulse(impulses[k],
+					std::max(rowBegin, tileRowBegin), std::min(rowEnd, tileRowBegin + TileSize),
+					std::max(colBegin, tileColBegin), std::min(colEnd, tileColBegin + TileSize));
+			}
+		});
+}
+
+uint64_t Waves::StreamVertices(void* mappedVertices, uint64_t lastVersion) const
+{
+	float* dst = reinterpret_cast<float*>(mappedVertices);
+	assert((reinterpret_cast<uintptr_t>(dst) & 15) == 0);
+
+	for (int i = 0; i < mNumRows; ++i)
+	{
+		if (mRowVersions[i] <= lastVersion)
+		{
+			continue;
+		}
+
+		for (int k = i * mNumCols; k < (i + 1) * mNumCols; ++k)
+		{
+			const XMFLOAT3& p = mCurrSolution[k];
+			const XMFLOAT3& n = mNormals[k];
+			const XMFLOAT2& uv = mTexC[k];
+
+			_mm_stream_ps(dst + k * 8, _mm_setr_ps(p.x, p.y, p.z, n.x));
+			_mm_stream_ps(dst + k * 8 + 4, _mm_setr_ps(n.y, n.z, uv.x, uv.y));
+		}
+	}
+
+	_mm_sfence();
+
+	return mVersion;
+}
+
+void Waves::MarkRowsDirty(int firstRow, int lastRow)
+{
+	++mVersion;
+	for (int i = firstRow; i <= lastRow; ++i)
+	{
+		mRowVersions[i] = mVersion;
+	}
+}
+
+bool Waves::ImpulseBounds(const WaveImpulse& impulse, int& rowBegin, int& rowEnd, int& colBegin, int& colEnd) const
+{
+	float halfWidth = (mNumCols - 1) * mSpatialStep * 0.5f;
+	float halfDepth = (mNumRows - 1) * mSpatialStep * 0.5f;
+	float invDx = 1.0f / mSpatialStep;
+
+	float col = (impulse.Position.x + halfWidth) * invDx;
+	float row = (halfDepth - impulse.Position.z) * invDx;
+	float radius = impulse.Radius * invDx;
+
+	if (!(impulse.Radius > 0.0f) || !isfinite(row) || !isfinite(col) || !isfinite(radius))
+	{
+		return false;
+	}
+
+	// The border rows and columns are fixed by the solver, so impulses only reach the interior. The
+	// range is clamped before it is converted to int, which would overflow for far away impulses.
+	float lastRow = (float)(mNumRows - 1);
+	float lastCol = (float)(mNumCols - 1);
+	rowBegin = (int)std::min(std::max(ceilf(row - radius), 1.0f), lastRow);
+	rowEnd = (int)std::min(std::max(floorf(row + radius) + 1.0f, 1.0f), lastRow);
+	colBegin = (int)std::min(std::max(ceilf(col - radius), 1.0f), lastCol);
+	colEnd = (int)std::min(std::max(floorf(col + radius) + 1.0f, 1.0f), lastCol);
+
+	return rowBegin < rowEnd && colBegin < colEnd;
+}
+
+void Waves::ApplyImpulse(const WaveImpulse& impulse, int rowBegin, int rowEnd, int colBegin, int colEnd)
+{
+	float halfWidth = (mNumCols - 1) * mSpatialStep * 0.5f;
+	float halfDepth = (mNumRows - 1) * mSpatialStep * 0.5f;
+
+	const XMVECTOR laneOffsets = XMVectorScale(XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f), mSpatialStep);
+	const XMVECTOR radiusSq = XMVectorReplicate(impulse.Radius * impulse.Radius);
+	const XMVECTOR magnitude = XMVectorReplicate(impulse.Magnitude);
+	const XMVECTOR half = XMVectorReplicate(0.5f);
+
+	// The Gaussian is truncated at three standard deviations, the cosine bump falls to zero at the radius.
+	float sigma = impulse.Radius / 3.0f;
+	const XMVECTOR gaussianScale = XMVectorReplicate(-1.0f / (2.0f * sigma * sigma));
+	const XMVECTOR cosineScale = XMVectorReplicate(XM_PI / impulse.Radius);
+
+	for (int i = rowBegin; i < rowEnd; ++i)
+	{
+		float dz = halfDepth - i * mSpatialStep - impulse.Position.z;
+		XMVECTOR dzSq = XMVectorReplicate(dz * dz);
+
+		for (int j = colBegin; j < colEnd; j += 4)
+		{
+			XMVECTOR dx = XMVectorAdd(XMVectorReplicate(-halfWidth + j * mSpatialStep - impulse.Position.x), laneOffsets);
+			XMVECTOR distSq = XMVectorMultiplyAdd(dx, dx, dzSq);
+
+			XMVECTOR weight;
+			if (impulse.Kernel == WaveKernel::Gaussian)
+			{
+				weight = XMVectorExpE(XMVectorMultiply(distSq, gaussianScale));
+			}
+			else
+			{
+				weight = XMVectorMultiplyAdd(half, XMVectorCos(XMVectorMultiply(XMVectorSqrt(distSq), cosineScale)), half);
+			}
+
+			weight = XMVectorSelect(XMVectorZero(), XMVectorMultiply(weight, magnitude), XMVectorLess(distSq, radiusSq));
+
+			XMFLOAT4 w;
+			XMStoreFloat4(&w, weight);
+			const float* lanes = &w.x;
+
+			int count = std::min(4, colEnd - j);
+			for (int l = 0; l < count; ++l)
+			{
+				mCurrSolution[i * mNumCols + j + l].y += lanes[l];
+			}
+		}
+	}
+}
@@ -1,11 +1,27 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 #include <DirectXMath.h>
 
 using namespace std;
 using namespace DirectX;
 
+enum class WaveKernel : int
+{
+	Gaussian = 0,
+	Cosine
+};
+
+struct WaveImpulse
+{
+	// World space center, only x and z are used.
+	XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };
+	float Radius = 1.0f;
+	float Magnitude = 0.0f;
+	WaveKernel Kernel = WaveKernel::Gaussian;
+};
+
 class Waves
 {
 public:
@@ -24,10 +40,27 @@ public:
 	const XMFLOAT3& Position(int i) const { return mCurrSolution[i]; }
 	const XMFLOAT3& Normal(int i) const { return mNormals[i]; }
 	const XMFLOAT3& TangentX(int i) const { return mTangentX[i]; }
+	const XMFLOAT2& TexC(int i) const { return mTexC[i]; }
+
+	uint64_t Version() const { return mVersion; }
 
 	void Update(float dt);
 	void Disturb(int i, int j, float magnitude);
 
+	// Rasterizes a batch of world space impulses into the height field. Impulses are clipped to the
+	// simulated interior and binned by tile so every tile is written by a single worker.
+	void Disturb(const vector<WaveImpulse>& impulses);
+
+	// Writes every row changed after lastVersion into a mapped { Pos, Normal, TexC } vertex buffer
+	// with non-temporal stores and returns the version the buffer is now up to date with.
+	uint64_t StreamVertices(void* mappedVertices, uint64_t lastVersion) const;
+
+private:
+	void MarkRowsDirty(int firstRow, int lastRow);
+
+	bool ImpulseBounds(const WaveImpulse& impulse, int& rowBegin, int& rowEnd, int& colBegin, int& colEnd) const;
+	void ApplyImpulse(const WaveImpulse& impulse, int rowBegin, int rowEnd, int colBegin, int colEnd);
+
 private:
 	int mNumRows = 0;
 	int mNumCols = 0;
@@ -46,4 +79,13 @@ private:
 	vector<XMFLOAT3> mCurrSolution;
 	vector<XMFLOAT3> mNormals;
 	vector<XMFLOAT3> mTangentX;
+	vector<XMFLOAT2> mTexC;
+
+	uint64_t mVersion = 1;
+	vector<uint64_t> mRowVersions;
+
+	static const int TileSize = 32;
+	int mTileRows = 0;
+	int mTileCols = 0;
+	vector<vector<int>> mTileImpulses;
 };
@@ -1,5 +1,6 @@
 #include "BaseApp.h"
 #include "StaticSamplers.h"
+#include "BezierTessellator.h"
 
 class BezierApp : public BaseApp
 {
@@ -23,6 +24,9 @@ private:
 	void BuildRenderItems();
 	void BuildFrameResources();
 	void BuildPSOs();
+
+private:
+	unique_ptr<BezierTessellator> mPatchTessellator;
 };
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
@@ -218,6 +222,10 @@ void BezierApp::BuildQuadPatchGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
+	// The GPU tessellates the patch; the CPU copy serves bounds and picking.
+	mPatchTessellator = make_unique<BezierTessellator>(vertices);
+	submesh.Bounds = mPatchTessellator->HullBounds();
+
 	geo->DrawArgs["quadpatch"] = submesh;
 
 	mGeometries[geo->Name] = move(geo);
@@ -0,0 +1,439 @@
+#include "BezierTessellator.h"
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+namespace
+{
+	// Structure of arrays accumulation of one patch row for four samples.
+	struct RowSum
+	{
+		XMVECTOR X;
+		XMVECTOR Y;
+		XMVECTOR Z;
+	};
+
+	RowSum SumRow(const XMVECTOR* cx, const XMVECTOR* cy, const XMVECTOR* cz, const XMVECTOR* basis)
+	{
+		RowSum row;
+		row.X = XMVectorMultiply(basis[0], cx[0]);
+		row.Y = XMVectorMultiply(basis[0], cy[0]);
+		row.Z = XMVectorMultiply(basis[0], cz[0]);
+		for (int c = 1; c < 4; ++c)
+		{
+			row.X = XMVectorMultiplyAdd(basis[c], cx[c], row.X);
+			row.Y = XMVectorMultiplyAdd(basis[c], cy[c], row.Y);
+			row.Z = XMVectorMultiplyAdd(basis[c], cz[c], row.Z);
+		}
+		return row;
+	}
+
+	void Basis4(XMVECTOR t, XMVECTOR* basis, XMVECTOR* dBasis)
+	{
+		XMVECTOR one = XMVectorReplicate(1.0f);
+		XMVECTOR three = XMVectorReplicate(3.0f);
+		XMVECTOR six = XMVectorReplicate(6.0f);
+
+		XMVECTOR invT = XMVectorSubtract(one, t);
+		XMVECTOR t2 = XMVectorMultiply(t, t);
+		XMVECTOR invT2 = XMVectorMultiply(invT, invT);
+		XMVECTOR tInvT = XMVectorMultiply(t, invT);
+
+		basis[0] = XMVectorMultiply(invT2, invT);
+		basis[1] = XMVectorMultiply(XMVectorMultiply(three, t), invT2);
+		basis[2] = XMVectorMultiply(XMVectorMultiply(three, t2), invT);
+		basis[3] = XMVectorMultiply(t2, t);
+
+		dBasis[0] = XMVectorMultiply(XMVectorReplicate(-3.0f), invT2);
+		dBasis[1] = XMVectorSubtract(XMVectorMultiply(three, invT2), XMVectorMultiply(six, tInvT));
+		dBasis[2] = XMVectorSubtract(XMVectorMultiply(six, tInvT), XMVectorMultiply(three, t2));
+		dBasis[3] = XMVectorMultiply(three, t2);
+	}
+
+	// Normalizes four vectors stored as x, y and z lanes. Zero vectors stay zero.
+	void Normalize4(XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+	{
+		XMVECTOR lengthSq = XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, XMVectorMultiply(z, z)));
+		XMVECTOR length = XMVectorMax(XMVectorSqrt(lengthSq), XMVectorReplicate(1e-20f));
+		x = XMVectorDivide(x, length);
+		y = XMVectorDivide(y, length);
+		z = XMVectorDivide(z, length);
+	}
+}
+
+BezierTessellator::BezierTessellator(const array<XMFLOAT3, 16>& controlPoints)
+	: mControlPoints(controlPoints)
+{
+	BoundingBox::CreateFromPoints(mHullBounds, mControlPoints.size(), mControlPoints.data(), sizeof(XMFLOAT3));
+
+	MeasureErrors();
+}
+
+BezierTessellator::~BezierTessellator()
+{
+}
+
+XMFLOAT4 BezierTessellator::BernsteinBasis(float t)
+{
+	float invT = 1.0f - t;
+
+	return XMFLOAT4(
+		invT * invT * invT,
+		3.0f * t * invT * invT,
+		3.0f * t * t * invT,
+		t * t * t);
+}
+
+XMFLOAT4 BezierTessellator::dBernsteinBasis(float t)
+{
+	float invT = 1.0f - t;
+
+	return XMFLOAT4(
+		-3.0f * invT * invT,
+		3.0f * invT * invT - 6.0f * t * invT,
+		6.0f * t * invT - 3.0f * t * t,
+		3.0f * t * t);
+}
+
+XMFLOAT3 BezierTessellator::Evaluate(float u, float v) const
+{
+	XMFLOAT4 bu = BernsteinBasis(u);
+	XMFLOAT4 bv = BernsteinBasis(v);
+
+	const float basisU[4] = { bu.x, bu.y, bu.z, bu.w };
+	const float basisV[4] = { bv.x, bv.y, bv.z, bv.w };
+
+	XMVECTOR sum = XMVectorZero();
+	for (int r = 0; r < 4; ++r)
+	{
+		XMVECTOR row = XMVectorZero();
+		for (int c = 0; c < 4; ++c)
+		{
+			row = XMVectorMultiplyAdd(XMVectorReplicate(basisU[c]), XMLoadFloat3(&mControlPoints[r * 4 + c]), row);
+		}
+		sum = XMVectorMultiplyAdd(XMVectorReplicate(basisV[r]), row, sum);
+	}
+
+	XMFLOAT3 p;
+	XMStoreFloat3(&p, sum);
+	return p;
+}
+
+void BezierTessellator::Evaluate(const XMFLOAT2* uv, size_t count, XMFLOAT3* positions, XMFLOAT3* normals, XMFLOAT3* tangents) const
+{
+	XMVECTOR cx[16];
+	XMVECTOR cy[16];
+	XMVECTOR cz[16];
+	for (int i = 0; i < 16; ++i)
+	{
+		cx[i] = XMVectorReplicate(mControlPoints[i].x);
+		cy[i] = XMVectorReplicate(mControlPoints[i].y);
+		cz[i] = XMVectorReplicate(mControlPoints[i].z);
+	}
+
+	for (size_t first = 0; first < count; first += 4)
+	{
+		size_t n = min((size_t)4, count - first);
+
+		// Pad the last block by repeating its final sample.
+		float u[4];
+		float v[4];
+		for (size_t k = 0; k < 4; ++k)
+		{
+			const XMFLOAT2& s = uv[first + min(k, n - 1)];
+			u[k] = s.x;
+			v[k] = s.y;
+		}
+
+		XMVECTOR basisU[4], dBasisU[4];
+		XMVECTOR basisV[4], dBasisV[4];
+		Basis4(XMVectorSet(u[0], u[1], u[2], u[3]), basisU, dBasisU);
+		Basis4(XMVectorSet(v[0], v[1], v[2], v[3]), basisV, dBasisV);
+
+		XMVECTOR px = XMVectorZero(), py = XMVectorZero(), pz = XMVectorZero();
+		XMVECTOR ux = XMVectorZero(), uy = XMVectorZero(), uz = XMVectorZero();
+		XMVECTOR vx = XMVectorZero(), vy = XMVectorZero(), vz = XMVectorZero();
+
+		for (int r = 0; r < 4; ++r)
+		{
+			RowSum row = SumRow(cx + r * 4, cy + r * 4, cz + r * 4, basisU);
+
+			px = XMVectorMultiplyAdd(basisV[r], row.X, px);
+			py = XMVectorMultiplyAdd(basisV[r], row.Y, py);
+			pz = XMVectorMultiplyAdd(basisV[r], row.Z, pz);
+
+			vx = XMVectorMultiplyAdd(dBasisV[r], row.X, vx);
+			vy = XMVectorMultiplyAdd(dBasisV[r], row.Y, vy);
+			vz = XMVectorMultiplyAdd(dBasisV[r], row.Z, vz);
+
+			if (normals != nullptr || tangents != nullptr)
+			{
+				RowSum dRow = SumRow(cx + r * 4, cy + r * 4, cz + r * 4, dBasisU);
+
+				ux = XMVectorMultiplyAdd(basisV[r], dRow.X, ux);
+				uy = XMVectorMultiplyAdd(basisV[r], dRow.Y, uy);
+				uz = XMVectorMultiplyAdd(basisV[r], dRow.Z, uz);
+			}
+		}
+
+		XMFLOAT4 x, y, z;
+		XMStoreFloat4(&x, px);
+		XMStoreFloat4(&y, py);
+		XMStoreFloat4(&z, pz);
+
+		const float* xs = &x.x;
+		const float* ys = &y.x;
+		const float* zs = &z.x;
+		for (size_t k = 0; k < n; ++k)
+		{
+			positions[first + k] = XMFLOAT3(xs[k], ys[k], zs[k]);
+		}
+
+		if (normals != nullptr)
+		{
+			// u runs along +x and v towards -z on the default patch, so dP/du x dP/dv faces up.
+			XMVECTOR nx = XMVectorSubtract(XMVectorMultiply(uy, vz), XMVectorMultiply(uz, vy));
+			XMVECTOR ny = XMVectorSubtract(XMVectorMultiply(uz, vx), XMVectorMultiply(ux, vz));
+			XMVECTOR nz = XMVectorSubtract(XMVectorMultiply(ux, vy), XMVectorMultiply(uy, vx));
+			Normalize4(nx, ny, nz);
+
+			XMStoreFloat4(&x, nx);
+			XMStoreFloat4(&y, ny);
+			XMStoreFloat4(&z, nz);
+			for (size_t k = 0; k < n; ++k)
+			{
+				normals[first + k] = XMFLOAT3(xs[k], ys[k], zs[k]);
+			}
+		}
+
+		if (tangents != nullptr)
+		{
+			Normalize4(ux, uy, uz);
+
+			XMStoreFloat4(&x, ux);
+			XMStoreFloat4(&y, uy);
+			XMStoreFloat4(&z, uz);
+			for (size_t k = 0; k < n; ++k)
+			{
+				tangents[first + k] = XMFLOAT3(xs[k], ys[k], zs[k]);
+			}
+		}
+	}
+}
+
+void BezierTessellator::EvaluateGrid(const BezierLod& lod, vector<XMFLOAT3>& positions, vector<XMFLOAT3>* normals, vector<XMFLOAT3>* tangents) const
+{
+	const int segmentsU = 1 << lod.LevelU;
+	const int segmentsV = 1 << lod.LevelV;
+	const int columns = segmentsU + 1;
+	const int rows = segmentsV + 1;
+
+	vector<XMFLOAT2> uv(rows * columns);
+	for (int i = 0; i < rows; ++i)
+	{
+		for (int j = 0; j < columns; ++j)
+		{
+			uv[i * columns + j] = XMFLOAT2((float)j / segmentsU, (float)i / segmentsV);
+		}
+	}
+
+	positions.resize(uv.size());
+	if (normals != nullptr)
+	{
+		normals->resize(uv.size());
+	}
+	if (tangents != nullptr)
+	{
+		tangents->resize(uv.size());
+	}
+
+	Evaluate(uv.data(), uv.size(), positions.data(),
+		normals != nullptr ? normals->data() : nullptr,
+		tangents != nullptr ? tangents->data() : nullptr);
+}
+
+void BezierTessellator::MeasureErrors()
+{
+	// Every cell is split into the same two triangles as the index buffer, and the surface is
+	// compared with them on a 3x3 set of points inside the cell.
+	const float fractions[3] = { 0.25f, 0.5f, 0.75f };
+
+	vector<XMFLOAT3> grid;
+	vector<XMFLOAT2> uv;
+	vector<XMFLOAT3> surface;
+
+	for (int levelV = 0; levelV <= MaxLevel; ++levelV)
+	{
+		for (int levelU = 0; levelU <= MaxLevel; ++levelU)
+		{
+			BezierLod lod;
+			lod.LevelU = levelU;
+			lod.LevelV = levelV;
+
+			const int segmentsU = 1 << levelU;
+			const int segmentsV = 1 << levelV;
+			const int columns = segmentsU + 1;
+
+			EvaluateGrid(lod, grid, nullptr, nullptr);
+
+			uv.clear();
+			for (int i = 0; i < segmentsV; ++i)
+			{
+				for (int j = 0; j < segmentsU; ++j)
+				{
+					for (float fv : fractions)
+					{
+						for (float fu : fractions)
+						{
+							uv.push_back(XMFLOAT2((j + fu) / segmentsU, (i + fv) / segmentsV));
+						}
+					}
+				}
+			}
+
+			surface.resize(uv.size());
+			Evaluate(uv.data(), uv.size(), surface.data(), nullptr);
+
+			float maxError = 0.0f;
+			size_t k = 0;
+			for (int i = 0; i < segmentsV; ++i)
+			{
+				for (int j = 0; j < segmentsU; ++j)
+				{
+					XMVECTOR p00 = XMLoadFloat3(&grid[i * columns + j]);
+					XMVECTOR p01 = XMLoadFloat3(&grid[i * columns + j + 1]);
+					XMVECTOR p10 = XMLoadFloat3(&grid[(i + 1) * columns + j]);
+					XMVECTOR p11 = XMLoadFloat3(&grid[(i + 1) * columns + j + 1]);
+
+					for (float fv : fractions)
+					{
+						for (float fu : fractions)
+						{
+							// The diagonal runs from (j + 1, i) to (j, i + 1).
+							XMVECTOR flat = fu + fv <= 1.0f ?
+								XMVectorAdd(p00, XMVectorAdd(XMVectorScale(XMVectorSubtract(p01, p00), fu), XMVectorScale(XMVectorSubtract(p10, p00), fv))) :
+								XMVectorAdd(p11, XMVectorAdd(XMVectorScale(XMVectorSubtract(p10, p11), 1.0f - fu), XMVectorScale(XMVectorSubtract(p01, p11), 1.0f - fv)));
+
+							XMVECTOR d = XMVectorSubtract(XMLoadFloat3(&surface[k++]), flat);
+							maxError = max(maxError, XMVectorGetX(XMVector3Length(d)));
+						}
+					}
+				}
+			}
+
+			mErrors[LodIndex(lod)] = maxError;
+		}
+	}
+}
+
+BezierLod BezierTessellator::SelectLod(const XMFLOAT3& eyePos, CXMMATRIX proj, float viewportHeight, float maxScreenError) const
+{
+	// Distance from the eye to the closest point of the hull bounds.
+	XMVECTOR center = XMLoadFloat3(&mHullBounds.Center);
+	XMVECTOR extents = XMLoadFloat3(&mHullBounds.Extents);
+	XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&eyePos), center);
+	XMVECTOR outside = XMVectorMax(XMVectorSubtract(XMVectorAbs(offset), extents), XMVectorZero());
+	float distance = max(XMVectorGetX(XMVector3Length(outside)), 1e-3f);
+
+	XMFLOAT4X4 p;
+	XMStoreFloat4x4(&p, proj);
+	const float pixelsPerUnit = 0.5f * viewportHeight * p._22 / distance;
+	const float maxError = maxScreenError / pixelsPerUnit;
+
+	// u and v are refined independently, so a patch that only bends one way stays coarse along the other.
+	BezierLod best;
+	best.LevelU = MaxLevel;
+	best.LevelV = MaxLevel;
+
+	for (int levelV = 0; levelV <= MaxLevel; ++levelV)
+	{
+		for (int levelU = 0; levelU <= MaxLevel; ++levelU)
+		{
+			BezierLod lod;
+			lod.LevelU = levelU;
+			lod.LevelV = levelV;
+
+			if (Error(lod) > maxError)
+			{
+				continue;
+			}
+
+			int cost = levelU + levelV;
+			int bestCost = best.LevelU + best.LevelV;
+			if (cost < bestCost || (cost == bestCost && Error(lod) < Error(best)))
+			{
+				best = lod;
+			}
+		}
+	}
+
+	return best;
+}
+
+const GeometryGenerator::MeshData& BezierTessellator::GetTessellation(const BezierLod& lod)
+{
+	return Tessellate(lod).Mesh;
+}
+
+const BoundingBox& BezierTessellator::GetTessellationBounds(const BezierLod& lod)
+{
+	return Tessellate(lod).Bounds;
+}
+
+void BezierTessellator::ClearCache()
+{
+	for (auto& entry : mCache)
+	{
+		entry.reset();
+	}
+}
+
+BezierTessellator::CachedTessellation& BezierTessellator::Tessellate(const BezierLod& lod)
+{
+	assert(lod.LevelU >= 0 && lod.LevelU <= MaxLevel);
+	assert(lod.LevelV >= 0 && lod.LevelV <= MaxLevel);
+
+	auto& entry = mCache[LodIndex(lod)];
+	if (entry)
+	{
+		return *entry;
+	}
+
+	entry = make_unique<CachedTessellation>();
+
+	const uint32_t segmentsU = 1u << lod.LevelU;
+	const uint32_t segmentsV = 1u << lod.LevelV;
+	const uint32_t columns = segmentsU + 1;
+
+	vector<XMFLOAT3> positions;
+	vector<XMFLOAT3> normals;
+	vector<XMFLOAT3> tangents;
+	EvaluateGrid(lod, positions, &normals, &tangents);
+
+	auto& mesh = entry->Mesh;
+	mesh.Vertices.resize(positions.size());
+	for (size_t k = 0; k < positions.size(); ++k)
+	{
+		XMFLOAT2 uv((float)(k % columns) / segmentsU, (float)(k / columns) / segmentsV);
+		mesh.Vertices[k] = GeometryGenerator::Vertex(positions[k], normals[k], tangents[k], uv);
+	}
+
+	mesh.Indices32.reserve(segmentsU * segmentsV * 6);
+	for (uint32_t i = 0; i < segmentsV; ++i)
+	{
+		for (uint32_t j = 0; j < segmentsU; ++j)
+		{
+			mesh.Indices32.push_back(i * columns + j);
+			mesh.Indices32.push_back(i * columns + j + 1);
+			mesh.Indices32.push_back((i + 1) * columns + j);
+
+			mesh.Indices32.push_back((i + 1) * columns + j);
+			mesh.Indices32.push_back(i * columns + j + 1);
+			mesh.Indices32.push_back((i + 1) * columns + j + 1);
+		}
+	}
+
+	BoundingBox::CreateFromPoints(entry->Bounds, positions.size(), positions.data(), sizeof(XMFLOAT3));
+
+	return *entry;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "GeometryGenerator.h"
+
+using namespace std;
+using namespace DirectX;
+
+// Segment counts of a tessellation are 1 << LevelU along u and 1 << LevelV along v.
+struct BezierLod
+{
+	int LevelU = 0;
+	int LevelV = 0;
+};
+
+// CPU side evaluation of a 16 control point bicubic Bezier patch, using the same basis and
+// control point layout as BezierUtil.hlsl: row r of the patch is weighted by BernsteinBasis(v)[r],
+// column c by BernsteinBasis(u)[c]. Tessellations are built on demand and cached per LOD.
+class BezierTessellator
+{
+public:
+	// Matches maxtessfactor(64) of the hull shader.
+	static const int MaxLevel = 6;
+
+	BezierTessellator(const array<XMFLOAT3, 16>& controlPoints);
+	BezierTessellator(const BezierTessellator& rhs) = delete;
+	BezierTessellator& operator=(const BezierTessellator& rhs) = delete;
+	~BezierTessellator();
+
+	// Scalar versions of BernsteinBasis and dBernsteinBasis.
+	static XMFLOAT4 BernsteinBasis(float t);
+	static XMFLOAT4 dBernsteinBasis(float t);
+
+	XMFLOAT3 Evaluate(float u, float v) const;
+
+	// Positions, unit normals and unit u tangents for count (u, v) samples, four at a time.
+	// normals and tangents may be null.
+	void Evaluate(const XMFLOAT2* uv, size_t count, XMFLOAT3* positions, XMFLOAT3* normals, XMFLOAT3* tangents = nullptr) const;
+
+	// Bounds of the control hull, which always contains the surface.
+	const BoundingBox& HullBounds() const { return mHullBounds; }
+
+	// Largest measured distance between the surface and the triangles of a tessellation.
+	float Error(const BezierLod& lod) const { return mErrors[LodIndex(lod)]; }
+
+	// Picks the cheapest LOD whose error, projected from the closest point of the hull, stays under
+	// maxScreenError pixels. eyePos is in patch space.
+	BezierLod SelectLod(const XMFLOAT3& eyePos, CXMMATRIX proj, float viewportHeight, float maxScreenError) const;
+
+	// Grid of (1 << LevelU) + 1 by (1 << LevelV) + 1 vertices with clockwise triangles, TexC holds (u, v).
+	const GeometryGenerator::MeshData& GetTessellation(const BezierLod& lod);
+	const BoundingBox& GetTessellationBounds(const BezierLod& lod);
+
+	void ClearCache();
+
+private:
+	struct CachedTessellation
+	{
+		GeometryGenerator::MeshData Mesh;
+		BoundingBox Bounds;
+	};
+
+	static int LodIndex(const BezierLod& lod) { return lod.LevelV * (MaxLevel + 1) + lod.LevelU; }
+
+	void MeasureErrors();
+	void EvaluateGrid(const BezierLod& lod, vector<XMFLOAT3>& positions, vector<XMFLOAT3>* normals, vector<XMFLOAT3>* tangents) const;
+	CachedTessellation& Tessellate(const BezierLod& lod);
+
+private:
+	array<XMFLOAT3, 16> mControlPoints;
+	BoundingBox mHullBounds;
+
+	array<float, (MaxLevel + 1) * (MaxLevel + 1)> mErrors;
+
+	array<unique_ptr<CachedTessellation>, (MaxLevel + 1) * (MaxLevel + 1)> mCache;
+};
@@ -13,11 +13,17 @@ BaseApp::BaseApp(HINSTANCE hInstance)
 
 BaseApp::~BaseApp()
 {
-
+	if (mPipelineCache != nullptr)
+	{
+		mPipelineCache->Save();
+	}
+	JobSystem::GetInstance().Shutdown();
 }
 
 bool BaseApp::Initialize()
 {
+	mStartupTime = chrono::steady_clock::now();
+
 #if defined(DEBUG) | defined(_DEBUG)
 	D3DApp::CreateDebugConsole();
 	EnableD3D12DebugLayer();
@@ -32,23 +38,31 @@ bool BaseApp::Initialize()
 		return false;
 	}
 
+	JobSystem::GetInstance().Initialize();
+	BuildUpdateGraph();
+
 	mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	mPipelineCache = make_unique<PipelineCache>(md3dDevice.Get());
 	mCamera.SetPosition(0.0f, 2.0f, -15.0f);
 
 	mShadowMap = make_unique<ShadowMap>(md3dDevice.Get(), 2048, 2048);
 
 	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
+	auto buildStart = chrono::steady_clock::now();
 	Build();
+	AddStartupPhase("Build", chrono::duration<double, milli>(chrono::steady_clock::now() - buildStart).count());
 
-	// BuildWireFramePSOs();
+	BuildWireFramePSOs();
 
 	ThrowIfFailed(mCommandList->Close());
 
+	auto uploadStart = chrono::steady_clock::now();
 	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
 	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
 	FlushCommandQueue();
+	AddStartupPhase("Upload", chrono::duration<double, milli>(chrono::steady_clock::now() - uploadStart).count());
 
 	return true;
 }
@@ -77,6 +91,10 @@ void BaseApp::Update(const Timer& gt)
 		CloseHandle(eventHandle);
 	}
 
+	mCurrFrameResource->Allocator->Reset();
+	mUploadStats.Reset();
+	mSrvHeap->Retire(mFence->GetCompletedValue());
+
 	mLightRotationAngle += 0.1f * gt.GetDeltaTime();
 
 	XMMATRIX R = XMMatrixRotationY(mLightRotationAngle);
@@ -87,12 +105,90 @@ void BaseApp::Update(const Timer& gt)
 		XMStoreFloat3(&mRotatedLightDirections[i], lightDir);
 	}
 
-	AnimateMaterials(gt);
-	UpdateInstanceBuffer(gt);
-	UpdateMaterialBuffer(gt);
-	UpdateShadowTransform(gt);
-	UpdateMainPassCB(gt);
-	UpdateShadowPassCB(gt);
+	mUpdateTimer = &gt;
+	mUpdateGraph.Run(JobSystem::GetInstance());
+	mUpdateTimer = nullptr;
+}
+
+void BaseApp::BuildUpdateGraph()
+{
+	// Materials are animated before they are uploaded and both passes need the light matrices of the
+	// shadow transform; the stages write disjoint data otherwise, so the rest overlaps.
+	int animate = mUpdateGraph.AddTask("AnimateMaterials", [this]() { AnimateMaterials(*mUpdateTimer); });
+	mUpdateGraph.AddTask("UpdateInstanceBuffer", [this]() { UpdateInstanceBuffer(*mUpdateTimer); });
+	int materials = mUpdateGraph.AddTask("UpdateMaterialBuffer", [this]() { UpdateMaterialBuffer(*mUpdateTimer); });
+	int shadowTransform = mUpdateGraph.AddTask("UpdateShadowTransform", [this]() { UpdateShadowTransform(*mUpdateTimer); });
+	int mainPass = mUpdateGraph.AddTask("UpdateMainPassCB", [this]() { UpdateMainPassCB(*mUpdateTimer); });
+	int shadowPass = mUpdateGraph.AddTask("UpdateShadowPassCB", [this]() { UpdateShadowPassCB(*mUpdateTimer); });
+
+	mUpdateGraph.Precede(animate, materials);
+	mUpdateGraph.Precede(shadowTransform, mainPass);
+	mUpdateGraph.Precede(shadowTransform, shadowPass);
+}
+
+void BaseApp::UploadGeometry(unique_ptr<MeshGeometry> geo)
+{
+	geo->VertexBufferGPU = D3DUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+		geo->VertexBufferCPU->GetBufferPointer(), geo->VertexBufferByteSize, geo->VertexBufferUploader);
+
+	geo->IndexBufferGPU = D3DUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+		geo->IndexBufferCPU->GetBufferPointer(), geo->IndexBufferByteSize, geo->IndexBufferUploader);
+
+	mGeometries[geo->Name] = move(geo);
+}
+
+void BaseApp::AddStartupPhase(const string& name, double milliseconds)
+{
+	mStartupPhases.push_back(make_pair(name, milliseconds));
+}
+
+void BaseApp::AddStartupPhases(const TaskGraph& graph)
+{
+	for (int i = 0; i < graph.TaskCount(); ++i)
+	{
+		AddStartupPhase(graph.TaskName(i), graph.TaskTime(i));
+	}
+}
+
+void BaseApp::ReportStartup()
+{
+	double firstFrame = chrono::duration<double, milli>(chrono::steady_clock::now() - mStartupTime).count();
+
+	ostringstream report;
+	report.setf(ios::fixed);
+	report.precision(2);
+
+	report << "Startup phases (ms):\n";
+	for (auto& phase : mStartupPhases)
+	{
+		report << phase.first << ": " << phase.second << "\n";
+	}
+	report << "Shader cache: " << mShaderCache.Hits() << " hits, " << mShaderCache.Misses() << " compiled ("
+		<< (mShaderCache.Misses() == 0 ? "warm" : "cold") << " start)\n";
+	report << "Pipeline cache: " << mPipelineCache->Loaded() << " loaded, " << mPipelineCache->Created() << " compiled\n";
+	report << "Time to first frame: " << firstFrame << "\n";
+
+	report << "Layouts (bytes, padding): PassConstants " << sizeof(PassConstants) << ", " << PassConstants::PaddingBytes()
+		<< "; ObjectData " << sizeof(ObjectData) << ", " << ObjectData::PaddingBytes()
+		<< "; MaterialData " << sizeof(MaterialData) << ", " << MaterialData::PaddingBytes() << "\n";
+
+	OutputDebugStringA(report.str().c_str());
+}
+
+wstring BaseApp::FrameStatsText() const
+{
+	// The upload of the last frame per layout, in bytes, then what the draw queues submitted.
+	return L"  upload: " + to_wstring(mUploadStats.Total()) +
+		L" (pass " + to_wstring(mUploadStats.PassConstants) +
+		L", object " + to_wstring(mUploadStats.ObjectData) +
+		L", material " + to_wstring(mUploadStats.MaterialData) +
+		L", instance " + to_wstring(mUploadStats.InstanceIndices) +
+		L", args " + to_wstring(mUploadStats.DrawArguments) + L")" +
+		L"  draws: " + to_wstring(mDrawStats.Draws) +
+		L" (instances " + to_wstring(mDrawStats.Instances) +
+		L", indirect " + to_wstring(mDrawStats.IndirectCalls) +
+		L", binds " + to_wstring(mDrawStats.BindsIssued) +
+		L", saved " + to_wstring(mDrawStats.BindsSaved) + L")";
 }
 
 void BaseApp::Draw(const Timer& gt)
@@ -103,7 +199,9 @@ void BaseApp::Draw(const Timer& gt)
 
 	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
 
-	ID3D12DescriptorHeap* descriptorheaps[] = { mSrvDescriptorHeap.Get() };
+	mDrawStats = DrawStats();
+
+	ID3D12DescriptorHeap* descriptorheaps[] = { mSrvHeap->Heap() };
 	mCommandList->SetDescriptorHeaps(_countof(descriptorheaps), descriptorheaps);
 
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
@@ -111,9 +209,12 @@ void BaseApp::Draw(const Timer& gt)
 	auto matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
 	mCommandList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
 
-	mCommandList->SetGraphicsRootDescriptorTable(3, mNullSrv);
+	auto objectBuffer = mCurrFrameResource->ObjectCB->Resource();
+	mCommandList->SetGraphicsRootShaderResourceView(5, objectBuffer->GetGPUVirtualAddress());
+
+	mCommandList->SetGraphicsRootDescriptorTable(3, mSrvHeap->GpuHandle(mNullSrvTable));
 
-	mCommandList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	mCommandList->SetGraphicsRootDescriptorTable(4, mSrvHeap->GpuHandle(mTextureTable));
 
 	DrawSceneToShadowMap();
 
@@ -132,21 +233,19 @@ void BaseApp::Draw(const Timer& gt)
 	auto depthStencilView = DepthStencilView();
 	mCommandList->OMSetRenderTargets(1, &currentBackBufferView, true, &depthStencilView);
 
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
+	mCommandList->SetGraphicsRootConstantBufferView(1, mMainPassAddress);
 
-	CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-	skyTexDescriptor.Offset(mSkyTexHeapIndex, mCbvSrvDescriptorSize);
-	mCommandList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
+	DescriptorRange skyTableSources[] = { mSkySrv, mShadowMapSrv };
+	DescriptorRange skyTable = mSrvHeap->CopyToTransient(skyTableSources, _countof(skyTableSources));
+	mCommandList->SetGraphicsRootDescriptorTable(3, mSrvHeap->GpuHandle(skyTable));
 
-	mCommandList->SetPipelineState(mPSOs["opaque"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
-
-	mCommandList->SetPipelineState(mPSOs["debug"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Debug]);
+	XMMATRIX view = mCamera.GetView();
 
-	mCommandList->SetPipelineState(mPSOs["sky"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Sky]);
+	mMainDrawQueue.Clear();
+	QueueRenderItems(mMainDrawQueue, RenderLayer::Opaque, Pso("opaque"), view);
+	QueueRenderItems(mMainDrawQueue, RenderLayer::Debug, Pso("debug"), view);
+	QueueRenderItems(mMainDrawQueue, RenderLayer::Sky, Pso("sky"), view);
+	DrawRenderItems(mCommandList.Get(), mMainDrawQueue);
 	//  #pragma endregion
 
 	auto toPresent = CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
@@ -162,9 +261,15 @@ void BaseApp::Draw(const Timer& gt)
 	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
 	mCurrFrameResource->Fence = ++mCurrentFence;
+	mSrvHeap->EndFrame(mCurrFrameResource->Fence);
 
 	mCommandQueue->Signal(mFence.Get(), mCurrentFence);
 
+	if (!mFirstFramePresented)
+	{
+		mFirstFramePresented = true;
+		ReportStartup();
+	}
 }
 
 void BaseApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -227,23 +332,64 @@ void BaseApp::UpdateInstanceBuffer(const Timer& gt)
 {
 	auto currInstanceBuffer = mCurrFrameResource->ObjectCB.get();
 
-	for (auto& e : mAllRitems)
+	for (int transform : mTransforms.Update())
 	{
-		if (e->NumFramesDirty > 0)
+		for (auto ritem : mTransformRitems[transform])
 		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+			MarkDirty(ritem);
+		}
+	}
+
+	if (mDirtyRitems.empty())
+	{
+		return;
+	}
 
-			ObjectData objData;
-			XMStoreFloat4x4(&objData.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objData.TexTransform, XMMatrixTranspose(texTransform));
-			objData.MaterialIndex = e->Mat->MatCBIndex;
+	// The world rows of all dirty items go through the batched transpose first.
+	mDirtyTransforms.clear();
+	for (auto e : mDirtyRitems)
+	{
+		mDirtyTransforms.push_back(e->Transform);
+	}
+	mDirtyObjects.resize(mDirtyRitems.size());
+	MatrixKernels::StoreTransposed3x4(mTransforms.WorldData(), sizeof(XMFLOAT4X4A), mDirtyTransforms.data(),
+		mDirtyObjects[0].World, sizeof(ObjectData), mDirtyRitems.size());
 
-			currInstanceBuffer->CopyData(e->ObjCBIndex, objData);
+	size_t pending = 0;
+	for (size_t i = 0; i < mDirtyRitems.size(); ++i)
+	{
+		auto e = mDirtyRitems[i];
+		ObjectData& objData = mDirtyObjects[i];
+		PackObjectTexture(XMLoadFloat4x4(&e->TexTransform), e->Mat->MatCBIndex, objData);
 
-			e->NumFramesDirty--;
+		currInstanceBuffer->CopyData(e->ObjCBIndex, objData);
+		mUploadStats.ObjectData += sizeof(ObjectData);
+
+		if (--e->NumFramesDirty > 0)
+		{
+			mDirtyRitems[pending++] = e;
 		}
 	}
+	mDirtyRitems.resize(pending);
+}
+
+void BaseApp::AttachTransform(RenderItem* ritem, FXMMATRIX world, int parent)
+{
+	ritem->Transform = mTransforms.Create(world, parent);
+	mTransformRitems.resize(mTransforms.Count());
+	mTransformRitems[ritem->Transform].push_back(ritem);
+
+	ritem->NumFramesDirty = 0;
+	MarkDirty(ritem);
+}
+
+void BaseApp::MarkDirty(RenderItem* ritem)
+{
+	if (ritem->NumFramesDirty == 0)
+	{
+		mDirtyRitems.push_back(ritem);
+	}
+	ritem->NumFramesDirty = gNumFrameResources;
 }
 
 void BaseApp::UpdateMaterialBuffer(const Timer& gt)
@@ -256,7 +402,7 @@ void BaseApp::UpdateMaterialBuffer(const Timer& gt)
 		{
 			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
 
-			MaterialData matData;
+			MaterialData matData = {};
 			matData.DiffuseAlbedo = mat->DiffuseAlbedo;
 			matData.FresnelR0 = mat->FresnelR0;
 			matData.Roughness = mat->Roughness;
@@ -265,6 +411,7 @@ void BaseApp::UpdateMaterialBuffer(const Timer& gt)
 			matData.NormalMapIndex = mat->NormalSrvHeapIndex;
 
 			currMaterialBuffer->CopyData(mat->MatCBIndex, matData);
+			mUploadStats.MaterialData += sizeof(MaterialData);
 
 			mat->NumFramesDirty--;
 		}
@@ -313,12 +460,8 @@ void BaseApp::UpdateMainPassCB(const Timer& gt)
 	XMMATRIX proj = mCamera.GetProj();
 
 	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-	auto detView = XMMatrixDeterminant(view);
-	auto detProj = XMMatrixDeterminant(proj);
-	auto detViewProj = XMMatrixDeterminant(viewProj);
-	XMMATRIX invView = XMMatrixInverse(&detView, view);
-	XMMATRIX invProj = XMMatrixInverse(&detProj, proj);
-	XMMATRIX invViewProj = XMMatrixInverse(&detViewProj, viewProj);
+	XMMATRIX invView, invProj, invViewProj;
+	MatrixKernels::InverseViewProj(view, proj, invView, invProj, invViewProj);
 
 	XMMATRIX shadowTransform = XMLoadFloat4x4(&mShadowTransform);
 
@@ -344,8 +487,8 @@ void BaseApp::UpdateMainPassCB(const Timer& gt)
 	mMainPassCB.Lights[2].Direction = mRotatedLightDirections[2];
 	mMainPassCB.Lights[2].Strength = { 0.2f, 0.2f, 0.2f };
 
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	mMainPassAddress = mCurrFrameResource->Allocator->AllocateConstants(mMainPassCB).GpuAddress;
+	mUploadStats.PassConstants += sizeof(PassConstants);
 }
 
 void BaseApp::UpdateShadowPassCB(const Timer& gt)
@@ -354,12 +497,8 @@ void BaseApp::UpdateShadowPassCB(const Timer& gt)
 	XMMATRIX proj = XMLoadFloat4x4(&mLightProj);
 
 	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-	auto detView = XMMatrixDeterminant(view);
-	auto detProj = XMMatrixDeterminant(proj);
-	XMMATRIX invView = XMMatrixInverse(&detView, view);
-	XMMATRIX invProj = XMMatrixInverse(&detProj, proj);
-	auto detViewProj = XMMatrixDeterminant(viewProj);
-	XMMATRIX invViewProj = XMMatrixInverse(&detViewProj, viewProj);
+	XMMATRIX invView, invProj, invViewProj;
+	MatrixKernels::InverseViewProj(view, proj, invView, invProj, invViewProj);
 
 	UINT w = mShadowMap->Width();
 	UINT h = mShadowMap->Height();
@@ -376,33 +515,45 @@ void BaseApp::UpdateShadowPassCB(const Timer& gt)
 	mShadowPassCB.NearZ = mLightNearZ;
 	mShadowPassCB.FarZ = mLightFarZ;
 
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(1, mShadowPassCB);
+	mShadowPassAddress = mCurrFrameResource->Allocator->AllocateConstants(mShadowPassCB).GpuAddress;
+	mUploadStats.PassConstants += sizeof(PassConstants);
 }
 
-void BaseApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const vector<RenderItem*>& ritems)
+void BaseApp::QueueRenderItems(DrawQueue& queue, RenderLayer layer, ID3D12PipelineState* pso, CXMMATRIX view)
 {
-	UINT objCBByteSize = D3DUtil::CalcConstantBufferByteSize(sizeof(ObjectData));
+	for (auto ri : mRitemLayer[(int)layer])
+	{
+		const XMFLOAT4X4A& world = mTransforms.World(ri->Transform);
+		XMVECTOR position = XMVector3TransformCoord(XMVectorSet(world._41, world._42, world._43, 1.0f), view);
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
+		queue.Add((UINT)layer, pso, ri, XMVectorGetZ(position));
+	}
+}
 
-	for (size_t i = 0; i < ritems.size(); ++i)
-	{
-		auto ri = ritems[i];
+void BaseApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, DrawQueue& queue)
+{
+	queue.Sort();
 
-		auto vertexBufferView = ri->Geo->VertexBufferView();
-		auto indexBufferView = ri->Geo->IndexBufferView();
-		cmdList->IASetVertexBuffers(0, 1, &vertexBufferView);
-		cmdList->IASetIndexBuffer(&indexBufferView);
-		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+	auto allocator = mCurrFrameResource->Allocator.get();
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
+	const vector<UINT>& instances = queue.InstanceIndices();
+	auto instanceIndices = allocator->AllocateStructured(instances.data(), instances.size());
+	cmdList->SetGraphicsRootShaderResourceView(0, instanceIndices.GpuAddress);
 
-		cmdList->SetGraphicsRootShaderResourceView(0, objCBAddress);
-		// cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
+	const vector<IndirectDrawRecord>& records = queue.Records();
+	auto arguments = allocator->AllocateStructured(records.data(), records.size());
 
-		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
-	}
+	mUploadStats.InstanceIndices += instances.size() * sizeof(UINT);
+	mUploadStats.DrawArguments += records.size() * sizeof(IndirectDrawRecord);
+
+	D3D12DrawCommandList drawCmdList(cmdList);
+	DrawStats stats = queue.Submit(drawCmdList, mCommandSignature.Get(), arguments.Resource, arguments.Offset);
+
+	mDrawStats.Draws += stats.Draws;
+	mDrawStats.Instances += stats.Instances;
+	mDrawStats.IndirectCalls += stats.IndirectCalls;
+	mDrawStats.BindsIssued += stats.BindsIssued;
+	mDrawStats.BindsSaved += stats.BindsSaved;
 }
 
 void BaseApp::DrawSceneToShadowMap()
@@ -415,20 +566,18 @@ void BaseApp::DrawSceneToShadowMap()
 
 	mCommandList->ResourceBarrier(1, &toDepthWrite);
 
-	UINT passCBByteSize = D3DUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
-
 	mCommandList->ClearDepthStencilView(mShadowMap->Dsv(),
 		D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
 	mCommandList->OMSetRenderTargets(0, nullptr, false, &mShadowMap->Dsv());
 
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = passCB->GetGPUVirtualAddress() + 1 * passCBByteSize;
-	mCommandList->SetGraphicsRootConstantBufferView(1, passCBAddress);
+	mCommandList->SetGraphicsRootConstantBufferView(1, mShadowPassAddress);
 
-	mCommandList->SetPipelineState(mPSOs["shadow_opaque"].Get());
+	XMMATRIX lightView = XMLoadFloat4x4(&mLightView);
 
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+	mShadowDrawQueue.Clear();
+	QueueRenderItems(mShadowDrawQueue, RenderLayer::Opaque, mPSOs["shadow_opaque"].Get(), lightView);
+	DrawRenderItems(mCommandList.Get(), mShadowDrawQueue);
 
 	auto toGenericRead = CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
 		D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ);
@@ -438,14 +587,27 @@ void BaseApp::DrawSceneToShadowMap()
 
 void BaseApp::BuildWireFramePSOs()
 {
+	// Compiled in the background; until one is ready its solid state is drawn instead.
 	for (auto& desc : mPsoDescs)
 	{
 		auto psoDesc = desc.second;
 		psoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-		ComPtr<ID3D12PipelineState> wireframePSO;
-		ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&wireframePSO)));
-		mPSOs[desc.first + "_wireframe"] = wireframePSO;
+		mWireFramePsoKeys[desc.first] = mPipelineCache->Request(psoDesc);
+	}
+}
+
+ID3D12PipelineState* BaseApp::Pso(const string& name)
+{
+	ID3D12PipelineState* pso = mPSOs[name].Get();
+	if (mWireFrameMode)
+	{
+		auto it = mWireFramePsoKeys.find(name);
+		if (it != mWireFramePsoKeys.end())
+		{
+			pso = mPipelineCache->Find(it->second, pso);
+		}
 	}
+	return pso;
 }
 
 void BaseApp::EnableD3D12DebugLayer()
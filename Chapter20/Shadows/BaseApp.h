@@ -7,6 +7,15 @@
 #include "FrustumCulling.h"
 #include "CubeRenderTarget.h"
 #include "ShadowMap.h"
+#include "JobSystem.h"
+#include "TransformSystem.h"
+#include "MatrixKernels.h"
+#include "DrawQueue.h"
+#include "DescriptorHeap.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include "PipelineCache.h"
+#include <chrono>
 
 const UINT CubeMapSize = 512;
 
@@ -39,17 +48,39 @@ public:
 	void UpdateMainPassCB(const Timer& gt);
 	void UpdateShadowPassCB(const Timer& gt);
 
-	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const vector<RenderItem*>& ritems);
+	// Adds the visible items of a layer with their depth in the given view.
+	void QueueRenderItems(DrawQueue& queue, RenderLayer layer, ID3D12PipelineState* pso, CXMMATRIX view);
+	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, DrawQueue& queue);
 
 	void DrawSceneToShadowMap();
 
 	void BuildWireFramePSOs();
 
+	// The state registered under name, or its wireframe variant in wireframe mode once that is ready.
+	ID3D12PipelineState* Pso(const string& name);
+
 	void EnableD3D12DebugLayer();
 
 protected:
 	virtual void Build() {}
 
+	void BuildUpdateGraph();
+
+	// Creates the GPU buffers of a geometry from its CPU copies; records into mCommandList.
+	void UploadGeometry(unique_ptr<MeshGeometry> geo);
+
+	// Gives ritem a transform; every later change of its world matrix is written to the object buffer.
+	void AttachTransform(RenderItem* ritem, FXMMATRIX world, int parent = TransformSystem::None);
+
+	// Queues ritem for the object buffer of every frame resource, for changes other than its transform.
+	void MarkDirty(RenderItem* ritem);
+
+	void AddStartupPhase(const string& name, double milliseconds);
+	void AddStartupPhases(const TaskGraph& graph);
+	void ReportStartup();
+
+	virtual wstring FrameStatsText() const override;
+
 protected:
 	bool mWireFrameMode = false;
 
@@ -65,15 +96,19 @@ protected:
 	UINT texRootParameterIndex = 3;
 
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
+	ComPtr<ID3D12CommandSignature> mCommandSignature = nullptr;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	unique_ptr<DescriptorHeap> mSrvHeap = nullptr;
 
 	unordered_map<string, unique_ptr<MeshGeometry>> mGeometries;
 	unordered_map<string, unique_ptr<Texture>> mTextures;
 	unordered_map<string, unique_ptr<Material>> mMaterials;
+	unordered_map<string, unique_ptr<ShaderPermutations>> mShaderPermutations;
 	unordered_map<string, ComPtr<ID3DBlob>> mShaders;
 	unordered_map<string, ComPtr<ID3D12PipelineState>> mPSOs;
 	unordered_map<string, D3D12_GRAPHICS_PIPELINE_STATE_DESC> mPsoDescs;
+	unordered_map<string, uint64_t> mWireFramePsoKeys;
+	unique_ptr<PipelineCache> mPipelineCache = nullptr;
 
 	vector<D3D12_INPUT_ELEMENT_DESC> mStdInputLayout;
 
@@ -82,12 +117,21 @@ protected:
 	vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 	vector<Texture*> mTextureLayer[(int)TextureLayer::Count];
 
-	PassConstants mMainPassCB;
-	PassConstants mShadowPassCB;
+	PassConstants mMainPassCB = {};
+	PassConstants mShadowPassCB = {};
+
+	// Pass constants of the current frame, placed by its allocator.
+	D3D12_GPU_VIRTUAL_ADDRESS mMainPassAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS mShadowPassAddress = 0;
 
-	UINT mSkyTexHeapIndex = 0;
+	// gTextureMaps, one persistent table.
+	DescriptorRange mTextureTable;
 
-	CD3DX12_GPU_DESCRIPTOR_HANDLE mNullSrv;
+	// gCubeMap and gShadowMap: staged views copied into a transient table for the main pass, and
+	// null views in a persistent table for the shadow pass.
+	DescriptorRange mSkySrv;
+	DescriptorRange mShadowMapSrv;
+	DescriptorRange mNullSrvTable;
 
 	Camera mCamera;
 
@@ -114,5 +158,31 @@ protected:
 		XMFLOAT3(0.0f, -0.707f, -0.707f)
 	};
 	XMFLOAT3 mRotatedLightDirections[3];
+
+	// Per frame update stages, run as tasks on the job system. mUpdateTimer is only valid during Update.
+	TaskGraph mUpdateGraph;
+	const Timer* mUpdateTimer = nullptr;
+
+	DrawQueue mMainDrawQueue;
+	DrawQueue mShadowDrawQueue;
+
+	// Draws and binds of the last frame, both passes.
+	DrawStats mDrawStats;
+	UploadStats mUploadStats;
+
+	TransformSystem mTransforms;
+	vector<vector<RenderItem*>> mTransformRitems;
+
+	// Render items with NumFramesDirty > 0; only these are written to the object buffer.
+	vector<RenderItem*> mDirtyRitems;
+	vector<int> mDirtyTransforms;
+	vector<ObjectData> mDirtyObjects;
+
+	ShaderCache mShaderCache;
+
+	// Wall time of each startup phase, reported with the time to the first presented frame.
+	chrono::steady_clock::time_point mStartupTime;
+	vector<pair<string, double>> mStartupPhases;
+	bool mFirstFramePresented = false;
 };
 
@@ -559,7 +559,8 @@ void D3DApp::CalculateFrameStats()
 
 		wstring windowText = mMainWndCaption +
 			L"   fps: " + fpsStr +
-			L"  mspf: " + mspfStr;
+			L"  mspf: " + mspfStr +
+			FrameStatsText();
 
 		SetWindowText(mhMainWnd, windowText.c_str());
 
@@ -59,6 +59,8 @@ protected:
 	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView() const;
 
 	void CalculateFrameStats();
+	// Appended to the fps in the window caption.
+	virtual wstring FrameStatsText() const { return L""; }
 
 	void LogAdapters();
 	void LogAdapterOutputs(IDXGIAdapter* adapter);
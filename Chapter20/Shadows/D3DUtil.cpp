@@ -90,16 +90,22 @@ ComPtr<ID3D12Resource> D3DUtil::CreateDefaultBuffer(
 	return defaultBuffer;
 }
 
+UINT D3DUtil::ShaderCompileFlags()
+{
+	UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+	return compileFlags;
+}
+
 ComPtr<ID3DBlob> D3DUtil::CompileShader(
 	const wstring& filename,
 	const D3D_SHADER_MACRO* defines,
 	const string& entrypoint,
 	const string& target)
 {
-	UINT compileFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)
-	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
+	UINT compileFlags = ShaderCompileFlags();
 
 	HRESULT hr = S_OK;
 
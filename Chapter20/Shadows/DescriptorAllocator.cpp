@@ -0,0 +1,137 @@
+#include "DescriptorAllocator.h"
+#include <cassert>
+
+DescriptorFreeList::DescriptorFreeList(uint32_t first, uint32_t count)
+{
+	if (count > 0)
+	{
+		mFree[first] = count;
+		mFreeCount = count;
+	}
+}
+
+DescriptorRange DescriptorFreeList::Allocate(uint32_t count)
+{
+	DescriptorRange range;
+	if (count == 0)
+	{
+		return range;
+	}
+
+	for (auto it = mFree.begin(); it != mFree.end(); ++it)
+	{
+		if (it->second < count)
+		{
+			continue;
+		}
+
+		range.Index = it->first;
+		range.Count = count;
+
+		const uint32_t remaining = it->second - count;
+		mFree.erase(it);
+		if (remaining > 0)
+		{
+			mFree[range.Index + count] = remaining;
+		}
+
+		mFreeCount -= count;
+		break;
+	}
+
+	return range;
+}
+
+void DescriptorFreeList::Free(const DescriptorRange& range)
+{
+	if (!range.IsValid())
+	{
+		return;
+	}
+
+	uint32_t first = range.Index;
+	uint32_t count = range.Count;
+
+	auto next = mFree.lower_bound(first);
+	assert(next == mFree.end() || first + count <= next->first);
+
+	if (next != mFree.begin())
+	{
+		auto prev = std::prev(next);
+		assert(prev->first + prev->second <= first);
+
+		if (prev->first + prev->second == first)
+		{
+			first = prev->first;
+			count += prev->second;
+			mFree.erase(prev);
+		}
+	}
+
+	if (next != mFree.end() && next->first == range.Index + range.Count)
+	{
+		count += next->second;
+		mFree.erase(next);
+	}
+
+	mFree[first] = count;
+	mFreeCount += range.Count;
+}
+
+DescriptorRing::DescriptorRing(uint32_t first, uint32_t count) :
+	mFirst(first), mCount(count)
+{
+}
+
+DescriptorRange DescriptorRing::Allocate(uint32_t count)
+{
+	DescriptorRange range;
+	if (count == 0 || count > mCount)
+	{
+		return range;
+	}
+
+	uint32_t skipped = 0;
+	if (mHead + count > mCount)
+	{
+		skipped = mCount - mHead;
+	}
+
+	if (mUsed + skipped + count > mCount)
+	{
+		return range;
+	}
+
+	if (skipped > 0)
+	{
+		mHead = 0;
+	}
+
+	range.Index = mFirst + mHead;
+	range.Count = count;
+
+	mHead = (mHead + count) % mCount;
+	mUsed += skipped + count;
+	mFrameUsed += skipped + count;
+
+	return range;
+}
+
+void DescriptorRing::EndFrame(uint64_t fence)
+{
+	Frame frame;
+	frame.Fence = fence;
+	frame.Used = mFrameUsed;
+	mFrames.push_back(frame);
+
+	mFrameUsed = 0;
+}
+
+void DescriptorRing::Retire(uint64_t completedFence)
+{
+	while (!mFrames.empty() && mFrames.front().Fence <= completedFence)
+	{
+		mUsed -= mFrames.front().Used;
+		mFrames.pop_front();
+	}
+}
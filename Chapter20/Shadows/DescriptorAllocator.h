@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstdint>
+
+using namespace std;
+
+// Descriptors [Index, Index + Count) of a heap. An empty range is what a failed allocation returns.
+struct DescriptorRange
+{
+	uint32_t Index = 0;
+	uint32_t Count = 0;
+
+	bool IsValid() const { return Count > 0; }
+};
+
+// Long lived descriptors. Allocation takes the first free run that fits, freeing merges the run with
+// its free neighbours so the region does not fall apart into single slots.
+class DescriptorFreeList
+{
+public:
+	DescriptorFreeList() = default;
+	DescriptorFreeList(uint32_t first, uint32_t count);
+
+	DescriptorRange Allocate(uint32_t count);
+	void Free(const DescriptorRange& range);
+
+	uint32_t FreeCount() const { return mFreeCount; }
+
+private:
+	// First index of every free run to its length.
+	map<uint32_t, uint32_t> mFree;
+	uint32_t mFreeCount = 0;
+};
+
+// Descriptors that live for one frame. They are handed out in order and come back a frame at a time
+// once the fence that frame signalled has completed.
+class DescriptorRing
+{
+public:
+	DescriptorRing() = default;
+	DescriptorRing(uint32_t first, uint32_t count);
+
+	// Ranges never wrap; the slots left at the end of the ring are skipped and count as used.
+	DescriptorRange Allocate(uint32_t count);
+
+	// Everything allocated since the last call belongs to the frame that signals fence.
+	void EndFrame(uint64_t fence);
+	void Retire(uint64_t completedFence);
+
+	uint32_t UsedCount() const { return mUsed; }
+
+private:
+	struct Frame
+	{
+		uint64_t Fence = 0;
+		uint32_t Used = 0;
+	};
+
+	uint32_t mFirst = 0;
+	uint32_t mCount = 0;
+
+	uint32_t mHead = 0;
+	uint32_t mUsed = 0;
+	uint32_t mFrameUsed = 0;
+	deque<Frame> mFrames;
+};
@@ -0,0 +1,122 @@
+#include "DescriptorHeap.h"
+
+DescriptorHeap::DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+	UINT persistentCount, UINT transientCount, UINT stagingCount) :
+	md3dDevice(device), mType(type),
+	mPersistent(0, persistentCount),
+	mTransient(persistentCount, transientCount),
+	mStaging(0, stagingCount)
+{
+	mDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(mType);
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = persistentCount + transientCount;
+	heapDesc.Type = mType;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+	D3D12_DESCRIPTOR_HEAP_DESC stagingDesc = {};
+	stagingDesc.NumDescriptors = stagingCount;
+	stagingDesc.Type = mType;
+	stagingDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&stagingDesc, IID_PPV_ARGS(&mStagingHeap)));
+}
+
+DescriptorRange DescriptorHeap::AllocatePersistent(UINT count)
+{
+	DescriptorRange range = mPersistent.Allocate(count);
+	if (!range.IsValid())
+	{
+		ThrowIfFailed(E_OUTOFMEMORY);
+	}
+	return range;
+}
+
+void DescriptorHeap::FreePersistent(const DescriptorRange& range, UINT64 fence)
+{
+	mPendingFrees.push_back(make_pair(fence, range));
+}
+
+DescriptorRange DescriptorHeap::AllocateStaging(UINT count)
+{
+	DescriptorRange range = mStaging.Allocate(count);
+	if (!range.IsValid())
+	{
+		ThrowIfFailed(E_OUTOFMEMORY);
+	}
+	return range;
+}
+
+void DescriptorHeap::FreeStaging(const DescriptorRange& range)
+{
+	mStaging.Free(range);
+}
+
+DescriptorRange DescriptorHeap::AllocateTransient(UINT count)
+{
+	DescriptorRange range = mTransient.Allocate(count);
+	if (!range.IsValid())
+	{
+		ThrowIfFailed(E_OUTOFMEMORY);
+	}
+	return range;
+}
+
+DescriptorRange DescriptorHeap::CopyToTransient(const DescriptorRange* sources, UINT sourceCount)
+{
+	UINT count = 0;
+	for (UINT i = 0; i < sourceCount; ++i)
+	{
+		count += sources[i].Count;
+	}
+
+	DescriptorRange table = AllocateTransient(count);
+
+	UINT offset = 0;
+	for (UINT i = 0; i < sourceCount; ++i)
+	{
+		md3dDevice->CopyDescriptorsSimple(sources[i].Count, CpuHandle(table, offset), StagingHandle(sources[i]), mType);
+		offset += sources[i].Count;
+	}
+
+	return table;
+}
+
+void DescriptorHeap::EndFrame(UINT64 fence)
+{
+	mTransient.EndFrame(fence);
+}
+
+void DescriptorHeap::Retire(UINT64 completedFence)
+{
+	mTransient.Retire(completedFence);
+
+	for (size_t i = 0; i < mPendingFrees.size();)
+	{
+		if (mPendingFrees[i].first <= completedFence)
+		{
+			mPersistent.Free(mPendingFrees[i].second);
+			mPendingFrees[i] = mPendingFrees.back();
+			mPendingFrees.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::CpuHandle(const DescriptorRange& range, UINT offset) const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), range.Index + offset, mDescriptorSize);
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GpuHandle(const DescriptorRange& range, UINT offset) const
+{
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), range.Index + offset, mDescriptorSize);
+}
+
+CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::StagingHandle(const DescriptorRange& range, UINT offset) const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(mStagingHeap->GetCPUDescriptorHandleForHeapStart(), range.Index + offset, mDescriptorSize);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include "DescriptorAllocator.h"
+
+// A shader visible heap split into a persistent region and a transient ring, with a CPU only staging
+// heap next to it. Views that are combined differently from frame to frame are created in staging and
+// copied into transient tables in bulk.
+class DescriptorHeap
+{
+public:
+	DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+		UINT persistentCount, UINT transientCount, UINT stagingCount);
+	DescriptorHeap(const DescriptorHeap& rhs) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+	~DescriptorHeap() = default;
+
+	ID3D12DescriptorHeap* Heap() const { return mHeap.Get(); }
+
+	DescriptorRange AllocatePersistent(UINT count);
+
+	// The GPU may still read the descriptors, they are reused after fence has completed.
+	void FreePersistent(const DescriptorRange& range, UINT64 fence);
+
+	DescriptorRange AllocateStaging(UINT count);
+	void FreeStaging(const DescriptorRange& range);
+
+	DescriptorRange AllocateTransient(UINT count);
+
+	// Copies the staged sources one after another into a new transient range.
+	DescriptorRange CopyToTransient(const DescriptorRange* sources, UINT sourceCount);
+
+	// Transient descriptors allocated since the last call are used by the frame signalling fence.
+	void EndFrame(UINT64 fence);
+	void Retire(UINT64 completedFence);
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE CpuHandle(const DescriptorRange& range, UINT offset = 0) const;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GpuHandle(const DescriptorRange& range, UINT offset = 0) const;
+	CD3DX12_CPU_DESCRIPTOR_HANDLE StagingHandle(const DescriptorRange& range, UINT offset = 0) const;
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	D3D12_DESCRIPTOR_HEAP_TYPE mType;
+	UINT mDescriptorSize = 0;
+
+	ComPtr<ID3D12DescriptorHeap> mHeap = nullptr;
+	ComPtr<ID3D12DescriptorHeap> mStagingHeap = nullptr;
+
+	DescriptorFreeList mPersistent;
+	DescriptorRing mTransient;
+	DescriptorFreeList mStaging;
+
+	vector<pair<UINT64, DescriptorRange>> mPendingFrees;
+};
@@ -0,0 +1,327 @@
+#include "DrawQueue.h"
+#include "JobSystem.h"
+#include <cstring>
+
+namespace
+{
+	const int LayerBits = 4;
+	const int PsoBits = 8;
+	const int GeometryBits = 10;
+	const int SubmeshBits = 10;
+	const int MaterialBits = 12;
+	const int DepthBits = 20;
+
+	// Items whose keys agree above these bits share a draw.
+	const int BatchShift = MaterialBits + DepthBits;
+
+	const int RadixBits = 8;
+	const int Buckets = 1 << RadixBits;
+
+	// Below this the passes are cheaper than handing them out.
+	const int ParallelSortSize = 4096;
+
+	uint64_t Field(UINT value, int bits)
+	{
+		return (uint64_t)min(value, (1u << bits) - 1);
+	}
+
+	// Positive floats sort like their bit patterns, the top bits are enough for ordering.
+	UINT QuantizeDepth(float depth)
+	{
+		depth = max(depth, 0.0f);
+
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(bits));
+		return bits >> (32 - DepthBits);
+	}
+}
+
+void DrawStateRecorder::SetPipelineState(ID3D12PipelineState* pso)
+{
+	if (pso == mPso)
+	{
+		mStats.BindsSaved++;
+		return;
+	}
+
+	mCmdList.SetPipelineState(pso);
+	mPso = pso;
+	mStats.BindsIssued++;
+}
+
+void DrawStateRecorder::SetGeometry(const MeshGeometry* geo)
+{
+	// Vertex and index buffer always change together.
+	if (geo == mGeo)
+	{
+		mStats.BindsSaved += 2;
+		return;
+	}
+
+	mCmdList.IASetVertexBuffer(geo->VertexBufferView());
+	mCmdList.IASetIndexBuffer(geo->IndexBufferView());
+	mGeo = geo;
+	mStats.BindsIssued += 2;
+}
+
+void DrawStateRecorder::SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+	if (topology == mTopology)
+	{
+		mStats.BindsSaved++;
+		return;
+	}
+
+	mCmdList.IASetPrimitiveTopology(topology);
+	mTopology = topology;
+	mStats.BindsIssued++;
+}
+
+void DrawStateRecorder::ExecuteIndirect(ID3D12CommandSignature* signature, const IndirectDrawRecord* records, UINT recordCount,
+	ID3D12Resource* arguments, UINT64 argumentOffset)
+{
+	mCmdList.ExecuteIndirect(signature, recordCount, arguments, argumentOffset);
+	mStats.IndirectCalls++;
+	mStats.Draws += recordCount;
+
+	for (UINT i = 0; i < recordCount; ++i)
+	{
+		mStats.Instances += records[i].Draw.InstanceCount;
+	}
+}
+
+uint64_t DrawQueue::MakeKey(UINT layer, UINT pso, UINT geometry, UINT submesh, UINT material, float depth)
+{
+	uint64_t key = Field(layer, LayerBits);
+	key = (key << PsoBits) | Field(pso, PsoBits);
+	key = (key << GeometryBits) | Field(geometry, GeometryBits);
+	key = (key << SubmeshBits) | Field(submesh, SubmeshBits);
+	key = (key << MaterialBits) | Field(material, MaterialBits);
+	key = (key << DepthBits) | QuantizeDepth(depth);
+	return key;
+}
+
+void DrawQueue::RadixSort(vector<uint64_t>& keys, vector<UINT>& values)
+{
+	const int count = (int)keys.size();
+	assert(values.size() == keys.size());
+
+	vector<uint64_t> keysTemp(count);
+	vector<UINT> valuesTemp(count);
+
+	JobSystem& jobs = JobSystem::GetInstance();
+	const int blockCount = count >= ParallelSortSize ? max(1, jobs.WorkerCount() * 4) : 1;
+	const int blockSize = (count + blockCount - 1) / blockCount;
+
+	vector<UINT> histograms(blockCount * Buckets);
+
+	// Bytes in which all keys agree would leave the order untouched, skip them.
+	uint64_t differing = 0;
+	for (int i = 1; i < count; ++i)
+	{
+		differing |= keys[i] ^ keys[0];
+	}
+
+	for (int shift = 0; shift < 64; shift += RadixBits)
+	{
+		if (((differing >> shift) & (Buckets - 1)) == 0)
+		{
+			continue;
+		}
+
+		auto countBlock = [&](int block)
+			{
+				UINT* histogram = histograms.data() + block * Buckets;
+				fill(histogram, histogram + Buckets, 0);
+
+				const int end = min(count, (block + 1) * blockSize);
+				for (int i = block * blockSize; i < end; ++i)
+				{
+					histogram[(keys[i] >> shift) & (Buckets - 1)]++;
+				}
+			};
+
+		// Each block writes to its own range of every bucket, blocks in order, which keeps it stable.
+		auto scatterBlock = [&](int block)
+			{
+				UINT* offsets = histograms.data() + block * Buckets;
+
+				const int end = min(count, (block + 1) * blockSize);
+				for (int i = block * blockSize; i < end; ++i)
+				{
+					UINT dst = offsets[(keys[i] >> shift) & (Buckets - 1)]++;
+					keysTemp[dst] = keys[i];
+					valuesTemp[dst] = values[i];
+				}
+			};
+
+		if (blockCount > 1)
+		{
+			jobs.ParallelFor(0, blockCount, countBlock);
+		}
+		else
+		{
+			countBlock(0);
+		}
+
+		UINT offset = 0;
+		for (int bucket = 0; bucket < Buckets; ++bucket)
+		{
+			for (int block = 0; block < blockCount; ++block)
+			{
+				UINT& slot = histograms[block * Buckets + bucket];
+				UINT n = slot;
+				slot = offset;
+				offset += n;
+			}
+		}
+
+		if (blockCount > 1)
+		{
+			jobs.ParallelFor(0, blockCount, scatterBlock);
+		}
+		else
+		{
+			scatterBlock(0);
+		}
+
+		keys.swap(keysTemp);
+		values.swap(valuesTemp);
+	}
+}
+
+void DrawQueue::Clear()
+{
+	mItems.clear();
+	mKeys.clear();
+	mOrder.clear();
+	mDrawItems.clear();
+	mIndirect.Clear();
+}
+
+void DrawQueue::Add(UINT layer, ID3D12PipelineState* pso, RenderItem* ritem, float depth)
+{
+	Item item;
+	item.Pso = pso;
+	item.Ritem = ritem;
+
+	mKeys.push_back(MakeKey(layer, PsoId(pso), GeometryId(ritem->Geo), SubmeshId(ritem), ritem->Mat->MatCBIndex, depth));
+	mOrder.push_back((UINT)mItems.size());
+	mItems.push_back(item);
+}
+
+void DrawQueue::Sort()
+{
+	RadixSort(mKeys, mOrder);
+
+	mDrawItems.clear();
+	mIndirect.Clear();
+
+	for (size_t i = 0; i < mOrder.size(); ++i)
+	{
+		const RenderItem* ri = mItems[mOrder[i]].Ritem;
+
+		// Ids saturate once a field is full, so the key alone could merge different PSOs or submeshes.
+		bool sameDraw = false;
+		if (!mDrawItems.empty())
+		{
+			const RenderItem* first = mItems[mDrawItems.back()].Ritem;
+			sameDraw = (mKeys[i] >> BatchShift) == (mKeys[i - 1] >> BatchShift) &&
+				mItems[mOrder[i]].Pso == mItems[mDrawItems.back()].Pso &&
+				ri->Geo == first->Geo &&
+				ri->IndexCount == first->IndexCount &&
+				ri->StartIndexLocation == first->StartIndexLocation &&
+				ri->BaseVertexLocation == first->BaseVertexLocation &&
+				ri->PrimitiveType == first->PrimitiveType;
+		}
+
+		if (!sameDraw)
+		{
+			mDrawItems.push_back(mOrder[i]);
+			mIndirect.AddDraw(ri->IndexCount, ri->StartIndexLocation, ri->BaseVertexLocation);
+		}
+
+		mIndirect.AddInstance(ri->ObjCBIndex, ri->Visible);
+	}
+
+	mIndirect.Compact();
+}
+
+DrawStats DrawQueue::Submit(DrawCommandList& cmdList, ID3D12CommandSignature* signature,
+	ID3D12Resource* arguments, UINT64 argumentOffset) const
+{
+	DrawStateRecorder recorder(cmdList);
+
+	const vector<IndirectDrawRecord>& records = mIndirect.Records();
+	const vector<UINT>& recordDraws = mIndirect.RecordDraws();
+
+	// The arguments cannot change the PSO or the input assembler, so a run ends where one of them does.
+	for (size_t begin = 0; begin < records.size();)
+	{
+		const Item& item = mItems[mDrawItems[recordDraws[begin]]];
+		const RenderItem* ri = item.Ritem;
+
+		size_t end = begin + 1;
+		while (end < records.size())
+		{
+			const Item& next = mItems[mDrawItems[recordDraws[end]]];
+			if (next.Pso != item.Pso || next.Ritem->Geo != ri->Geo || next.Ritem->PrimitiveType != ri->PrimitiveType)
+			{
+				break;
+			}
+			++end;
+		}
+
+		recorder.SetPipelineState(item.Pso);
+		recorder.SetGeometry(ri->Geo);
+		recorder.SetPrimitiveTopology(ri->PrimitiveType);
+		recorder.ExecuteIndirect(signature, &records[begin], (UINT)(end - begin),
+			arguments, argumentOffset + begin * sizeof(IndirectDrawRecord));
+
+		begin = end;
+	}
+
+	return recorder.Stats();
+}
+
+UINT DrawQueue::PsoId(ID3D12PipelineState* pso)
+{
+	for (size_t i = 0; i < mPsos.size(); ++i)
+	{
+		if (mPsos[i] == pso)
+		{
+			return (UINT)i;
+		}
+	}
+
+	mPsos.push_back(pso);
+	return (UINT)mPsos.size() - 1;
+}
+
+UINT DrawQueue::SubmeshId(const RenderItem* ritem)
+{
+	auto submesh = make_tuple((const MeshGeometry*)ritem->Geo, ritem->IndexCount, ritem->StartIndexLocation, ritem->BaseVertexLocation);
+
+	auto it = mSubmeshIds.find(submesh);
+	if (it != mSubmeshIds.end())
+	{
+		return it->second;
+	}
+
+	UINT id = (UINT)mSubmeshIds.size();
+	mSubmeshIds[submesh] = id;
+	return id;
+}
+
+UINT DrawQueue::GeometryId(const MeshGeometry* geo)
+{
+	auto it = mGeometryIds.find(geo);
+	if (it != mGeometryIds.end())
+	{
+		return it->second;
+	}
+
+	UINT id = (UINT)mGeometryIds.size();
+	mGeometryIds[geo] = id;
+	return id;
+}
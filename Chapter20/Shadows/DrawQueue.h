@@ -0,0 +1,134 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include "RenderItem.h"
+#include "IndirectDrawBuilder.h"
+#include <map>
+#include <tuple>
+
+// The commands DrawQueue submits. D3D12DrawCommandList forwards them to a real command list; any
+// other implementation can record them, so sorting and bind elimination can be checked on the CPU.
+class DrawCommandList
+{
+public:
+	virtual ~DrawCommandList() = default;
+
+	virtual void SetPipelineState(ID3D12PipelineState* pso) = 0;
+	virtual void IASetVertexBuffer(const D3D12_VERTEX_BUFFER_VIEW& view) = 0;
+	virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view) = 0;
+	virtual void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) = 0;
+	virtual void ExecuteIndirect(ID3D12CommandSignature* signature, UINT commandCount, ID3D12Resource* arguments, UINT64 argumentOffset) = 0;
+};
+
+class D3D12DrawCommandList : public DrawCommandList
+{
+public:
+	D3D12DrawCommandList(ID3D12GraphicsCommandList* cmdList) : mCmdList(cmdList) {}
+
+	virtual void SetPipelineState(ID3D12PipelineState* pso) override { mCmdList->SetPipelineState(pso); }
+	virtual void IASetVertexBuffer(const D3D12_VERTEX_BUFFER_VIEW& view) override { mCmdList->IASetVertexBuffers(0, 1, &view); }
+	virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view) override { mCmdList->IASetIndexBuffer(&view); }
+	virtual void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override { mCmdList->IASetPrimitiveTopology(topology); }
+
+	virtual void ExecuteIndirect(ID3D12CommandSignature* signature, UINT commandCount, ID3D12Resource* arguments, UINT64 argumentOffset) override
+	{
+		mCmdList->ExecuteIndirect(signature, commandCount, arguments, argumentOffset, nullptr, 0);
+	}
+
+private:
+	ID3D12GraphicsCommandList* mCmdList = nullptr;
+};
+
+struct DrawStats
+{
+	UINT Draws = 0;
+	UINT Instances = 0;
+	UINT IndirectCalls = 0;
+	UINT BindsIssued = 0;
+	UINT BindsSaved = 0;
+};
+
+// Sits in front of a DrawCommandList and drops every bind that would set the state already bound.
+class DrawStateRecorder
+{
+public:
+	DrawStateRecorder(DrawCommandList& cmdList) : mCmdList(cmdList) {}
+
+	void SetPipelineState(ID3D12PipelineState* pso);
+	void SetGeometry(const MeshGeometry* geo);
+	void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology);
+	void ExecuteIndirect(ID3D12CommandSignature* signature, const IndirectDrawRecord* records, UINT recordCount,
+		ID3D12Resource* arguments, UINT64 argumentOffset);
+
+	const DrawStats& Stats() const { return mStats; }
+
+private:
+	DrawCommandList& mCmdList;
+	DrawStats mStats;
+
+	ID3D12PipelineState* mPso = nullptr;
+	const MeshGeometry* mGeo = nullptr;
+	D3D12_PRIMITIVE_TOPOLOGY mTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+};
+
+// Render items of one pass, sorted by a 64 bit key before submission so draws sharing state end up
+// next to each other. Items with the same layer, PSO and submesh become one instanced draw; the
+// shaders find the object data of each instance through a list of object indices. Draws go out as
+// indirect records, one ExecuteIndirect per run of draws with the same PSO and geometry.
+class DrawQueue
+{
+public:
+	// From the most to the least significant bits: layer 4, PSO 8, geometry 10, submesh 10, material 12
+	// and depth 20. Materials come from the object data and cost no bind, so they only order the
+	// instances of a draw.
+	static uint64_t MakeKey(UINT layer, UINT pso, UINT geometry, UINT submesh, UINT material, float depth);
+
+	// Stable sort of keys with their values, split across the job system for large inputs.
+	static void RadixSort(vector<uint64_t>& keys, vector<UINT>& values);
+
+	void Clear();
+
+	// depth is the view space depth of the item; opaque layers draw front to back. Items that are not
+	// Visible keep their place in the order and are only left out of the records.
+	void Add(UINT layer, ID3D12PipelineState* pso, RenderItem* ritem, float depth);
+
+	// Sorts the items, groups them into draws and builds the records of the visible instances.
+	void Sort();
+
+	// ObjCBIndex of every visible item in draw order and the records drawing them, valid after Sort.
+	// Both have to be uploaded before Submit, the record offsets are relative to the instance list.
+	const vector<UINT>& InstanceIndices() const { return mIndirect.Instances(); }
+	const vector<IndirectDrawRecord>& Records() const { return mIndirect.Records(); }
+
+	// arguments holds Records at argumentOffset.
+	DrawStats Submit(DrawCommandList& cmdList, ID3D12CommandSignature* signature,
+		ID3D12Resource* arguments, UINT64 argumentOffset) const;
+
+	size_t Size() const { return mItems.size(); }
+	size_t DrawCount() const { return mIndirect.Records().size(); }
+
+private:
+	UINT PsoId(ID3D12PipelineState* pso);
+	UINT GeometryId(const MeshGeometry* geo);
+	UINT SubmeshId(const RenderItem* ritem);
+
+private:
+	struct Item
+	{
+		ID3D12PipelineState* Pso = nullptr;
+		RenderItem* Ritem = nullptr;
+	};
+
+	vector<Item> mItems;
+	vector<uint64_t> mKeys;
+	vector<UINT> mOrder;
+
+	// First item of every draw, in the order the draws were added to mIndirect.
+	vector<UINT> mDrawItems;
+	IndirectDrawBuilder mIndirect;
+
+	// Ids are handed out on first use and kept, so keys stay comparable from frame to frame.
+	vector<ID3D12PipelineState*> mPsos;
+	unordered_map<const MeshGeometry*, UINT> mGeometryIds;
+	map<tuple<const MeshGeometry*, UINT, UINT, INT>, UINT> mSubmeshIds;
+};
@@ -1,16 +1,39 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT objectCount, UINT materialCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
         IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
-    PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
     MaterialBuffer = std::make_unique<UploadBuffer<MaterialData>>(device, materialCount, false);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectData>>(device, objectCount, true);
+    ObjectCB = std::make_unique<UploadBuffer<ObjectData>>(device, objectCount, false);
+    Allocator = std::make_unique<LinearAllocator>(device);
 }
 
 FrameResource::~FrameResource()
 {
-}
\ No newline at end of file
+}
+void PackObjectData(FXMMATRIX world, CXMMATRIX texTransform, UINT materialIndex, ObjectData& data)
+{
+    XMMATRIX worldT = XMMatrixTranspose(world);
+    XMStoreFloat4(&data.World[0], worldT.r[0]);
+    XMStoreFloat4(&data.World[1], worldT.r[1]);
+    XMStoreFloat4(&data.World[2], worldT.r[2]);
+
+    PackObjectTexture(texTransform, materialIndex, data);
+}
+
+void PackObjectTexture(CXMMATRIX texTransform, UINT materialIndex, ObjectData& data)
+{
+    // Row vectors: u' = u * _11 + _41 and v' = v * _22 + _42.
+    XMVECTOR scale = XMVectorSelect(texTransform.r[1], texTransform.r[0], g_XMSelect1000);
+    XMVECTOR scaleOffset = XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_0Y, XM_PERMUTE_1X, XM_PERMUTE_1Y>(scale, texTransform.r[3]);
+
+    PackedVector::XMHALF4 half;
+    PackedVector::XMStoreHalf4(&half, scaleOffset);
+    data.TexScaleOffset = XMUINT2(half.x | ((UINT)half.y << 16), half.z | ((UINT)half.w << 16));
+
+    data.MaterialIndex = materialIndex;
+    data.ObjPad0 = 0;
+}
@@ -3,58 +3,9 @@
 #include "D3DUtil.h"
 #include "MathHelper.h"
 #include "UploadBuffer.h"
-
-struct ObjectData
-{
-	XMFLOAT4X4 World = MathHelper::Identity4x4();
-	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
-	UINT MaterialIndex = 0;
-	UINT ObjPad0;
-	UINT ObjPad1;
-	UINT ObjPad2;
-};
-
-struct PassConstants
-{
-	XMFLOAT4X4 View = MathHelper::Identity4x4();
-	XMFLOAT4X4 InvView = MathHelper::Identity4x4();
-	XMFLOAT4X4 Proj = MathHelper::Identity4x4();
-	XMFLOAT4X4 InvProj = MathHelper::Identity4x4();
-	XMFLOAT4X4 ViewProj = MathHelper::Identity4x4();
-	XMFLOAT4X4 InvViewProj = MathHelper::Identity4x4();
-	XMFLOAT4X4 ShadowTransform = MathHelper::Identity4x4();
-	XMFLOAT3 EyePosW = { 0.0f, 0.0f, 0.0f };
-	float cbPerObjectPad1 = 0.0f;
-	XMFLOAT2 RenderTargetSize = { 0.0f, 0.0f };
-	XMFLOAT2 InvRenderTargetSize = { 0.0f, 0.0f };
-	float NearZ = 0.0f;
-	float FarZ = 0.0f;
-	float TotalTime = 0.0f;
-	float DeltaTime = 0.0f;
-
-	XMFLOAT4 AmbientLight = { 0.0f, 0.0f, 0.0f, 1.0f };
-
-// 	XMFLOAT4 FogColor = { 0.7f, 0.7f, 0.7f, 1.0f };
-// 	float gFogStart = 5.0f;
-// 	float gFogRange = 150.0f;
-// 	XMFLOAT2 cbPerObjectPad2;
-
-	Light Lights[MaxLights];
-};
-
-struct MaterialData
-{
-	XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
-	XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
-	float Roughness = 64.0f;
-
-	XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
-
-	UINT DiffuseMapIndex = 0;
-	UINT NormalMapIndex = 0;
-	UINT MaterialPad1;
-	UINT MaterialPad2;
-};
+#include "LinearAllocator.h"
+#include "ShaderLayout.h"
+#include <atomic>
 
 struct Vertex
 {
@@ -83,18 +34,52 @@ struct PointVertex
 	XMFLOAT2 Size;
 };
 
+// Packs an object for the shaders: the world matrix as three transposed rows and the texture
+// transform as half precision scale and offset. Rotation or shear in texTransform is dropped.
+void PackObjectData(FXMMATRIX world, CXMMATRIX texTransform, UINT materialIndex, ObjectData& data);
+
+// Everything but the world rows, for objects whose rows are written in a batch.
+void PackObjectTexture(CXMMATRIX texTransform, UINT materialIndex, ObjectData& data);
+
+// Bytes written for the GPU during the last frame, per layout. The update stages fill it concurrently.
+struct UploadStats
+{
+	atomic<UINT64> PassConstants{ 0 };
+	atomic<UINT64> ObjectData{ 0 };
+	atomic<UINT64> MaterialData{ 0 };
+	atomic<UINT64> InstanceIndices{ 0 };
+	atomic<UINT64> DrawArguments{ 0 };
+
+	void Reset()
+	{
+		PassConstants = 0;
+		ObjectData = 0;
+		MaterialData = 0;
+		InstanceIndices = 0;
+		DrawArguments = 0;
+	}
+
+	UINT64 Total() const
+	{
+		return PassConstants + ObjectData + MaterialData + InstanceIndices + DrawArguments;
+	}
+};
+
 struct FrameResource
 {
-	FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
+	FrameResource(ID3D12Device* device, UINT objectCount, UINT materialCount);
 	FrameResource(const FrameResource& rhs) = delete;
 	FrameResource& operator=(const FrameResource& rhs) = delete;
 	~FrameResource();
 
 	ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
-	unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
+	// Object and material data persist from frame to frame and are only rewritten when they change.
 	unique_ptr<UploadBuffer<ObjectData>> ObjectCB = nullptr;
 	unique_ptr<UploadBuffer<MaterialData>> MaterialBuffer = nullptr;
 
+	// Everything rebuilt each frame: pass constants, instance indices and indirect arguments.
+	unique_ptr<LinearAllocator> Allocator = nullptr;
+
 	UINT64 Fence = 0;
 };
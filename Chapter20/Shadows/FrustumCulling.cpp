@@ -7,19 +7,22 @@ void FrustumCulling::UpdateCameraFrustum(const Camera& camera)
 
 void FrustumCulling::CullRenderItems(const Camera& camera, const RenderItem* ritem, vector<ObjectData>& visibleRitems)
 {
-	XMMATRIX view = camera.GetView();
-	auto detView = XMMatrixDeterminant(view);
-	XMMATRIX invView = XMMatrixInverse(&detView, view);
+	XMMATRIX invView = MatrixKernels::InverseRigid(camera.GetView());
 
 	const auto& instanceData = ritem->Instances;
+	if (instanceData.empty())
+	{
+		return;
+	}
+
+	mInvWorld.resize(instanceData.size());
+	MatrixKernels::InverseAffine(&instanceData[0].World, sizeof(Instance), mInvWorld.data(), sizeof(XMFLOAT4X4), instanceData.size());
 
 	for (UINT i = 0; i < (UINT)instanceData.size(); ++i)
 	{
 		XMMATRIX world = XMLoadFloat4x4(&instanceData[i].World);
 		XMMATRIX texTransform = XMLoadFloat4x4(&instanceData[i].TexTransform);
-
-		auto detWorld = XMMatrixDeterminant(world);
-		XMMATRIX invWorld = XMMatrixInverse(&detWorld, world);
+		XMMATRIX invWorld = XMLoadFloat4x4(&mInvWorld[i]);
 
 		XMMATRIX viewToLocal = XMMatrixMultiply(invView, invWorld);
 
@@ -29,8 +32,7 @@ void FrustumCulling::CullRenderItems(const Camera& camera, const RenderItem* rit
 		if ((localSpaceFrustum.Contains(ritem->Bounds) != DISJOINT) || !mFrustumCullingEnabled)
 		{
 			ObjectData data;
-			XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
+			PackObjectData(world, texTransform, instanceData[i].MaterialIndex, data);
 			visibleRitems.push_back(data);
 		}
 	}
@@ -3,6 +3,7 @@
 #include "Camera.h"
 #include "RenderItem.h"
 #include "FrameResource.h"
+#include "MatrixKernels.h"
 
 class FrustumCulling
 {
@@ -14,4 +15,6 @@ public:
 private:
 	BoundingFrustum mCameraFrustum;
 	bool mFrustumCullingEnabled = true;
+
+	vector<XMFLOAT4X4> mInvWorld;
 };
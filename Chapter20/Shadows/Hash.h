@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+const uint64_t FnvOffset = 14695981039346656037ull;
+const uint64_t FnvPrime = 1099511628211ull;
+
+// FNV-1a, continuing from hash. Used for cache keys, where it only has to be stable between runs.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = FnvOffset)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * FnvPrime;
+	}
+	return hash;
+}
@@ -0,0 +1,170 @@
+#include "IndirectDrawBuilder.h"
+#include "JobSystem.h"
+
+namespace
+{
+	// Below this one pass over the flags is cheaper than handing out blocks.
+	const int ParallelCompactSize = 4096;
+}
+
+ComPtr<ID3D12CommandSignature> IndirectDrawBuilder::CreateCommandSignature(ID3D12Device* device,
+	ID3D12RootSignature* rootSignature, UINT rootParameterIndex)
+{
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[2] = {};
+	arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	arguments[0].Constant.RootParameterIndex = rootParameterIndex;
+	arguments[0].Constant.DestOffsetIn32BitValues = 0;
+	arguments[0].Constant.Num32BitValuesToSet = 1;
+	arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC desc = {};
+	desc.ByteStride = sizeof(IndirectDrawRecord);
+	desc.NumArgumentDescs = _countof(arguments);
+	desc.pArgumentDescs = arguments;
+
+	ComPtr<ID3D12CommandSignature> signature;
+	ThrowIfFailed(device->CreateCommandSignature(&desc, rootSignature, IID_PPV_ARGS(&signature)));
+	return signature;
+}
+
+void IndirectDrawBuilder::Clear()
+{
+	mDraws.clear();
+	mObjectIndices.clear();
+	mVisible.clear();
+	mRecords.clear();
+	mRecordDraws.clear();
+	mInstances.clear();
+}
+
+void IndirectDrawBuilder::AddDraw(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation)
+{
+	Draw draw;
+	draw.IndexCount = indexCount;
+	draw.StartIndexLocation = startIndexLocation;
+	draw.BaseVertexLocation = baseVertexLocation;
+	draw.FirstInstance = (UINT)mObjectIndices.size();
+	mDraws.push_back(draw);
+}
+
+void IndirectDrawBuilder::AddInstance(UINT objectIndex, bool visible)
+{
+	assert(!mDraws.empty());
+
+	mObjectIndices.push_back(objectIndex);
+	mVisible.push_back(visible ? 1 : 0);
+}
+
+void IndirectDrawBuilder::Compact()
+{
+	const int count = (int)mObjectIndices.size();
+
+	JobSystem& jobs = JobSystem::GetInstance();
+	const int blockCount = count >= ParallelCompactSize ? max(1, jobs.WorkerCount() * 4) : 1;
+	const int blockSize = (count + blockCount - 1) / blockCount;
+
+	mSlots.resize(count + 1);
+	mBlockSums.assign(blockCount + 1, 0);
+
+	// Exclusive prefix sum of the flags: count each block, scan the block totals, then scan inside
+	// the blocks starting from their offset.
+	auto countBlock = [&](int block)
+		{
+			const int end = min(count, (block + 1) * blockSize);
+
+			UINT sum = 0;
+			for (int i = block * blockSize; i < end; ++i)
+			{
+				sum += mVisible[i];
+			}
+			mBlockSums[block + 1] = sum;
+		};
+
+	auto scanBlock = [&](int block)
+		{
+			const int end = min(count, (block + 1) * blockSize);
+
+			UINT slot = mBlockSums[block];
+			for (int i = block * blockSize; i < end; ++i)
+			{
+				mSlots[i] = slot;
+				slot += mVisible[i];
+			}
+		};
+
+	auto scatterBlock = [&](int block)
+		{
+			const int end = min(count, (block + 1) * blockSize);
+
+			for (int i = block * blockSize; i < end; ++i)
+			{
+				if (mVisible[i])
+				{
+					mInstances[mSlots[i]] = mObjectIndices[i];
+				}
+			}
+		};
+
+	if (blockCount > 1)
+	{
+		jobs.ParallelFor(0, blockCount, countBlock);
+	}
+	else
+	{
+		countBlock(0);
+	}
+
+	for (int block = 0; block < blockCount; ++block)
+	{
+		mBlockSums[block + 1] += mBlockSums[block];
+	}
+	mSlots[count] = mBlockSums[blockCount];
+
+	if (blockCount > 1)
+	{
+		jobs.ParallelFor(0, blockCount, scanBlock);
+	}
+	else
+	{
+		scanBlock(0);
+	}
+
+	mInstances.resize(mSlots[count]);
+
+	if (blockCount > 1)
+	{
+		jobs.ParallelFor(0, blockCount, scatterBlock);
+	}
+	else
+	{
+		scatterBlock(0);
+	}
+
+	// Compaction keeps the order, so the visible instances of a draw stay next to each other.
+	mRecords.clear();
+	mRecordDraws.clear();
+
+	for (size_t i = 0; i < mDraws.size(); ++i)
+	{
+		const Draw& draw = mDraws[i];
+		const UINT end = i + 1 < mDraws.size() ? mDraws[i + 1].FirstInstance : (UINT)count;
+
+		const UINT first = mSlots[draw.FirstInstance];
+		const UINT visibleCount = mSlots[end] - first;
+		if (visibleCount == 0)
+		{
+			continue;
+		}
+
+		IndirectDrawRecord record;
+		record.FirstInstance = first;
+		record.Draw.IndexCountPerInstance = draw.IndexCount;
+		record.Draw.InstanceCount = visibleCount;
+		record.Draw.StartIndexLocation = draw.StartIndexLocation;
+		record.Draw.BaseVertexLocation = draw.BaseVertexLocation;
+		record.Draw.StartInstanceLocation = 0;
+
+		mRecords.push_back(record);
+		mRecordDraws.push_back((UINT)i);
+	}
+}
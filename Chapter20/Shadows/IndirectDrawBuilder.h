@@ -0,0 +1,58 @@
+#pragma once
+
+#include "D3DUtil.h"
+
+// One command of the indirect argument buffer: the root constant telling the shaders where the
+// object indices of the draw start, followed by the draw itself.
+struct IndirectDrawRecord
+{
+	UINT FirstInstance = 0;
+	D3D12_DRAW_INDEXED_ARGUMENTS Draw = {};
+};
+
+// Turns draws with their instances into packed indirect records. Compact works like the compaction
+// pass of a GPU culling shader: a prefix sum over the visibility of the instances gives every visible
+// instance its slot, and draws left without instances are dropped.
+class IndirectDrawBuilder
+{
+public:
+	// Command signature matching IndirectDrawRecord, FirstInstance goes to rootParameterIndex.
+	static ComPtr<ID3D12CommandSignature> CreateCommandSignature(ID3D12Device* device,
+		ID3D12RootSignature* rootSignature, UINT rootParameterIndex);
+
+	void Clear();
+
+	// Instances added afterwards belong to this draw.
+	void AddDraw(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation);
+	void AddInstance(UINT objectIndex, bool visible);
+
+	void Compact();
+
+	// Valid after Compact.
+	const vector<IndirectDrawRecord>& Records() const { return mRecords; }
+	const vector<UINT>& Instances() const { return mInstances; }
+
+	// Position of the draw in AddDraw order each record was built from.
+	const vector<UINT>& RecordDraws() const { return mRecordDraws; }
+
+private:
+	struct Draw
+	{
+		UINT IndexCount = 0;
+		UINT StartIndexLocation = 0;
+		INT BaseVertexLocation = 0;
+		UINT FirstInstance = 0;
+	};
+
+	vector<Draw> mDraws;
+	vector<UINT> mObjectIndices;
+	vector<uint8_t> mVisible;
+
+	// Visible instances before each instance, one extra entry for the total.
+	vector<UINT> mSlots;
+	vector<UINT> mBlockSums;
+
+	vector<IndirectDrawRecord> mRecords;
+	vector<UINT> mRecordDraws;
+	vector<UINT> mInstances;
+};
@@ -0,0 +1,392 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cassert>
+
+namespace
+{
+	// Queue owned by the calling thread: 0 for the main thread, -1 for threads the system does not know.
+	thread_local int tWorkerIndex = -1;
+
+	const int SpinCount = 256;
+}
+
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+void JobSystem::Initialize(int workerCount)
+{
+	assert(!mRunning);
+
+	if (workerCount <= 0)
+	{
+		workerCount = max(1, (int)thread::hardware_concurrency());
+	}
+
+	for (int i = 0; i < workerCount; ++i)
+	{
+		mQueues.push_back(make_unique<WorkQueue>());
+	}
+
+	tWorkerIndex = 0;
+	mRunning = true;
+
+	for (int i = 1; i < workerCount; ++i)
+	{
+		mThreads.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+}
+
+void JobSystem::Shutdown()
+{
+	if (!mRunning)
+	{
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(mSleepLock);
+		mRunning = false;
+	}
+	mWake.notify_all();
+
+	for (auto& t : mThreads)
+	{
+		t.join();
+	}
+
+	mThreads.clear();
+	mQueues.clear();
+}
+
+void JobSystem::Submit(function<void()> job, JobCounter* counter)
+{
+	if (counter != nullptr)
+	{
+		counter->Count.fetch_add(1);
+	}
+
+	if (mQueues.empty())
+	{
+		Execute(job, counter);
+		return;
+	}
+
+	Job j;
+	j.Func = move(job);
+	j.Counter = counter;
+	Push(CurrentIndex(), move(j));
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	const int index = CurrentIndex();
+
+	while (counter.Count.load() > 0)
+	{
+		if (!TryRunJob(index))
+		{
+			this_thread::yield();
+		}
+	}
+
+	// Every counted job has retired, so nothing else touches the error any more.
+	if (counter.Failed)
+	{
+		exception_ptr error = counter.Error;
+		counter.Error = nullptr;
+		counter.Failed = false;
+		rethrow_exception(error);
+	}
+}
+
+void JobSystem::ParallelFor(int begin, int end, const function<void(int)>& func, int minGrain)
+{
+	const int count = end - begin;
+	if (count <= 0)
+	{
+		return;
+	}
+
+	minGrain = max(minGrain, 1);
+
+	if (WorkerCount() <= 1 || count <= minGrain)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			func(i);
+		}
+		return;
+	}
+
+	// Chunks stay small enough that a split can happen a few dozen times per worker.
+	const int grain = max(minGrain, count / (WorkerCount() * 32));
+
+	JobCounter counter;
+	RunRange(begin, end, func, grain, counter);
+	Wait(counter);
+}
+
+void JobSystem::RunRange(int begin, int end, const function<void(int)>& func, int grain, JobCounter& counter)
+{
+	WorkQueue& own = *mQueues[CurrentIndex()];
+
+	while (begin < end && !counter.Failed)
+	{
+		if (end - begin >= 2 * grain && own.Size.load(memory_order_relaxed) == 0)
+		{
+			int mid = begin + (end - begin) / 2;
+			int splitEnd = end;
+			Submit([this, mid, splitEnd, &func, grain, &counter]()
+				{
+					RunRange(mid, splitEnd, func, grain, counter);
+				}, &counter);
+			end = mid;
+			continue;
+		}
+
+		int chunkEnd = min(begin + grain, end);
+		try
+		{
+			for (int i = begin; i < chunkEnd; ++i)
+			{
+				func(i);
+			}
+		}
+		catch (...)
+		{
+			// Recorded on the counter instead of thrown, so the calling thread still waits for the
+			// ranges it gave away before ParallelFor rethrows.
+			lock_guard<mutex> lock(counter.ErrorLock);
+			if (!counter.Error)
+			{
+				counter.Error = current_exception();
+			}
+			counter.Failed = true;
+			return;
+		}
+		begin = chunkEnd;
+	}
+}
+
+void JobSystem::WorkerMain(int index)
+{
+	tWorkerIndex = index;
+
+	int idle = 0;
+	while (mRunning)
+	{
+		if (TryRunJob(index))
+		{
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < SpinCount)
+		{
+			this_thread::yield();
+			continue;
+		}
+
+		unique_lock<mutex> lock(mSleepLock);
+		mSleepers.fetch_add(1);
+		mWake.wait(lock, [this]() { return mQueuedJobs.load() > 0 || !mRunning; });
+		mSleepers.fetch_sub(1);
+		idle = 0;
+	}
+}
+
+// Runs a job and retires it on its counter even if it throws; the exception is kept for Wait.
+void JobSystem::Execute(const function<void()>& func, JobCounter* counter)
+{
+	try
+	{
+		func();
+	}
+	catch (...)
+	{
+		if (counter == nullptr)
+		{
+			terminate();
+		}
+
+		lock_guard<mutex> lock(counter->ErrorLock);
+		if (!counter->Error)
+		{
+			counter->Error = current_exception();
+		}
+		counter->Failed = true;
+	}
+
+	if (counter != nullptr)
+	{
+		counter->Count.fetch_sub(1);
+	}
+}
+
+bool JobSystem::TryRunJob(int index)
+{
+	Job job;
+	if (!PopOrSteal(index, job))
+	{
+		return false;
+	}
+
+	Execute(job.Func, job.Counter);
+	return true;
+}
+
+bool JobSystem::PopOrSteal(int index, Job& job)
+{
+	if (mQueuedJobs.load() == 0)
+	{
+		return false;
+	}
+
+	const int queueCount = (int)mQueues.size();
+
+	{
+		WorkQueue& own = *mQueues[index];
+		lock_guard<mutex> lock(own.Lock);
+		if (!own.Jobs.empty())
+		{
+			job = move(own.Jobs.back());
+			own.Jobs.pop_back();
+			own.Size.fetch_sub(1, memory_order_relaxed);
+			mQueuedJobs.fetch_sub(1);
+			return true;
+		}
+	}
+
+	for (int k = 1; k < queueCount; ++k)
+	{
+		WorkQueue& victim = *mQueues[(index + k) % queueCount];
+		lock_guard<mutex> lock(victim.Lock);
+		if (!victim.Jobs.empty())
+		{
+			job = move(victim.Jobs.front());
+			victim.Jobs.pop_front();
+			victim.Size.fetch_sub(1, memory_order_relaxed);
+			mQueuedJobs.fetch_sub(1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::Push(int index, Job job)
+{
+	// Counted before it becomes visible so the count never drops below zero.
+	mQueuedJobs.fetch_add(1);
+
+	{
+		WorkQueue& queue = *mQueues[index];
+		lock_guard<mutex> lock(queue.Lock);
+		queue.Jobs.push_back(move(job));
+		queue.Size.fetch_add(1, memory_order_relaxed);
+	}
+
+	// A worker registers as a sleeper before it checks the job count, so either it sees this job or
+	// we see it. Taking the lock makes sure it is already waiting when notified.
+	if (mSleepers.load() > 0)
+	{
+		{
+			lock_guard<mutex> lock(mSleepLock);
+		}
+		mWake.notify_one();
+	}
+}
+
+int JobSystem::CurrentIndex() const
+{
+	// Threads created outside the system share the main thread's queue; it is locked like any other.
+	return tWorkerIndex >= 0 && tWorkerIndex < (int)mQueues.size() ? tWorkerIndex : 0;
+}
+
+int TaskGraph::AddTask(const string& name, function<void()> func)
+{
+	auto task = make_unique<Task>();
+	task->Name = name;
+	task->Func = move(func);
+	mTasks.push_back(move(task));
+	return (int)mTasks.size() - 1;
+}
+
+void TaskGraph::Precede(int before, int after)
+{
+	assert(before != after);
+
+	mTasks[before]->Successors.push_back(after);
+	mTasks[after]->PredecessorCount++;
+}
+
+void TaskGraph::Run(JobSystem& jobs)
+{
+	for (auto& task : mTasks)
+	{
+		task->Pending = task->PredecessorCount;
+	}
+
+	mError = nullptr;
+	mFailed = false;
+
+	// A successor is submitted before its last predecessor's job retires, so the counter only
+	// reaches zero once the whole graph has run.
+	JobCounter counter;
+	bool anyRoot = false;
+	for (int i = 0; i < (int)mTasks.size(); ++i)
+	{
+		if (mTasks[i]->PredecessorCount == 0)
+		{
+			Launch(jobs, i, counter);
+			anyRoot = true;
+		}
+	}
+	assert(anyRoot || mTasks.empty());
+
+	jobs.Wait(counter);
+
+	if (mError)
+	{
+		rethrow_exception(mError);
+	}
+}
+
+void TaskGraph::Launch(JobSystem& jobs, int task, JobCounter& counter)
+{
+	jobs.Submit([this, &jobs, task, &counter]()
+		{
+			Task& t = *mTasks[task];
+
+			t.Milliseconds = 0.0;
+			if (!mFailed)
+			{
+				auto start = chrono::steady_clock::now();
+				try
+				{
+					t.Func();
+				}
+				catch (...)
+				{
+					lock_guard<mutex> lock(mErrorLock);
+					if (!mError)
+					{
+						mError = current_exception();
+					}
+					mFailed = true;
+				}
+				t.Milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			}
+
+			for (int next : t.Successors)
+			{
+				if (mTasks[next]->Pending.fetch_sub(1) == 1)
+				{
+					Launch(jobs, next, counter);
+				}
+			}
+		}, &counter);
+}
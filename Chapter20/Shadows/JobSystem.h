@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include "Singleton.h"
+
+using namespace std;
+
+// Counts outstanding jobs; JobSystem::Wait returns once it drops to zero and then rethrows the
+// first exception a counted job threw.
+struct JobCounter
+{
+	atomic<int> Count{ 0 };
+
+	mutex ErrorLock;
+	exception_ptr Error;
+	atomic<bool> Failed{ false };
+};
+
+// Portable work stealing scheduler. Every worker owns a deque: it pushes and pops its own jobs at
+// the back and steals from the front of the others when it runs dry. The main thread owns deque 0
+// and runs jobs while it waits, so no core sits idle on a blocking wait.
+class JobSystem : public Singleton<JobSystem>
+{
+	friend class Singleton<JobSystem>;
+public:
+	// workerCount includes the main thread, 0 uses one per hardware thread.
+	void Initialize(int workerCount = 0);
+	void Shutdown();
+
+	int WorkerCount() const { return (int)mQueues.size(); }
+
+	// A job without a counter has nobody to report to and must not throw.
+	void Submit(function<void()> job, JobCounter* counter = nullptr);
+	void Wait(JobCounter& counter);
+
+	// Calls func(i) for i in [begin, end). Ranges are split lazily: a running range only gives away
+	// half of its remaining work while its own deque is empty, so idle workers have something to steal
+	// but busy ones do not pay for jobs nobody takes. If func throws, the chunks not yet started are
+	// skipped and the first exception is rethrown on the calling thread.
+	void ParallelFor(int begin, int end, const function<void(int)>& func, int minGrain = 1);
+
+private:
+	JobSystem() = default;
+	~JobSystem();
+
+	struct Job
+	{
+		function<void()> Func;
+		JobCounter* Counter = nullptr;
+	};
+
+	struct WorkQueue
+	{
+		mutex Lock;
+		deque<Job> Jobs;
+
+		// Readable without the lock, for the split decision in RunRange.
+		atomic<int> Size{ 0 };
+	};
+
+	void WorkerMain(int index);
+	void Execute(const function<void()>& func, JobCounter* counter);
+	bool TryRunJob(int index);
+	bool PopOrSteal(int index, Job& job);
+	void Push(int index, Job job);
+
+	void RunRange(int begin, int end, const function<void(int)>& func, int grain, JobCounter& counter);
+
+	int CurrentIndex() const;
+
+private:
+	vector<unique_ptr<WorkQueue>> mQueues;
+	vector<thread> mThreads;
+
+	atomic<int> mQueuedJobs{ 0 };
+	atomic<int> mSleepers{ 0 };
+	atomic<bool> mRunning{ false };
+
+	mutex mSleepLock;
+	condition_variable mWake;
+};
+
+// Tasks with explicit ordering. Run starts every task without unfinished predecessors and each
+// finishing task releases its successors, so independent branches overlap. A graph can be run
+// again every frame. If a task throws, the tasks not yet started are skipped and Run rethrows the
+// first exception on the calling thread.
+class TaskGraph
+{
+public:
+	int AddTask(const string& name, function<void()> func);
+
+	// before has to finish before after starts.
+	void Precede(int before, int after);
+
+	void Run(JobSystem& jobs);
+
+	int TaskCount() const { return (int)mTasks.size(); }
+	const string& TaskName(int task) const { return mTasks[task]->Name; }
+
+	// Wall time of each task in milliseconds during the last Run.
+	double TaskTime(int task) const { return mTasks[task]->Milliseconds; }
+
+private:
+	struct Task
+	{
+		string Name;
+		function<void()> Func;
+		vector<int> Successors;
+		int PredecessorCount = 0;
+		atomic<int> Pending{ 0 };
+		double Milliseconds = 0.0;
+	};
+
+	void Launch(JobSystem& jobs, int task, JobCounter& counter);
+
+private:
+	vector<unique_ptr<Task>> mTasks;
+
+	mutex mErrorLock;
+	exception_ptr mError;
+	atomic<bool> mFailed{ false };
+};
@@ -0,0 +1,98 @@
+#include "LinearAllocator.h"
+
+const UINT64 LinearAllocator::DefaultPageSize;
+const UINT64 LinearAllocator::StructuredAlignment;
+
+LinearAllocator::LinearAllocator(ID3D12Device* device, UINT64 pageSize) :
+	mDevice(device), mPageSize(pageSize)
+{
+	mPages.push_back(CreatePage(mPageSize));
+}
+
+LinearAllocator::~LinearAllocator()
+{
+	for (auto& page : mPages)
+	{
+		page.Resource->Unmap(0, nullptr);
+	}
+
+	for (auto& page : mLargePages)
+	{
+		page.Resource->Unmap(0, nullptr);
+	}
+}
+
+LinearAllocator::Allocation LinearAllocator::Allocate(UINT64 byteSize, UINT64 alignment)
+{
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+	lock_guard<mutex> lock(mLock);
+
+	mUsedBytes += byteSize;
+
+	if (byteSize > mPageSize)
+	{
+		mLargePages.push_back(CreatePage(byteSize));
+		return Place(mLargePages.back(), 0);
+	}
+
+	UINT64 offset = (mOffset + alignment - 1) & ~(alignment - 1);
+	if (offset + byteSize > mPageSize)
+	{
+		mCurrentPage++;
+		if (mCurrentPage == mPages.size())
+		{
+			mPages.push_back(CreatePage(mPageSize));
+		}
+		offset = 0;
+	}
+
+	mOffset = offset + byteSize;
+	return Place(mPages[mCurrentPage], offset);
+}
+
+void LinearAllocator::Reset()
+{
+	lock_guard<mutex> lock(mLock);
+
+	for (auto& page : mLargePages)
+	{
+		page.Resource->Unmap(0, nullptr);
+	}
+	mLargePages.clear();
+
+	mCurrentPage = 0;
+	mOffset = 0;
+	mUsedBytes = 0;
+}
+
+LinearAllocator::Page LinearAllocator::CreatePage(UINT64 byteSize)
+{
+	Page page;
+	page.Size = byteSize;
+
+	auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&heapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&page.Resource)));
+
+	ThrowIfFailed(page.Resource->Map(0, nullptr, reinterpret_cast<void**>(&page.CpuAddress)));
+	page.GpuAddress = page.Resource->GetGPUVirtualAddress();
+
+	return page;
+}
+
+LinearAllocator::Allocation LinearAllocator::Place(const Page& page, UINT64 offset)
+{
+	Allocation allocation;
+	allocation.Resource = page.Resource.Get();
+	allocation.Offset = offset;
+	allocation.CpuAddress = page.CpuAddress + offset;
+	allocation.GpuAddress = page.GpuAddress + offset;
+	return allocation;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include <mutex>
+
+// Per frame upload memory. Allocations bump an offset through persistently mapped pages and a new page
+// is chained on when the current one is full. Nothing is freed on its own: Reset hands everything back
+// at once and may only be called after the fence of the frame that used the memory has completed.
+class LinearAllocator
+{
+public:
+	struct Allocation
+	{
+		ID3D12Resource* Resource = nullptr;
+		UINT64 Offset = 0;
+		BYTE* CpuAddress = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+	};
+
+	static const UINT64 DefaultPageSize = 64 * 1024;
+
+	LinearAllocator(ID3D12Device* device, UINT64 pageSize = DefaultPageSize);
+	LinearAllocator(const LinearAllocator& rhs) = delete;
+	LinearAllocator& operator=(const LinearAllocator& rhs) = delete;
+	~LinearAllocator();
+
+	// Safe to call from several jobs at once. Requests larger than a page get a page of their own.
+	Allocation Allocate(UINT64 byteSize, UINT64 alignment);
+
+	// A constant buffer view has to start on a 256 byte boundary and cover a multiple of 256 bytes.
+	template<typename T>
+	Allocation AllocateConstants(const T& data)
+	{
+		Allocation allocation = Allocate(D3DUtil::CalcConstantBufferByteSize(sizeof(T)),
+			D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		memcpy(allocation.CpuAddress, &data, sizeof(T));
+		return allocation;
+	}
+
+	// Range for a root shader resource view or indirect arguments.
+	template<typename T>
+	Allocation AllocateStructured(const T* data, size_t count)
+	{
+		Allocation allocation = Allocate(sizeof(T) * count, StructuredAlignment);
+		if (count > 0)
+		{
+			memcpy(allocation.CpuAddress, data, sizeof(T) * count);
+		}
+		return allocation;
+	}
+
+	void Reset();
+
+	UINT64 UsedBytes() const { return mUsedBytes; }
+	size_t PageCount() const { return mPages.size() + mLargePages.size(); }
+
+private:
+	struct Page
+	{
+		ComPtr<ID3D12Resource> Resource;
+		BYTE* CpuAddress = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+		UINT64 Size = 0;
+	};
+
+	static const UINT64 StructuredAlignment = 16;
+
+	Page CreatePage(UINT64 byteSize);
+	Allocation Place(const Page& page, UINT64 offset);
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	UINT64 mPageSize = 0;
+
+	// Pages stay alive across Reset and are refilled from the first one.
+	vector<Page> mPages;
+	size_t mCurrentPage = 0;
+	UINT64 mOffset = 0;
+
+	// Oversized requests, released on Reset.
+	vector<Page> mLargePages;
+
+	UINT64 mUsedBytes = 0;
+	mutex mLock;
+};
@@ -0,0 +1,302 @@
+#include "MatrixKernels.h"
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	const size_t Lanes = 8;
+
+	bool avxEnabled = true;
+
+	bool UseAvx()
+	{
+		return avxEnabled && MatrixKernels::HasAvx();
+	}
+
+	template<typename T>
+	T* At(T* base, size_t stride, size_t i)
+	{
+		return (T*)((const char*)base + stride * i);
+	}
+
+	// r[i] holds row i of an 8x8 block; afterwards it holds column i.
+	void Transpose8x8(__m256 r[8])
+	{
+		__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+		__m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+		__m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+		__m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+		__m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+		__m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+		__m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+		__m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+		__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+		r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+		r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+		r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+		r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+		r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+		r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+		r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+		r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+	}
+
+	// Eight matrices with one register per element, m[row * 4 + column].
+	void LoadBlock(const XMFLOAT4X4* src, size_t stride, __m256 m[16])
+	{
+		for (int half = 0; half < 2; ++half)
+		{
+			__m256* r = m + half * 8;
+			for (size_t k = 0; k < Lanes; ++k)
+			{
+				r[k] = _mm256_loadu_ps(&At(src, stride, k)->m[half * 2][0]);
+			}
+			Transpose8x8(r);
+		}
+	}
+
+	void StoreBlock(__m256 m[16], XMFLOAT4X4* dst, size_t stride)
+	{
+		for (int half = 0; half < 2; ++half)
+		{
+			__m256* r = m + half * 8;
+			Transpose8x8(r);
+			for (size_t k = 0; k < Lanes; ++k)
+			{
+				_mm256_storeu_ps(&At(dst, stride, k)->m[half * 2][0], r[k]);
+			}
+		}
+	}
+
+	// Fills in the last column and row of an inverse from its 3x3 part in o: t' = -t * inverse.
+	void FinishAffineBlock(const __m256 m[16], __m256 o[16])
+	{
+		const __m256 zero = _mm256_setzero_ps();
+
+		o[3] = zero;
+		o[7] = zero;
+		o[11] = zero;
+		for (int j = 0; j < 3; ++j)
+		{
+			__m256 t = _mm256_mul_ps(m[12], o[j]);
+			t = _mm256_add_ps(t, _mm256_mul_ps(m[13], o[4 + j]));
+			t = _mm256_add_ps(t, _mm256_mul_ps(m[14], o[8 + j]));
+			o[12 + j] = _mm256_sub_ps(zero, t);
+		}
+		o[15] = _mm256_set1_ps(1.0f);
+	}
+
+	void InverseAffineBlock(const __m256 m[16], __m256 o[16])
+	{
+		// Adjugate of the 3x3 part.
+		__m256 c00 = _mm256_sub_ps(_mm256_mul_ps(m[5], m[10]), _mm256_mul_ps(m[6], m[9]));
+		__m256 c01 = _mm256_sub_ps(_mm256_mul_ps(m[2], m[9]), _mm256_mul_ps(m[1], m[10]));
+		__m256 c02 = _mm256_sub_ps(_mm256_mul_ps(m[1], m[6]), _mm256_mul_ps(m[2], m[5]));
+		__m256 c10 = _mm256_sub_ps(_mm256_mul_ps(m[6], m[8]), _mm256_mul_ps(m[4], m[10]));
+		__m256 c11 = _mm256_sub_ps(_mm256_mul_ps(m[0], m[10]), _mm256_mul_ps(m[2], m[8]));
+		__m256 c12 = _mm256_sub_ps(_mm256_mul_ps(m[2], m[4]), _mm256_mul_ps(m[0], m[6]));
+		__m256 c20 = _mm256_sub_ps(_mm256_mul_ps(m[4], m[9]), _mm256_mul_ps(m[5], m[8]));
+		__m256 c21 = _mm256_sub_ps(_mm256_mul_ps(m[1], m[8]), _mm256_mul_ps(m[0], m[9]));
+		__m256 c22 = _mm256_sub_ps(_mm256_mul_ps(m[0], m[5]), _mm256_mul_ps(m[1], m[4]));
+
+		__m256 det = _mm256_mul_ps(m[0], c00);
+		det = _mm256_add_ps(det, _mm256_mul_ps(m[1], c10));
+		det = _mm256_add_ps(det, _mm256_mul_ps(m[2], c20));
+		__m256 invDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+
+		o[0] = _mm256_mul_ps(c00, invDet);
+		o[1] = _mm256_mul_ps(c01, invDet);
+		o[2] = _mm256_mul_ps(c02, invDet);
+		o[4] = _mm256_mul_ps(c10, invDet);
+		o[5] = _mm256_mul_ps(c11, invDet);
+		o[6] = _mm256_mul_ps(c12, invDet);
+		o[8] = _mm256_mul_ps(c20, invDet);
+		o[9] = _mm256_mul_ps(c21, invDet);
+		o[10] = _mm256_mul_ps(c22, invDet);
+
+		FinishAffineBlock(m, o);
+	}
+
+	void InverseRigidBlock(const __m256 m[16], __m256 o[16])
+	{
+		o[0] = m[0];
+		o[1] = m[4];
+		o[2] = m[8];
+		o[4] = m[1];
+		o[5] = m[5];
+		o[6] = m[9];
+		o[8] = m[2];
+		o[9] = m[6];
+		o[10] = m[10];
+
+		FinishAffineBlock(m, o);
+	}
+
+	template<typename BlockFunc, typename MatrixFunc>
+	void ForEachMatrix(const XMFLOAT4X4* src, size_t srcStride, XMFLOAT4X4* dst, size_t dstStride, size_t count,
+		BlockFunc blockFunc, MatrixFunc matrixFunc)
+	{
+		size_t i = 0;
+		if (UseAvx())
+		{
+			__m256 m[16];
+			__m256 o[16];
+			for (; i + Lanes <= count; i += Lanes)
+			{
+				LoadBlock(At(src, srcStride, i), srcStride, m);
+				blockFunc(m, o);
+				StoreBlock(o, At(dst, dstStride, i), dstStride);
+			}
+		}
+
+		for (; i < count; ++i)
+		{
+			XMStoreFloat4x4(At(dst, dstStride, i), matrixFunc(XMLoadFloat4x4(At(src, srcStride, i))));
+		}
+	}
+
+	XMMATRIX InverseRigidMatrix(FXMMATRIX m)
+	{
+		XMMATRIX rotation = m;
+		rotation.r[3] = g_XMIdentityR3;
+
+		XMMATRIX inverse = XMMatrixTranspose(rotation);
+		inverse.r[3] = XMVectorSelect(g_XMIdentityR3, XMVectorNegate(XMVector3TransformNormal(m.r[3], inverse)), g_XMSelect1110);
+		return inverse;
+	}
+
+	XMMATRIX InverseMatrix(FXMMATRIX m)
+	{
+		return XMMatrixInverse(nullptr, m);
+	}
+}
+
+bool MatrixKernels::HasAvx()
+{
+	static const bool hasAvx = []()
+		{
+#if defined(_MSC_VER)
+			// AVX, and an OS that saves the upper halves of the YMM registers.
+			int info[4];
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+			return __builtin_cpu_supports("avx") != 0;
+#endif
+		}();
+	return hasAvx;
+}
+
+void MatrixKernels::SetAvxEnabled(bool enabled)
+{
+	avxEnabled = enabled;
+}
+
+void MatrixKernels::StoreTransposed3x4(const XMFLOAT4X4* src, size_t srcStride, const int* indices,
+	XMFLOAT4* dst, size_t dstStride, size_t count)
+{
+	auto source = [src, srcStride, indices](size_t i)
+		{
+			return &At(src, srcStride, indices != nullptr ? indices[i] : i)->m[0][0];
+		};
+
+	size_t i = 0;
+	if (UseAvx())
+	{
+		// Two matrices side by side, one per 128 bit half; the 4x4 transpose works within the halves.
+		for (; i + 2 <= count; i += 2)
+		{
+			const float* a = source(i);
+			const float* b = source(i + 1);
+
+			__m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a)), _mm_loadu_ps(b), 1);
+			__m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a + 4)), _mm_loadu_ps(b + 4), 1);
+			__m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a + 8)), _mm_loadu_ps(b + 8), 1);
+			__m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a + 12)), _mm_loadu_ps(b + 12), 1);
+
+			__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+			__m256 t1 = _mm256_unpacklo_ps(r2, r3);
+			__m256 t2 = _mm256_unpackhi_ps(r0, r1);
+			__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+
+			__m256 c0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+			__m256 c1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+			__m256 c2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+
+			float* da = &At(dst, dstStride, i)->x;
+			float* db = &At(dst, dstStride, i + 1)->x;
+			_mm_storeu_ps(da, _mm256_castps256_ps128(c0));
+			_mm_storeu_ps(da + 4, _mm256_castps256_ps128(c1));
+			_mm_storeu_ps(da + 8, _mm256_castps256_ps128(c2));
+			_mm_storeu_ps(db, _mm256_extractf128_ps(c0, 1));
+			_mm_storeu_ps(db + 4, _mm256_extractf128_ps(c1, 1));
+			_mm_storeu_ps(db + 8, _mm256_extractf128_ps(c2, 1));
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		XMMATRIX m = XMMatrixTranspose(XMLoadFloat4x4((const XMFLOAT4X4*)source(i)));
+		XMFLOAT4* rows = At(dst, dstStride, i);
+		XMStoreFloat4(&rows[0], m.r[0]);
+		XMStoreFloat4(&rows[1], m.r[1]);
+		XMStoreFloat4(&rows[2], m.r[2]);
+	}
+}
+
+void MatrixKernels::InverseAffine(const XMFLOAT4X4* src, size_t srcStride, XMFLOAT4X4* dst, size_t dstStride, size_t count)
+{
+	ForEachMatrix(src, srcStride, dst, dstStride, count, InverseAffineBlock, InverseMatrix);
+}
+
+void MatrixKernels::InverseRigid(const XMFLOAT4X4* src, size_t srcStride, XMFLOAT4X4* dst, size_t dstStride, size_t count)
+{
+	ForEachMatrix(src, srcStride, dst, dstStride, count, InverseRigidBlock, InverseRigidMatrix);
+}
+
+XMMATRIX MatrixKernels::InverseRigid(FXMMATRIX m)
+{
+	return InverseRigidMatrix(m);
+}
+
+XMMATRIX MatrixKernels::InverseProjection(CXMMATRIX proj)
+{
+	XMFLOAT4X4 p;
+	XMStoreFloat4x4(&p, proj);
+
+	// [D 0; C E] with D = diag(_11, _22) inverts to [D^-1 0; -E^-1 C D^-1 E^-1].
+	const float invA = 1.0f / p._11;
+	const float invB = 1.0f / p._22;
+
+	const float invDetE = 1.0f / (p._33 * p._44 - p._34 * p._43);
+	const float e00 = p._44 * invDetE;
+	const float e01 = -p._34 * invDetE;
+	const float e10 = -p._43 * invDetE;
+	const float e11 = p._33 * invDetE;
+
+	return XMMATRIX(
+		invA, 0.0f, 0.0f, 0.0f,
+		0.0f, invB, 0.0f, 0.0f,
+		-(e00 * p._31 + e01 * p._41) * invA, -(e00 * p._32 + e01 * p._42) * invB, e00, e01,
+		-(e10 * p._31 + e11 * p._41) * invA, -(e10 * p._32 + e11 * p._42) * invB, e10, e11);
+}
+
+void MatrixKernels::InverseViewProj(CXMMATRIX view, CXMMATRIX proj, XMMATRIX& invView, XMMATRIX& invProj, XMMATRIX& invViewProj)
+{
+	invView = InverseRigidMatrix(view);
+	invProj = InverseProjection(proj);
+	invViewProj = XMMatrixMultiply(invProj, invView);
+}
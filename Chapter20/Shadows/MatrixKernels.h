@@ -0,0 +1,39 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+using namespace std;
+using namespace DirectX;
+
+// Batched matrix operations for the per frame constant generation. With AVX eight matrices are
+// loaded at a time and transposed into one register per element, so all lanes run the same straight
+// line code; the remainder and CPUs without AVX go through DirectXMath. Matrices are addressed by a
+// pointer to the first one and a byte stride, so they can sit inside larger structs. All of them use
+// the row vector convention of DirectXMath.
+class MatrixKernels
+{
+public:
+	static bool HasAvx();
+
+	// With AVX disabled every kernel takes its DirectXMath path, as on a CPU without it. For tests.
+	static void SetAvxEnabled(bool enabled);
+
+	// dst receives the first three rows of the transposed matrix: the 3x4 the shaders read. With
+	// indices the i-th output is taken from matrix indices[i], otherwise from matrix i.
+	static void StoreTransposed3x4(const XMFLOAT4X4* src, size_t srcStride, const int* indices,
+		XMFLOAT4* dst, size_t dstStride, size_t count);
+
+	// Inverse of matrices whose last column is 0 0 0 1.
+	static void InverseAffine(const XMFLOAT4X4* src, size_t srcStride, XMFLOAT4X4* dst, size_t dstStride, size_t count);
+
+	// Inverse of a rotation followed by a translation, such as a view matrix.
+	static void InverseRigid(const XMFLOAT4X4* src, size_t srcStride, XMFLOAT4X4* dst, size_t dstStride, size_t count);
+	static XMMATRIX InverseRigid(FXMMATRIX m);
+
+	// Inverse of any DirectXMath perspective or orthographic projection, off center ones included.
+	// Their first two rows only have the diagonal, which leaves one 2x2 block to invert.
+	static XMMATRIX InverseProjection(CXMMATRIX proj);
+
+	// The inverses a pass needs, for a rigid view matrix and a projection as above.
+	static void InverseViewProj(CXMMATRIX view, CXMMATRIX proj, XMMATRIX& invView, XMMATRIX& invProj, XMMATRIX& invViewProj);
+};
@@ -0,0 +1,187 @@
+#include "PipelineCache.h"
+
+namespace
+{
+	wstring LibraryName(uint64_t key)
+	{
+		wchar_t name[17];
+		swprintf_s(name, L"%016llx", key);
+		return name;
+	}
+}
+
+PipelineCache::PipelineCache(ID3D12Device* device, const wstring& filename) :
+	md3dDevice(device), mFilename(filename)
+{
+	// Pipeline libraries need ID3D12Device1; without it every state is compiled.
+	ComPtr<ID3D12Device1> device1;
+	if (FAILED(md3dDevice->QueryInterface(IID_PPV_ARGS(&device1))))
+	{
+		return;
+	}
+
+	ifstream fin(mFilename, ios::binary);
+	if (fin)
+	{
+		mLibraryData.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+	}
+
+	HRESULT hr = E_FAIL;
+	if (!mLibraryData.empty())
+	{
+		hr = device1->CreatePipelineLibrary(mLibraryData.data(), mLibraryData.size(), IID_PPV_ARGS(&mLibrary));
+	}
+
+	// A library from another driver or adapter, or a damaged file, is started over.
+	if (FAILED(hr))
+	{
+		mLibraryData.clear();
+		mLibraryChanged = true;
+		if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&mLibrary))))
+		{
+			mLibrary = nullptr;
+		}
+	}
+}
+
+PipelineCache::~PipelineCache()
+{
+	JobSystem::GetInstance().Wait(mPending);
+}
+
+void PipelineCache::AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serialized)
+{
+	lock_guard<mutex> lock(mLock);
+	mRootSignatures[rootSignature] = HashBytes(serialized->GetBufferPointer(), serialized->GetBufferSize());
+}
+
+uint64_t PipelineCache::Key(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	uint64_t rootSignatureHash = 0;
+	{
+		lock_guard<mutex> lock(mLock);
+		auto it = mRootSignatures.find(desc.pRootSignature);
+		assert(it != mRootSignatures.end());
+		rootSignatureHash = it->second;
+	}
+	return HashPipelineState(desc, rootSignatureHash);
+}
+
+ID3D12PipelineState* PipelineCache::Get(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	const uint64_t key = Key(desc);
+
+	bool added = false;
+	Entry* entry = FindOrAdd(key, added);
+	Build(*entry, key, desc);
+	return entry->State.Get();
+}
+
+uint64_t PipelineCache::Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	const uint64_t key = Key(desc);
+
+	bool added = false;
+	Entry* entry = FindOrAdd(key, added);
+	if (added)
+	{
+		JobSystem::GetInstance().Submit([this, entry, key, desc]()
+			{
+				// A failed state stays on its fallback; Get on the same description reports the error.
+				try
+				{
+					Build(*entry, key, desc);
+				}
+				catch (DxException&)
+				{
+				}
+			}, &mPending);
+	}
+	return key;
+}
+
+ID3D12PipelineState* PipelineCache::Find(uint64_t key, ID3D12PipelineState* fallback)
+{
+	lock_guard<mutex> lock(mLock);
+	auto it = mEntries.find(key);
+	if (it == mEntries.end() || !it->second->Ready)
+	{
+		return fallback;
+	}
+	return it->second->State.Get();
+}
+
+void PipelineCache::Save()
+{
+	JobSystem::GetInstance().Wait(mPending);
+
+	lock_guard<mutex> lock(mLibraryLock);
+	if (mLibrary == nullptr || !mLibraryChanged)
+	{
+		return;
+	}
+
+	// Runs on shutdown; a library that cannot be written just means compiling again next time.
+	vector<char> data(mLibrary->GetSerializedSize());
+	if (FAILED(mLibrary->Serialize(data.data(), data.size())))
+	{
+		return;
+	}
+
+	// Written under a temporary name and moved into place, so a crash never leaves half a library.
+	const wstring temporary = mFilename + L".tmp";
+	{
+		ofstream fout(temporary, ios::binary | ios::trunc);
+		fout.write(data.data(), data.size());
+	}
+	MoveFileExW(temporary.c_str(), mFilename.c_str(), MOVEFILE_REPLACE_EXISTING);
+
+	mLibraryChanged = false;
+}
+
+PipelineCache::Entry* PipelineCache::FindOrAdd(uint64_t key, bool& added)
+{
+	lock_guard<mutex> lock(mLock);
+	auto& entry = mEntries[key];
+	added = entry == nullptr;
+	if (added)
+	{
+		entry = make_unique<Entry>();
+	}
+	return entry.get();
+}
+
+void PipelineCache::Build(Entry& entry, uint64_t key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	call_once(entry.Once, [this, &entry, key, &desc]()
+		{
+			entry.State = Create(key, desc);
+			entry.Ready = true;
+		});
+}
+
+ComPtr<ID3D12PipelineState> PipelineCache::Create(uint64_t key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	ComPtr<ID3D12PipelineState> state;
+	const wstring name = LibraryName(key);
+
+	// Each key is loaded once, which is all the synchronization the library asks for.
+	if (mLibrary != nullptr && SUCCEEDED(mLibrary->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&state))))
+	{
+		mLoaded++;
+		return state;
+	}
+
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&state)));
+	mCreated++;
+
+	if (mLibrary != nullptr)
+	{
+		lock_guard<mutex> lock(mLibraryLock);
+		if (SUCCEEDED(mLibrary->StorePipeline(name.c_str(), state.Get())))
+		{
+			mLibraryChanged = true;
+		}
+	}
+	return state;
+}
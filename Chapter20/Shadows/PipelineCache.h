@@ -0,0 +1,70 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include "PipelineStateHash.h"
+#include "JobSystem.h"
+
+// Graphics pipeline states keyed by the hash of their description, so identical descriptions share
+// one state object. States can be compiled on a worker while the caller keeps drawing with a
+// fallback. Every state compiled goes into a pipeline library saved next to the executable; on the
+// next launch it is loaded from there instead of compiled, until the driver or any shader changes.
+class PipelineCache
+{
+public:
+	PipelineCache(ID3D12Device* device, const wstring& filename = L"PipelineCache.bin");
+	PipelineCache(const PipelineCache& rhs) = delete;
+	PipelineCache& operator=(const PipelineCache& rhs) = delete;
+	~PipelineCache();
+
+	// Root signatures are hashed by their serialized form, which is stable between runs.
+	void AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serialized);
+
+	uint64_t Key(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	// Returns once the state exists, waiting for it if a worker is already on it.
+	ID3D12PipelineState* Get(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	// Starts compiling on a worker and returns the key to look the state up with. Everything desc
+	// points to has to stay alive until the state is ready.
+	uint64_t Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	// The state if it is ready, fallback otherwise.
+	ID3D12PipelineState* Find(uint64_t key, ID3D12PipelineState* fallback);
+
+	// Waits for the requests in flight and writes the library if it gained states. Does not throw.
+	void Save();
+
+	int Loaded() const { return mLoaded; }
+	int Created() const { return mCreated; }
+
+private:
+	struct Entry
+	{
+		once_flag Once;
+		ComPtr<ID3D12PipelineState> State;
+		atomic<bool> Ready{ false };
+	};
+
+	Entry* FindOrAdd(uint64_t key, bool& added);
+	void Build(Entry& entry, uint64_t key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+	ComPtr<ID3D12PipelineState> Create(uint64_t key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	wstring mFilename;
+
+	ComPtr<ID3D12PipelineLibrary> mLibrary;
+	// The library reads from this memory for as long as it lives.
+	vector<char> mLibraryData;
+	bool mLibraryChanged = false;
+	mutex mLibraryLock;
+
+	mutex mLock;
+	unordered_map<ID3D12RootSignature*, uint64_t> mRootSignatures;
+	unordered_map<uint64_t, unique_ptr<Entry>> mEntries;
+
+	JobCounter mPending;
+
+	atomic<int> mLoaded{ 0 };
+	atomic<int> mCreated{ 0 };
+};
@@ -0,0 +1,147 @@
+#include "PipelineStateHash.h"
+#include <cstring>
+
+namespace
+{
+	// Only for members without padding; structs are hashed member by member because the padding
+	// after their UINT8 members is whatever the stack held.
+	template<typename T>
+	uint64_t HashValue(const T& value, uint64_t hash)
+	{
+		return HashBytes(&value, sizeof(value), hash);
+	}
+
+	uint64_t HashString(const char* s, uint64_t hash)
+	{
+		return s != nullptr ? HashBytes(s, strlen(s) + 1, hash) : HashValue('\0', hash);
+	}
+
+	uint64_t HashShader(const D3D12_SHADER_BYTECODE& shader, uint64_t hash)
+	{
+		hash = HashValue(shader.BytecodeLength, hash);
+		return shader.pShaderBytecode != nullptr ? HashBytes(shader.pShaderBytecode, shader.BytecodeLength, hash) : hash;
+	}
+
+	uint64_t HashStreamOutput(const D3D12_STREAM_OUTPUT_DESC& so, uint64_t hash)
+	{
+		hash = HashValue(so.NumEntries, hash);
+		for (UINT i = 0; i < so.NumEntries; ++i)
+		{
+			const D3D12_SO_DECLARATION_ENTRY& entry = so.pSODeclaration[i];
+			hash = HashValue(entry.Stream, hash);
+			hash = HashString(entry.SemanticName, hash);
+			hash = HashValue(entry.SemanticIndex, hash);
+			hash = HashValue(entry.StartComponent, hash);
+			hash = HashValue(entry.ComponentCount, hash);
+			hash = HashValue(entry.OutputSlot, hash);
+		}
+
+		hash = HashValue(so.NumStrides, hash);
+		if (so.NumStrides > 0)
+		{
+			hash = HashBytes(so.pBufferStrides, so.NumStrides * sizeof(UINT), hash);
+		}
+		return HashValue(so.RasterizedStream, hash);
+	}
+
+	uint64_t HashBlend(const D3D12_BLEND_DESC& blend, uint64_t hash)
+	{
+		hash = HashValue(blend.AlphaToCoverageEnable, hash);
+		hash = HashValue(blend.IndependentBlendEnable, hash);
+		for (auto& rt : blend.RenderTarget)
+		{
+			hash = HashValue(rt.BlendEnable, hash);
+			hash = HashValue(rt.LogicOpEnable, hash);
+			hash = HashValue(rt.SrcBlend, hash);
+			hash = HashValue(rt.DestBlend, hash);
+			hash = HashValue(rt.BlendOp, hash);
+			hash = HashValue(rt.SrcBlendAlpha, hash);
+			hash = HashValue(rt.DestBlendAlpha, hash);
+			hash = HashValue(rt.BlendOpAlpha, hash);
+			hash = HashValue(rt.LogicOp, hash);
+			hash = HashValue(rt.RenderTargetWriteMask, hash);
+		}
+		return hash;
+	}
+
+	uint64_t HashRasterizer(const D3D12_RASTERIZER_DESC& rs, uint64_t hash)
+	{
+		hash = HashValue(rs.FillMode, hash);
+		hash = HashValue(rs.CullMode, hash);
+		hash = HashValue(rs.FrontCounterClockwise, hash);
+		hash = HashValue(rs.DepthBias, hash);
+		hash = HashValue(rs.DepthBiasClamp, hash);
+		hash = HashValue(rs.SlopeScaledDepthBias, hash);
+		hash = HashValue(rs.DepthClipEnable, hash);
+		hash = HashValue(rs.MultisampleEnable, hash);
+		hash = HashValue(rs.AntialiasedLineEnable, hash);
+		hash = HashValue(rs.ForcedSampleCount, hash);
+		return HashValue(rs.ConservativeRaster, hash);
+	}
+
+	uint64_t HashStencilOp(const D3D12_DEPTH_STENCILOP_DESC& op, uint64_t hash)
+	{
+		hash = HashValue(op.StencilFailOp, hash);
+		hash = HashValue(op.StencilDepthFailOp, hash);
+		hash = HashValue(op.StencilPassOp, hash);
+		return HashValue(op.StencilFunc, hash);
+	}
+
+	uint64_t HashDepthStencil(const D3D12_DEPTH_STENCIL_DESC& ds, uint64_t hash)
+	{
+		hash = HashValue(ds.DepthEnable, hash);
+		hash = HashValue(ds.DepthWriteMask, hash);
+		hash = HashValue(ds.DepthFunc, hash);
+		hash = HashValue(ds.StencilEnable, hash);
+		hash = HashValue(ds.StencilReadMask, hash);
+		hash = HashValue(ds.StencilWriteMask, hash);
+		hash = HashStencilOp(ds.FrontFace, hash);
+		return HashStencilOp(ds.BackFace, hash);
+	}
+
+	uint64_t HashInputLayout(const D3D12_INPUT_LAYOUT_DESC& layout, uint64_t hash)
+	{
+		hash = HashValue(layout.NumElements, hash);
+		for (UINT i = 0; i < layout.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = layout.pInputElementDescs[i];
+			hash = HashString(element.SemanticName, hash);
+			hash = HashValue(element.SemanticIndex, hash);
+			hash = HashValue(element.Format, hash);
+			hash = HashValue(element.InputSlot, hash);
+			hash = HashValue(element.AlignedByteOffset, hash);
+			hash = HashValue(element.InputSlotClass, hash);
+			hash = HashValue(element.InstanceDataStepRate, hash);
+		}
+		return hash;
+	}
+}
+
+uint64_t HashPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+{
+	uint64_t hash = HashValue(rootSignatureHash, FnvOffset);
+
+	hash = HashShader(desc.VS, hash);
+	hash = HashShader(desc.PS, hash);
+	hash = HashShader(desc.DS, hash);
+	hash = HashShader(desc.HS, hash);
+	hash = HashShader(desc.GS, hash);
+	hash = HashStreamOutput(desc.StreamOutput, hash);
+	hash = HashBlend(desc.BlendState, hash);
+	hash = HashValue(desc.SampleMask, hash);
+	hash = HashRasterizer(desc.RasterizerState, hash);
+	hash = HashDepthStencil(desc.DepthStencilState, hash);
+	hash = HashInputLayout(desc.InputLayout, hash);
+	hash = HashValue(desc.IBStripCutValue, hash);
+	hash = HashValue(desc.PrimitiveTopologyType, hash);
+	hash = HashValue(desc.NumRenderTargets, hash);
+	for (auto format : desc.RTVFormats)
+	{
+		hash = HashValue(format, hash);
+	}
+	hash = HashValue(desc.DSVFormat, hash);
+	hash = HashValue(desc.SampleDesc.Count, hash);
+	hash = HashValue(desc.SampleDesc.Quality, hash);
+	hash = HashValue(desc.NodeMask, hash);
+	return HashValue(desc.Flags, hash);
+}
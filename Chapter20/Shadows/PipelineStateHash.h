@@ -0,0 +1,14 @@
+#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+#include <cstddef>
+#include "Hash.h"
+
+using namespace std;
+
+// Hash of everything a graphics pipeline state is built from. Pointers are followed, so shader
+// bytecode, input layout semantics and stream output entries count by value and the same description
+// hashes the same in every run. The root signature is a live object; its caller supplied hash, usually
+// that of the serialized blob, stands in for it. CachedPSO does not change the result and is left out.
+uint64_t HashPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
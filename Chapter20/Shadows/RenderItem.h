@@ -8,7 +8,8 @@ struct RenderItem
 	RenderItem() = default;
 	RenderItem(const RenderItem& rhs) = delete;
 
-	XMFLOAT4X4 World = MathHelper::Identity4x4();
+	// World matrix lives in BaseApp::mTransforms.
+	int Transform = -1;
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
 	int NumFramesDirty = gNumFrameResources;
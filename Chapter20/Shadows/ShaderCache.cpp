@@ -0,0 +1,334 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include <thread>
+
+namespace
+{
+	// Anything beyond this in a manifest means the file is damaged.
+	const UINT MaxDependencies = 256;
+
+	// Strings are hashed with their terminator so "ab" + "c" and "a" + "bc" differ.
+	uint64_t Hash(const string& s, uint64_t hash)
+	{
+		return HashBytes(s.c_str(), s.size() + 1, hash);
+	}
+
+	uint64_t Hash(const wstring& s, uint64_t hash)
+	{
+		return HashBytes(s.c_str(), (s.size() + 1) * sizeof(wchar_t), hash);
+	}
+
+	uint64_t HashDefines(const D3D_SHADER_MACRO* defines, uint64_t hash)
+	{
+		for (; defines != nullptr && defines->Name != nullptr; ++defines)
+		{
+			hash = Hash(string(defines->Name), hash);
+			hash = Hash(string(defines->Definition != nullptr ? defines->Definition : ""), hash);
+		}
+		return hash;
+	}
+
+	bool ReadFileBytes(const wstring& filename, vector<char>& data)
+	{
+		ifstream fin(filename, ios::binary);
+		if (!fin)
+		{
+			return false;
+		}
+
+		data.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+		return true;
+	}
+
+	wstring DirectoryOf(const wstring& filename)
+	{
+		size_t slash = filename.find_last_of(L"\\/");
+		return slash == wstring::npos ? L"" : filename.substr(0, slash + 1);
+	}
+
+	// Include handler of the preprocessor that remembers every file it opened.
+	class RecordingInclude : public ID3DInclude
+	{
+	public:
+		RecordingInclude(const wstring& rootDirectory) : mRootDirectory(rootDirectory) {}
+
+		HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData,
+			LPCVOID* data, UINT* bytes) override
+		{
+			// Relative to the including file, like D3D_COMPILE_STANDARD_FILE_INCLUDE.
+			auto parent = mDirectories.find(parentData);
+			wstring filename = (parent != mDirectories.end() ? parent->second : mRootDirectory) + AnsiToWString(fileName);
+
+			auto file = make_unique<vector<char>>();
+			if (!ReadFileBytes(filename, *file))
+			{
+				return E_FAIL;
+			}
+
+			// An empty file still needs an address to tell it apart.
+			file->push_back('\0');
+
+			*data = file->data();
+			*bytes = (UINT)file->size() - 1;
+
+			mDirectories[file->data()] = DirectoryOf(filename);
+			Files.push_back(make_pair(filename, HashBytes(file->data(), file->size() - 1)));
+			mFiles.push_back(move(file));
+			return S_OK;
+		}
+
+		HRESULT __stdcall Close(LPCVOID data) override
+		{
+			return S_OK;
+		}
+
+		vector<pair<wstring, uint64_t>> Files;
+
+	private:
+		wstring mRootDirectory;
+		unordered_map<LPCVOID, wstring> mDirectories;
+		vector<unique_ptr<vector<char>>> mFiles;
+	};
+
+	// Bytecode read straight from a mapped cache file.
+	class MappedBlob : public ID3DBlob
+	{
+	public:
+		static ComPtr<ID3DBlob> Open(const wstring& filename)
+		{
+			HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				return nullptr;
+			}
+
+			LARGE_INTEGER size = {};
+			GetFileSizeEx(file, &size);
+
+			HANDLE mapping = size.QuadPart > 0 ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+			CloseHandle(file);
+			if (mapping == nullptr)
+			{
+				return nullptr;
+			}
+
+			void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+			if (view == nullptr)
+			{
+				return nullptr;
+			}
+
+			ComPtr<ID3DBlob> blob;
+			blob.Attach(new MappedBlob(view, (SIZE_T)size.QuadPart));
+			return blob;
+		}
+
+		HRESULT __stdcall QueryInterface(REFIID riid, void** object) override
+		{
+			if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D10Blob))
+			{
+				*object = static_cast<ID3DBlob*>(this);
+				AddRef();
+				return S_OK;
+			}
+
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		ULONG __stdcall AddRef() override
+		{
+			return ++mRefCount;
+		}
+
+		ULONG __stdcall Release() override
+		{
+			ULONG count = --mRefCount;
+			if (count == 0)
+			{
+				delete this;
+			}
+			return count;
+		}
+
+		LPVOID __stdcall GetBufferPointer() override { return mView; }
+		SIZE_T __stdcall GetBufferSize() override { return mSize; }
+
+	private:
+		MappedBlob(void* view, SIZE_T size) : mView(view), mSize(size) {}
+		~MappedBlob() { UnmapViewOfFile(mView); }
+
+		atomic<ULONG> mRefCount{ 1 };
+		void* mView = nullptr;
+		SIZE_T mSize = 0;
+	};
+}
+
+ShaderCache::ShaderCache(const wstring& directory) :
+	mDirectory(directory + L"\\")
+{
+	CreateDirectoryW(directory.c_str(), nullptr);
+}
+
+ComPtr<ID3DBlob> ShaderCache::Compile(
+	const wstring& filename,
+	const D3D_SHADER_MACRO* defines,
+	const string& entrypoint,
+	const string& target)
+{
+	// Everything that changes the bytecode apart from the source itself.
+	const UINT compilerVersion = D3D_COMPILER_VERSION;
+	const UINT compileFlags = D3DUtil::ShaderCompileFlags();
+	uint64_t options = HashBytes(&compilerVersion, sizeof(compilerVersion));
+	options = HashBytes(&compileFlags, sizeof(compileFlags), options);
+	options = HashDefines(defines, options);
+	options = Hash(entrypoint, options);
+	options = Hash(target, options);
+
+	const wstring manifest = PathFor(Hash(filename, options), L".dep");
+
+	uint64_t key = 0;
+	vector<Dependency> dependencies;
+	if (ReadManifest(manifest, key, dependencies))
+	{
+		bool upToDate = true;
+		vector<char> data;
+		for (auto& dependency : dependencies)
+		{
+			if (!ReadFileBytes(dependency.Filename, data) || HashBytes(data.data(), data.size()) != dependency.Hash)
+			{
+				upToDate = false;
+				break;
+			}
+		}
+
+		ComPtr<ID3DBlob> bytecode = upToDate ? MapBytecode(key) : nullptr;
+		if (bytecode != nullptr)
+		{
+			mHits++;
+			return bytecode;
+		}
+	}
+
+	vector<char> source;
+	if (!ReadFileBytes(filename, source))
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+
+	RecordingInclude include(DirectoryOf(filename));
+	ComPtr<ID3DBlob> preprocessed;
+	ComPtr<ID3DBlob> errors;
+	HRESULT hr = D3DPreprocess(source.data(), source.size(), nullptr, defines, &include,
+		&preprocessed, &errors);
+
+	// The compiler reports the error with the right file names.
+	if (FAILED(hr))
+	{
+		return D3DUtil::CompileShader(filename, defines, entrypoint, target);
+	}
+
+	key = HashBytes(preprocessed->GetBufferPointer(), preprocessed->GetBufferSize(), options);
+
+	dependencies.clear();
+	dependencies.push_back({ filename, HashBytes(source.data(), source.size()) });
+	for (auto& file : include.Files)
+	{
+		dependencies.push_back({ file.first, file.second });
+	}
+
+	// A different request can have produced the same preprocessed source already.
+	ComPtr<ID3DBlob> bytecode = MapBytecode(key);
+	if (bytecode != nullptr)
+	{
+		mHits++;
+	}
+	else
+	{
+		bytecode = D3DUtil::CompileShader(filename, defines, entrypoint, target);
+		WriteBytecode(key, bytecode.Get());
+		mMisses++;
+	}
+
+	WriteManifest(manifest, key, dependencies);
+	return bytecode;
+}
+
+bool ShaderCache::ReadManifest(const wstring& filename, uint64_t& key, vector<Dependency>& dependencies) const
+{
+	ifstream fin(filename, ios::binary);
+	if (!fin)
+	{
+		return false;
+	}
+
+	UINT count = 0;
+	fin.read((char*)&key, sizeof(key));
+	fin.read((char*)&count, sizeof(count));
+	if (!fin || count > MaxDependencies)
+	{
+		return false;
+	}
+
+	dependencies.resize(count);
+	for (auto& dependency : dependencies)
+	{
+		UINT length = 0;
+		fin.read((char*)&dependency.Hash, sizeof(dependency.Hash));
+		fin.read((char*)&length, sizeof(length));
+		if (!fin || length > MAX_PATH)
+		{
+			return false;
+		}
+
+		dependency.Filename.resize(length);
+		fin.read((char*)&dependency.Filename[0], length * sizeof(wchar_t));
+	}
+
+	return (bool)fin;
+}
+
+void ShaderCache::WriteManifest(const wstring& filename, uint64_t key, const vector<Dependency>& dependencies) const
+{
+	ofstream fout(filename, ios::binary | ios::trunc);
+
+	UINT count = (UINT)dependencies.size();
+	fout.write((const char*)&key, sizeof(key));
+	fout.write((const char*)&count, sizeof(count));
+
+	for (auto& dependency : dependencies)
+	{
+		UINT length = (UINT)dependency.Filename.size();
+		fout.write((const char*)&dependency.Hash, sizeof(dependency.Hash));
+		fout.write((const char*)&length, sizeof(length));
+		fout.write((const char*)dependency.Filename.c_str(), length * sizeof(wchar_t));
+	}
+}
+
+ComPtr<ID3DBlob> ShaderCache::MapBytecode(uint64_t key) const
+{
+	return MappedBlob::Open(PathFor(key, L".cso"));
+}
+
+void ShaderCache::WriteBytecode(uint64_t key, ID3DBlob* bytecode) const
+{
+	// Written under a temporary name and moved into place, so a reader never maps half a file.
+	const wstring filename = PathFor(key, L".cso");
+	const wstring temporary = filename + L"." + to_wstring(hash<thread::id>()(this_thread::get_id()));
+
+	{
+		ofstream fout(temporary, ios::binary | ios::trunc);
+		fout.write((const char*)bytecode->GetBufferPointer(), bytecode->GetBufferSize());
+	}
+
+	MoveFileExW(temporary.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING);
+}
+
+wstring ShaderCache::PathFor(uint64_t key, const wchar_t* extension) const
+{
+	wchar_t name[17];
+	swprintf_s(name, L"%016llx", key);
+	return mDirectory + name + extension;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include <atomic>
+
+// Compiled shaders kept on disk under the hash of their preprocessed source, defines, entry point,
+// target and compile flags. Next to it every request remembers the files it was built from with
+// their content hashes, so as long as none of them changed the bytecode is mapped without even
+// running the preprocessor. Editing Common.hlsl changes its hash and sends every shader including
+// it through the preprocessor again.
+class ShaderCache
+{
+public:
+	ShaderCache(const wstring& directory = L"ShaderCache");
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+	~ShaderCache() = default;
+
+	// Same arguments as D3DUtil::CompileShader. Safe to call from several jobs at once.
+	ComPtr<ID3DBlob> Compile(
+		const wstring& filename,
+		const D3D_SHADER_MACRO* defines,
+		const string& entrypoint,
+		const string& target);
+
+	int Hits() const { return mHits; }
+	int Misses() const { return mMisses; }
+
+private:
+	struct Dependency
+	{
+		wstring Filename;
+		uint64_t Hash = 0;
+	};
+
+	bool ReadManifest(const wstring& filename, uint64_t& key, vector<Dependency>& dependencies) const;
+	void WriteManifest(const wstring& filename, uint64_t key, const vector<Dependency>& dependencies) const;
+
+	ComPtr<ID3DBlob> MapBytecode(uint64_t key) const;
+	void WriteBytecode(uint64_t key, ID3DBlob* bytecode) const;
+
+	wstring PathFor(uint64_t key, const wchar_t* extension) const;
+
+private:
+	wstring mDirectory;
+
+	atomic<int> mHits{ 0 };
+	atomic<int> mMisses{ 0 };
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "D3DUtil.h"
+
+// C++ expansion of the layouts in Shaders/Layouts.h. The HLSL type names map to the DirectXMath
+// storage types, and each generated struct checks its offsets against HLSL packing in a static_assert.
+// The structs have no default member values; value initialize them with {}.
+namespace ShaderLayout
+{
+	typedef XMFLOAT4X4 float4x4;
+	typedef XMFLOAT4 float4;
+	typedef XMFLOAT3 float3;
+	typedef XMFLOAT2 float2;
+	typedef XMUINT2 uint2;
+	typedef UINT uint;
+
+	// Matrices and structs start a new 16 byte register in a cbuffer; vectors and scalars only when
+	// they would straddle one.
+	template<typename T> struct StartsRegister { static const bool Value = true; };
+	template<> struct StartsRegister<float> { static const bool Value = false; };
+	template<> struct StartsRegister<uint> { static const bool Value = false; };
+	template<> struct StartsRegister<float2> { static const bool Value = false; };
+	template<> struct StartsRegister<uint2> { static const bool Value = false; };
+	template<> struct StartsRegister<float3> { static const bool Value = false; };
+	template<> struct StartsRegister<float4> { static const bool Value = false; };
+
+	constexpr UINT AlignRegister(UINT offset)
+	{
+		return (offset + 15) / 16 * 16;
+	}
+
+	// Where HLSL puts a member of the given size at the first free offset. Structured buffers pack
+	// tightly, so there it is always the offset itself.
+	constexpr UINT HlslOffset(UINT offset, UINT size, bool startsRegister, bool cbuffer)
+	{
+		return cbuffer && (startsRegister || offset / 16 != (offset + size - 1) / 16) ? AlignRegister(offset) : offset;
+	}
+}
+
+#define LAYOUT_DECLARE_FIELD(type, name) type name;
+#define LAYOUT_DECLARE_ARRAY(type, name, count) type name[count];
+#define LAYOUT_DECLARE_PAD(name) uint name;
+
+// Array elements of a cbuffer are padded to whole registers, which C++ only matches if the element
+// already is a multiple of 16 bytes.
+#define LAYOUT_CHECK_FIELD(type, name) \
+	offset = ShaderLayout::HlslOffset(offset, sizeof(type), ShaderLayout::StartsRegister<type>::Value, cbuffer); \
+	matches = matches && offset == offsetof(Self, name); \
+	offset += sizeof(type);
+#define LAYOUT_CHECK_ARRAY(type, name, count) \
+	matches = matches && (!cbuffer || sizeof(type) % 16 == 0); \
+	offset = cbuffer ? ShaderLayout::AlignRegister(offset) : offset; \
+	matches = matches && offset == offsetof(Self, name); \
+	offset += sizeof(type) * count;
+#define LAYOUT_CHECK_PAD(name) LAYOUT_CHECK_FIELD(uint, name)
+
+#define LAYOUT_SKIP_FIELD(type, name)
+#define LAYOUT_SKIP_ARRAY(type, name, count)
+#define LAYOUT_COUNT_PAD(name) bytes += sizeof(uint);
+
+#define LAYOUT_STRUCT(Name, Cbuffer, LIST) \
+	namespace ShaderLayout \
+	{ \
+		struct Name \
+		{ \
+			LIST(LAYOUT_DECLARE_FIELD, LAYOUT_DECLARE_ARRAY, LAYOUT_DECLARE_PAD) \
+			\
+			static constexpr bool MatchesHlsl() \
+			{ \
+				typedef Name Self; \
+				const bool cbuffer = Cbuffer; \
+				bool matches = true; \
+				UINT offset = 0; \
+				LIST(LAYOUT_CHECK_FIELD, LAYOUT_CHECK_ARRAY, LAYOUT_CHECK_PAD) \
+				return matches && offset == sizeof(Self); \
+			} \
+			\
+			static constexpr UINT PaddingBytes() \
+			{ \
+				UINT bytes = 0; \
+				LIST(LAYOUT_SKIP_FIELD, LAYOUT_SKIP_ARRAY, LAYOUT_COUNT_PAD) \
+				return bytes; \
+			} \
+		}; \
+		static_assert(Name::MatchesHlsl(), #Name " does not match its HLSL layout"); \
+	} \
+	using ShaderLayout::Name;
+
+#define LAYOUT_STRUCTURED(Name, LIST) LAYOUT_STRUCT(Name, false, LIST)
+#define LAYOUT_CBUFFER(Name, Buffer, Register, LIST) LAYOUT_STRUCT(Name, true, LIST)
+
+#include "Shaders/Layouts.h"
@@ -0,0 +1,99 @@
+#include "ShaderPermutations.h"
+#include "JobSystem.h"
+
+ShaderPermutations::ShaderPermutations(ShaderCache& cache, const wstring& filename, const string& entrypoint,
+	const string& target, const vector<ShaderFeature>& features) :
+	mCache(cache), mFilename(filename), mEntryPoint(entrypoint), mTarget(target), mFeatures(features)
+{
+	UINT shift = 0;
+	for (auto& feature : mFeatures)
+	{
+		mShifts.push_back(shift);
+		shift += max(feature.Bits, 1u);
+	}
+	assert(shift <= 64);
+}
+
+uint64_t ShaderPermutations::Key(const vector<UINT>& values) const
+{
+	assert(values.size() == mFeatures.size());
+
+	uint64_t key = 0;
+	for (size_t i = 0; i < mFeatures.size(); ++i)
+	{
+		assert(values[i] < (1ull << max(mFeatures[i].Bits, 1u)));
+		key |= (uint64_t)values[i] << mShifts[i];
+	}
+	return key;
+}
+
+void ShaderPermutations::Compile(const vector<uint64_t>& keys)
+{
+	vector<uint64_t> missing;
+	{
+		lock_guard<mutex> lock(mLock);
+		for (uint64_t key : keys)
+		{
+			if (mBytecode.find(key) == mBytecode.end() && find(missing.begin(), missing.end(), key) == missing.end())
+			{
+				missing.push_back(key);
+			}
+		}
+	}
+
+	JobSystem::GetInstance().ParallelFor(0, (int)missing.size(), [this, &missing](int i)
+		{
+			Build(missing[i]);
+		});
+}
+
+ComPtr<ID3DBlob> ShaderPermutations::Get(uint64_t key)
+{
+	{
+		lock_guard<mutex> lock(mLock);
+		auto it = mBytecode.find(key);
+		if (it != mBytecode.end())
+		{
+			return it->second;
+		}
+	}
+
+	return Build(key);
+}
+
+size_t ShaderPermutations::CompiledCount() const
+{
+	lock_guard<mutex> lock(mLock);
+	return mBytecode.size();
+}
+
+ComPtr<ID3DBlob> ShaderPermutations::Build(uint64_t key)
+{
+	vector<string> values(mFeatures.size());
+	vector<D3D_SHADER_MACRO> defines;
+
+	for (size_t i = 0; i < mFeatures.size(); ++i)
+	{
+		const ShaderFeature& feature = mFeatures[i];
+		const UINT bits = max(feature.Bits, 1u);
+		const UINT value = (UINT)((key >> mShifts[i]) & ((1ull << bits) - 1));
+
+		// Flags are tested with #ifdef, so a cleared flag must not be defined at all.
+		if (feature.Bits == 0 && value == 0)
+		{
+			continue;
+		}
+
+		values[i] = to_string(value);
+		defines.push_back({ feature.Define.c_str(), values[i].c_str() });
+	}
+	defines.push_back({ nullptr, nullptr });
+
+	// Compiled outside the lock; two callers racing for the same key both compile and the first one
+	// to finish wins.
+	ComPtr<ID3DBlob> bytecode = mCache.Compile(mFilename, defines.data(), mEntryPoint, mTarget);
+
+	lock_guard<mutex> lock(mLock);
+	auto it = mBytecode.emplace(key, bytecode).first;
+	return it->second;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ShaderCache.h"
+#include <mutex>
+
+// One switch of a shader. With Bits == 0 it is a flag and the macro is defined as 1 while the flag is
+// set; otherwise the key holds a Bits wide value the macro is always defined to, such as a light count.
+struct ShaderFeature
+{
+	string Define;
+	UINT Bits = 0;
+};
+
+// The variants of one shader entry point. A permutation is addressed by a key with one field per
+// feature, the first feature in the lowest bits. Only the permutations asked for are ever compiled.
+class ShaderPermutations
+{
+public:
+	ShaderPermutations(ShaderCache& cache, const wstring& filename, const string& entrypoint,
+		const string& target, const vector<ShaderFeature>& features);
+	ShaderPermutations(const ShaderPermutations& rhs) = delete;
+	ShaderPermutations& operator=(const ShaderPermutations& rhs) = delete;
+
+	// One value per feature, in the order the features were declared; flags take 0 or 1.
+	uint64_t Key(const vector<UINT>& values) const;
+
+	// Builds the permutations that are not compiled yet, spread over the job system.
+	void Compile(const vector<uint64_t>& keys);
+
+	// A permutation that was not compiled up front is compiled by the first caller.
+	ComPtr<ID3DBlob> Get(uint64_t key);
+
+	size_t CompiledCount() const;
+
+private:
+	ComPtr<ID3DBlob> Build(uint64_t key);
+
+private:
+	ShaderCache& mCache;
+	wstring mFilename;
+	string mEntryPoint;
+	string mTarget;
+
+	vector<ShaderFeature> mFeatures;
+	vector<UINT> mShifts;
+
+	mutable mutex mLock;
+	unordered_map<uint64_t, ComPtr<ID3DBlob>> mBytecode;
+};
@@ -12,17 +12,35 @@
 
 #include "LightingUtil.hlsl"
 
-struct MaterialData
+// Expansion of the shared layouts: structured buffer members keep their names, cbuffer members get
+// the g prefix.
+#define LAYOUT_STRUCT_FIELD(type, name) type name;
+#define LAYOUT_STRUCT_ARRAY(type, name, count) type name[count];
+#define LAYOUT_STRUCT_PAD(name) uint name;
+#define LAYOUT_CBUFFER_FIELD(type, name) type g##name;
+#define LAYOUT_CBUFFER_ARRAY(type, name, count) type g##name[count];
+#define LAYOUT_CBUFFER_PAD(name) uint name;
+
+#define LAYOUT_STRUCTURED(Name, LIST) \
+    struct Name { LIST(LAYOUT_STRUCT_FIELD, LAYOUT_STRUCT_ARRAY, LAYOUT_STRUCT_PAD) };
+#define LAYOUT_CBUFFER(Name, Buffer, Register, LIST) \
+    cbuffer Buffer : register(Register) { LIST(LAYOUT_CBUFFER_FIELD, LAYOUT_CBUFFER_ARRAY, LAYOUT_CBUFFER_PAD) };
+
+#include "Layouts.h"
+
+// The packed world matrix; mul(world, float4(p, 1.0f)) transforms a point, mul((float3x3)world, n) a normal.
+float3x4 ObjectWorld(ObjectData objData)
 {
-    float4 DiffuseAlbedo;
-    float3 FresnelR0;
-    float Roughness;
-    float4x4 MatTransform;
-    uint DiffuseMapIndex;
-    uint NormalMapIndex;
-    uint MatPad1;
-    uint MatPad2;
-};
+    return float3x4(objData.World[0], objData.World[1], objData.World[2]);
+}
+
+float2 ObjectTexC(ObjectData objData, float2 texC)
+{
+    uint2 packed = objData.TexScaleOffset;
+    float2 scale = f16tof32(uint2(packed.x, packed.x >> 16));
+    float2 offset = f16tof32(uint2(packed.y, packed.y >> 16));
+    return texC * scale + offset;
+}
 
 TextureCube gCubeMap : register(t0);
 Texture2D gShadowMap : register(t1);
@@ -30,6 +48,10 @@ Texture2D gShadowMap : register(t1);
 Texture2D gTextureMaps[10] : register(t2);
 
 StructuredBuffer<MaterialData> gMaterialData : register(t0, space1);
+StructuredBuffer<ObjectData> gObjectData : register(t1, space1);
+
+// Object indices of the visible instances of the current pass.
+StructuredBuffer<uint> gInstanceIndices : register(t2, space1);
 
 SamplerState gsamPointWrap : register(s0);
 SamplerState gsamPointClamp : register(s1);
@@ -39,41 +61,10 @@ SamplerState gsamAnisotropicWrap : register(s4);
 SamplerState gsamAnisotropicClamp : register(s5);
 SamplerComparisonState gsamShadow : register(s6);
 
-cbuffer cbPerObject : register(b0)
+// Set by the indirect arguments: where the instances of the current draw start in gInstanceIndices.
+cbuffer cbInstances : register(b0)
 {
-    float4x4 gWorld;
-    float4x4 gTexTransform;
-    uint gMaterialIndex;
-    uint gObjPad0;
-    uint gObjPad1;
-    uint gObjPad2;
-}
-
-cbuffer cbPass : register(b1)
-{
-    float4x4 gView;
-    float4x4 gInvView;
-    float4x4 gProj;
-    float4x4 gInvProj;
-    float4x4 gViewProj;
-    float4x4 gInvViewProj;
-    float4x4 gShadowTransform;
-    float3 gEyePosW;
-    float cbPerObjectPad1;
-    float2 gRenderTargetSize;
-    float2 gInvRenderTargetSize;
-    float gNearZ;
-    float gFarZ;
-    float gTotalTime;
-    float gDeltaTime;
-    float4 gAmbientLight;
-
-    // float4 gFogColor;
-    // float gFogStart;
-    // float gFogRange;
-    // float2 cbPerObjectPad2;
-    
-    Light gLights[MaxLights];
+    uint gFirstInstance;
 };
 
 float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float3 tangentW)
@@ -28,25 +28,33 @@ struct VertexOut
     float3 NormalW : NORMAL;
     float3 TangentW : TANGENT;
     float2 TexC : TEXCOORD;
+
+    nointerpolation uint MatIndex : MATINDEX;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
     VertexOut vout = (VertexOut) 0.0f;
 
-    MaterialData matData = gMaterialData[gMaterialIndex];
+    ObjectData objData = gObjectData[gInstanceIndices[gFirstInstance + instanceID]];
+    float3x4 world = ObjectWorld(objData);
+    uint matIndex = objData.MaterialIndex;
+
+    vout.MatIndex = matIndex;
+
+    MaterialData matData = gMaterialData[matIndex];
     
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = float4(mul(world, float4(vin.PosL, 1.0f)), 1.0f);
     vout.PosW = posW.xyz;
     
-    vout.NormalW = mul(vin.NormalL, (float3x3) gWorld);
+    vout.NormalW = mul((float3x3) world, vin.NormalL);
 
-    vout.TangentW = mul(vin.TangentU, (float3x3) gWorld);
+    vout.TangentW = mul((float3x3) world, vin.TangentU);
     
     vout.PosH = mul(posW, gViewProj);
     
-    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-    vout.TexC = mul(texC, matData.MatTransform).xy;
+    float2 texC = ObjectTexC(objData, vin.TexC);
+    vout.TexC = mul(float4(texC, 0.0f, 1.0f), matData.MatTransform).xy;
 
     vout.ShadowPosH = mul(posW, gShadowTransform);
 
@@ -55,7 +63,7 @@ VertexOut VS(VertexIn vin)
 
 float4 PS(VertexOut pin) : SV_Target
 {
-    MaterialData matData = gMaterialData[gMaterialIndex];
+    MaterialData matData = gMaterialData[pin.MatIndex];
     float4 diffuseAlbedo = matData.DiffuseAlbedo;
     float3 fresnelR0 = matData.FresnelR0;
     float roughness = matData.Roughness;
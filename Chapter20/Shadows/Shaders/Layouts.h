@@ -0,0 +1,49 @@
+// The buffer layouts shared by the C++ side and the shaders. ShaderLayout.h and Common.hlsl define
+// the LAYOUT_* macros for their language and include this file, so both declarations are generated
+// from the lists below and cannot drift apart. On the C++ side every layout is checked at compile
+// time against the HLSL packing rules; a member that HLSL would move to the next 16 byte register
+// fails the build until the list is reordered or padded.
+//
+// A list takes FIELD(type, name), ARRAY(type, name, count) and PAD(name). Cbuffer members get the
+// g prefix in HLSL.
+
+// World holds the first three rows of the transposed world matrix, the last one is always 0 0 0 1.
+// TexScaleOffset is the texture transform as half precision scale.xy and offset.xy.
+#define OBJECT_DATA_LAYOUT(FIELD, ARRAY, PAD) \
+    ARRAY(float4, World, 3) \
+    FIELD(uint2, TexScaleOffset) \
+    FIELD(uint, MaterialIndex) \
+    PAD(ObjPad0)
+
+#define PASS_CONSTANTS_LAYOUT(FIELD, ARRAY, PAD) \
+    FIELD(float4x4, View) \
+    FIELD(float4x4, InvView) \
+    FIELD(float4x4, Proj) \
+    FIELD(float4x4, InvProj) \
+    FIELD(float4x4, ViewProj) \
+    FIELD(float4x4, InvViewProj) \
+    FIELD(float4x4, ShadowTransform) \
+    FIELD(float3, EyePosW) \
+    PAD(PassPad0) \
+    FIELD(float2, RenderTargetSize) \
+    FIELD(float2, InvRenderTargetSize) \
+    FIELD(float, NearZ) \
+    FIELD(float, FarZ) \
+    FIELD(float, TotalTime) \
+    FIELD(float, DeltaTime) \
+    FIELD(float4, AmbientLight) \
+    ARRAY(Light, Lights, MaxLights)
+
+#define MATERIAL_DATA_LAYOUT(FIELD, ARRAY, PAD) \
+    FIELD(float4, DiffuseAlbedo) \
+    FIELD(float3, FresnelR0) \
+    FIELD(float, Roughness) \
+    FIELD(float4x4, MatTransform) \
+    FIELD(uint, DiffuseMapIndex) \
+    FIELD(uint, NormalMapIndex) \
+    PAD(MaterialPad0) \
+    PAD(MaterialPad1)
+
+LAYOUT_STRUCTURED(ObjectData, OBJECT_DATA_LAYOUT)
+LAYOUT_CBUFFER(PassConstants, cbPass, b1, PASS_CONSTANTS_LAYOUT)
+LAYOUT_STRUCTURED(MaterialData, MATERIAL_DATA_LAYOUT)
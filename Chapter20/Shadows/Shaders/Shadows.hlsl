@@ -10,27 +10,34 @@ struct VertexOut
 {
     float4 PosH : SV_POSITION;
     float2 TexC : TEXCOORD0;
+
+    nointerpolation uint MatIndex : MATINDEX;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
     VertexOut vout = (VertexOut) 0.0f;
 
-    MaterialData matData = gMaterialData[gMaterialIndex];
+    ObjectData objData = gObjectData[gInstanceIndices[gFirstInstance + instanceID]];
+    uint matIndex = objData.MaterialIndex;
+
+    vout.MatIndex = matIndex;
+
+    MaterialData matData = gMaterialData[matIndex];
     
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = float4(mul(ObjectWorld(objData), float4(vin.PosL, 1.0f)), 1.0f);
     
     vout.PosH = mul(posW, gViewProj);
     
-    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-    vout.TexC = mul(texC, matData.MatTransform).xy;
+    float2 texC = ObjectTexC(objData, vin.TexC);
+    vout.TexC = mul(float4(texC, 0.0f, 1.0f), matData.MatTransform).xy;
 
     return vout;
 }
 
 void PS(VertexOut pin) : SV_Target
 {
-    MaterialData matData = gMaterialData[gMaterialIndex];
+    MaterialData matData = gMaterialData[pin.MatIndex];
     float4 diffuseAlbedo = matData.DiffuseAlbedo;
     uint diffuseTexIndex = matData.DiffuseMapIndex;
     
@@ -14,13 +14,14 @@ struct VertexOut
     float3 PosL : POSITION1;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
     VertexOut vout;
     
     vout.PosL = vin.PosL;
     
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    ObjectData objData = gObjectData[gInstanceIndices[gFirstInstance + instanceID]];
+    float4 posW = float4(mul(ObjectWorld(objData), float4(vin.PosL, 1.0f)), 1.0f);
 
     posW.xyz += gEyePosW;
     
@@ -16,22 +16,80 @@ protected:
 	virtual void Build() override;
 
 private:
-	void LoadTextures();
+	void LoadTextures(const vector<ComPtr<ID3DBlob>>& textureFiles);
 	void BuildRootSignature();
 	void BuildDescriptorHeaps();
 	void BuildShadersAndInputLayout();
-	void BuildShapeGeometry();
-	void BuildSkullGeometry();
+	unique_ptr<MeshGeometry> BuildShapeGeometry();
+	unique_ptr<MeshGeometry> BuildSkullGeometry();
 	void BuildMaterials();
 	void BuildRenderItems();
 	void BuildFrameResources();
 	void BuildPSOs();
+};
 
-private:
-	UINT mShadowMapHeapIndex = 0;
+struct TextureFile
+{
+	const char* Name;
+	const wchar_t* Filename;
+};
+
+const TextureFile TextureFiles[] =
+{
+	{ "bricksDiffuseMap", L"../../Textures/bricks2.dds" },
+	{ "bricksNormalMap", L"../../Textures/bricks2_nmap.dds" },
+	{ "tileDiffuseMap", L"../../Textures/tile.dds" },
+	{ "tileNormalMap", L"../../Textures/tile_nmap.dds" },
+	{ "defaultDiffuseMap", L"../../Textures/white1x1.dds" },
+	{ "defaultNormalMap", L"../../Textures/default_nmap.dds" },
+	{ "skyCubeMap", L"../../Textures/desertcube1024.dds" }
+};
 
-	UINT mNullCubeSrvIndex = 0;
-	UINT mNullTexSrvIndex = 0;
+// Length of gTextureMaps in Common.hlsl.
+const UINT TextureTableSize = 10;
+
+const UINT SrvPersistentCount = 1024;
+const UINT SrvTransientCount = 1024;
+const UINT SrvStagingCount = 256;
+
+// The scene only has the three directional lights set up in UpdateMainPassCB.
+const UINT SceneDirLights = 3;
+
+const vector<ShaderFeature> LitFeatures =
+{
+	{ "NUM_DIR_LIGHTS", 5 },
+	{ "NUM_POINT_LIGHTS", 5 },
+	{ "NUM_SPOT_LIGHTS", 5 },
+	{ "ALPHA_TEST" }
+};
+
+const vector<ShaderFeature> AlphaTestFeatures =
+{
+	{ "ALPHA_TEST" }
+};
+
+struct ShaderFile
+{
+	const char* Name;
+	const wchar_t* Filename;
+	const char* EntryPoint;
+	const char* Target;
+	vector<ShaderFeature> Features;
+	// Compiled at startup, the first one is the variant the PSOs are built with. Any other
+	// permutation is compiled the first time it is asked for.
+	vector<vector<UINT>> Permutations;
+};
+
+const ShaderFile ShaderFiles[] =
+{
+	{ "standardVS", L"Shaders\\Default.hlsl", "VS", "vs_5_1", {}, { {} } },
+	{ "opaquePS", L"Shaders\\Default.hlsl", "PS", "ps_5_1", LitFeatures, { { SceneDirLights, 0, 0, 0 } } },
+	{ "shadowVS", L"Shaders\\Shadows.hlsl", "VS", "vs_5_1", {}, { {} } },
+	{ "shadowOpaquePS", L"Shaders\\Shadows.hlsl", "PS", "ps_5_1", AlphaTestFeatures, { { 0 } } },
+	{ "debugVS", L"Shaders\\ShadowDebug.hlsl", "VS", "vs_5_1", {}, { {} } },
+	{ "debugPS", L"Shaders\\ShadowDebug.hlsl", "PS", "ps_5_1", {}, { {} } },
+	{ "skyVS", L"Shaders\\Sky.hlsl", "VS", "vs_5_1", {}, { {} } },
+	{ "skyPS", L"Shaders\\Sky.hlsl", "PS", "ps_5_1", {}, { {} } }
 };
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
@@ -87,51 +145,89 @@ void ShadowApp::CreateRtvAndDsvDescriptorHeaps()
 
 void ShadowApp::Build()
 {
+	// File reads, parsing, generation and shader compiles run concurrently. Device calls are free
+	// threaded, so only the tasks recording into mCommandList are chained to keep them apart.
+	TaskGraph graph;
 
-	LoadTextures();
-	BuildRootSignature();
-	BuildDescriptorHeaps();
-	BuildShadersAndInputLayout();
-	BuildShapeGeometry();
-	BuildSkullGeometry();
-	BuildMaterials();
-	BuildRenderItems();
-	BuildFrameResources();
-	BuildPSOs();
-}
+	const int textureCount = _countof(TextureFiles);
+	const int shaderCount = _countof(ShaderFiles);
 
-void ShadowApp::LoadTextures()
-{
-	vector<string> texNames =
+	vector<ComPtr<ID3DBlob>> textureFiles(textureCount);
+	unique_ptr<MeshGeometry> shapeGeo;
+	unique_ptr<MeshGeometry> skullGeo;
+
+	int loadTextures = graph.AddTask("LoadTextures", [this, &textureFiles]() { LoadTextures(textureFiles); });
+	for (int i = 0; i < textureCount; ++i)
 	{
-		"bricksDiffuseMap",
-		"bricksNormalMap",
-		"tileDiffuseMap",
-		"tileNormalMap",
-		"defaultDiffuseMap",
-		"defaultNormalMap",
-		"skyCubeMap"
-	};
+		int read = graph.AddTask(string("Read ") + TextureFiles[i].Name, [&textureFiles, i]()
+			{
+				textureFiles[i] = D3DUtil::LoadBinary(TextureFiles[i].Filename);
+			});
+		graph.Precede(read, loadTextures);
+	}
 
-	vector<wstring> texFilenames =
+	int shadersAndInputLayout = graph.AddTask("BuildShadersAndInputLayout", [this]() { BuildShadersAndInputLayout(); });
+	for (int i = 0; i < shaderCount; ++i)
 	{
-		L"../../Textures/bricks2.dds",
-		L"../../Textures/bricks2_nmap.dds",
-		L"../../Textures/tile.dds",
-		L"../../Textures/tile_nmap.dds",
-		L"../../Textures/white1x1.dds",
-		L"../../Textures/default_nmap.dds",
-		L"../../Textures/desertcube1024.dds"
-	};
+		const ShaderFile& file = ShaderFiles[i];
+		auto& permutations = mShaderPermutations[file.Name];
+		permutations = make_unique<ShaderPermutations>(mShaderCache, file.Filename, file.EntryPoint, file.Target, file.Features);
+
+		int compile = graph.AddTask(string("Compile ") + file.Name, [&file, &permutations]()
+			{
+				vector<uint64_t> keys;
+				for (auto& values : file.Permutations)
+				{
+					keys.push_back(permutations->Key(values));
+				}
+				permutations->Compile(keys);
+			});
+		graph.Precede(compile, shadersAndInputLayout);
+	}
 
-	for (int i = 0; i < texNames.size(); ++i)
+	int shapeGeometry = graph.AddTask("BuildShapeGeometry", [this, &shapeGeo]() { shapeGeo = BuildShapeGeometry(); });
+	int skullGeometry = graph.AddTask("BuildSkullGeometry", [this, &skullGeo]() { skullGeo = BuildSkullGeometry(); });
+	int uploadGeometry = graph.AddTask("UploadGeometry", [this, &shapeGeo, &skullGeo]()
+		{
+			UploadGeometry(move(shapeGeo));
+			if (skullGeo != nullptr)
+			{
+				UploadGeometry(move(skullGeo));
+			}
+		});
+	graph.Precede(shapeGeometry, uploadGeometry);
+	graph.Precede(skullGeometry, uploadGeometry);
+	graph.Precede(loadTextures, uploadGeometry);
+
+	int rootSignature = graph.AddTask("BuildRootSignature", [this]() { BuildRootSignature(); });
+	int descriptorHeaps = graph.AddTask("BuildDescriptorHeaps", [this]() { BuildDescriptorHeaps(); });
+	int materials = graph.AddTask("BuildMaterials", [this]() { BuildMaterials(); });
+	int renderItems = graph.AddTask("BuildRenderItems", [this]() { BuildRenderItems(); });
+	int frameResources = graph.AddTask("BuildFrameResources", [this]() { BuildFrameResources(); });
+	int psos = graph.AddTask("BuildPSOs", [this]() { BuildPSOs(); });
+
+	graph.Precede(loadTextures, descriptorHeaps);
+	graph.Precede(uploadGeometry, renderItems);
+	graph.Precede(materials, renderItems);
+	graph.Precede(renderItems, frameResources);
+	graph.Precede(shadersAndInputLayout, psos);
+	graph.Precede(rootSignature, psos);
+
+	graph.Run(JobSystem::GetInstance());
+
+	AddStartupPhases(graph);
+}
+
+void ShadowApp::LoadTextures(const vector<ComPtr<ID3DBlob>>& textureFiles)
+{
+	for (int i = 0; i < _countof(TextureFiles); ++i)
 	{
 		auto texMap = make_unique<Texture>();
-		texMap->Name = texNames[i];
-		texMap->Filename = texFilenames[i];
-		ThrowIfFailed(CreateDDSTextureFromFile12(md3dDevice.Get(),
-			mCommandList.Get(), texMap->Filename.c_str(),
-			texMap->Resource, texMap->UploadHeap));
+		texMap->Name = TextureFiles[i].Name;
+		texMap->Filename = TextureFiles[i].Filename;
+		ThrowIfFailed(CreateDDSTextureFromMemory12(md3dDevice.Get(),
+			mCommandList.Get(), (const uint8_t*)textureFiles[i]->GetBufferPointer(),
+			textureFiles[i]->GetBufferSize(), texMap->Resource, texMap->UploadHeap));
 
 		mTextures[texMap->Name] = move(texMap);
 	}
@@ -143,18 +239,20 @@ void ShadowApp::BuildRootSignature()
 	texTable0.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0, 0);
 
 	CD3DX12_DESCRIPTOR_RANGE texTable1;
-	texTable0.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 10, 2, 0);
+	texTable1.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, TextureTableSize, 2, 0);
 
-	CD3DX12_ROOT_PARAMETER slotRootParameter[5];
-	slotRootParameter[0].InitAsConstantBufferView(0);
+	CD3DX12_ROOT_PARAMETER slotRootParameter[7];
+	slotRootParameter[0].InitAsShaderResourceView(2, 1);
 	slotRootParameter[1].InitAsConstantBufferView(1);
 	slotRootParameter[2].InitAsShaderResourceView(0, 1);
 	slotRootParameter[3].InitAsDescriptorTable(1, &texTable0, D3D12_SHADER_VISIBILITY_PIXEL);
 	slotRootParameter[4].InitAsDescriptorTable(1, &texTable1, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[5].InitAsShaderResourceView(1, 1);
+	slotRootParameter[6].InitAsConstants(1, 0);
 
 	auto staticSamplers = StaticSampler::GetStaticSamplers();
 
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(5,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(7,
 		slotRootParameter,
 		(UINT)staticSamplers.size(),
 		staticSamplers.data(),
@@ -177,17 +275,15 @@ void ShadowApp::BuildRootSignature()
 		serializedRootSig->GetBufferPointer(),
 		serializedRootSig->GetBufferSize(),
 		IID_PPV_ARGS(mRootSignature.GetAddressOf())));
+	mPipelineCache->AddRootSignature(mRootSignature.Get(), serializedRootSig.Get());
+
+	mCommandSignature = IndirectDrawBuilder::CreateCommandSignature(md3dDevice.Get(), mRootSignature.Get(), 6);
 }
 
 void ShadowApp::BuildDescriptorHeaps()
 {
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 14;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
-
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	mSrvHeap = make_unique<DescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		SrvPersistentCount, SrvTransientCount, SrvStagingCount);
 
 	vector<ComPtr<ID3D12Resource>> tex2DList =
 	{
@@ -207,13 +303,14 @@ void ShadowApp::BuildDescriptorHeaps()
 	srvDesc.Texture2D.MostDetailedMip = 0;
 	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 
+	// Material DiffuseSrvHeapIndex and NormalSrvHeapIndex index into this table.
+	mTextureTable = mSrvHeap->AllocatePersistent(TextureTableSize);
+
 	for (int i = 0; i < tex2DList.size(); ++i)
 	{
 		srvDesc.Format = tex2DList[i]->GetDesc().Format;
 		srvDesc.Texture2D.MipLevels = tex2DList[i]->GetDesc().MipLevels;
-		md3dDevice->CreateShaderResourceView(tex2DList[i].Get(), &srvDesc, hDescriptor);
-
-		hDescriptor.Offset(1, mCbvSrvUavDescriptorSize);
+		md3dDevice->CreateShaderResourceView(tex2DList[i].Get(), &srvDesc, mSrvHeap->CpuHandle(mTextureTable, i));
 	}
 
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
@@ -221,57 +318,35 @@ void ShadowApp::BuildDescriptorHeaps()
 	srvDesc.TextureCube.MipLevels = skyCubeMap->GetDesc().MipLevels;
 	srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
 	srvDesc.Format = skyCubeMap->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, hDescriptor);
-
-	mSkyTexHeapIndex = (UINT)tex2DList.size();
-	mShadowMapHeapIndex = mSkyTexHeapIndex + 1;
-
-	mNullCubeSrvIndex = mShadowMapHeapIndex + 1;
-	mNullTexSrvIndex = mNullCubeSrvIndex + 1;
 
-	auto srvCpuStart = mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-	auto srvGpuStart = mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-	auto dsvCpuStart = mDsvHeap->GetCPUDescriptorHandleForHeapStart();
+	mSkySrv = mSrvHeap->AllocateStaging(1);
+	md3dDevice->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, mSrvHeap->StagingHandle(mSkySrv));
 
-	auto nullSrv = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, mNullCubeSrvIndex, mCbvSrvUavDescriptorSize);
-	mNullSrv = CD3DX12_GPU_DESCRIPTOR_HANDLE(srvGpuStart, mNullCubeSrvIndex, mCbvSrvUavDescriptorSize);
-
-	md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, nullSrv);
-	nullSrv.Offset(1, mCbvSrvUavDescriptorSize);
+	mNullSrvTable = mSrvHeap->AllocatePersistent(2);
+	md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, mSrvHeap->CpuHandle(mNullSrvTable, 0));
 
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 	srvDesc.Texture2D.MostDetailedMip = 0;
 	srvDesc.Texture2D.MipLevels = 1;
 	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, nullSrv);
+	md3dDevice->CreateShaderResourceView(nullptr, &srvDesc, mSrvHeap->CpuHandle(mNullSrvTable, 1));
 
+	// The shadow map is only read through the per frame table, so its view has no shader visible slot.
+	mShadowMapSrv = mSrvHeap->AllocateStaging(1);
 	mShadowMap->BuildDescriptors(
-		CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, mShadowMapHeapIndex, mCbvSrvUavDescriptorSize),
-		CD3DX12_GPU_DESCRIPTOR_HANDLE(srvGpuStart, mShadowMapHeapIndex, mCbvSrvUavDescriptorSize),
-		CD3DX12_CPU_DESCRIPTOR_HANDLE(dsvCpuStart, 1, mDsvDescriptorSize));
+		mSrvHeap->StagingHandle(mShadowMapSrv),
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT),
+		CD3DX12_CPU_DESCRIPTOR_HANDLE(mDsvHeap->GetCPUDescriptorHandleForHeapStart(), 1, mDsvDescriptorSize));
 }
 
 void ShadowApp::BuildShadersAndInputLayout()
 {
-	const D3D_SHADER_MACRO alphaTestDefines[] =
+	for (auto& file : ShaderFiles)
 	{
-		"ALPHA_TEST", "1",
-		NULL, NULL
-	};
-
-	mShaders["standardVS"] = D3DUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = D3DUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
-
-	mShaders["shadowVS"] = D3DUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["shadowOpaquePS"] = D3DUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "PS", "ps_5_1");
-	mShaders["shadowAlphaTestedPS"] = D3DUtil::CompileShader(L"Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1");
-
-	mShaders["debugVS"] = D3DUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["debugPS"] = D3DUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "PS", "ps_5_1");
-
-	mShaders["skyVS"] = D3DUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["skyPS"] = D3DUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "PS", "ps_5_1");
+		auto& permutations = mShaderPermutations[file.Name];
+		mShaders[file.Name] = permutations->Get(permutations->Key(file.Permutations[0]));
+	}
 
 	mStdInputLayout =
 	{
@@ -282,7 +357,7 @@ void ShadowApp::BuildShadersAndInputLayout()
 	};
 }
 
-void ShadowApp::BuildShapeGeometry()
+unique_ptr<MeshGeometry> ShadowApp::BuildShapeGeometry()
 {
 	GeometryGenerator geoGen;
 	auto box = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
@@ -392,12 +467,6 @@ void ShadowApp::BuildShapeGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = D3DUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = D3DUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -409,17 +478,17 @@ void ShadowApp::BuildShapeGeometry()
 	geo->DrawArgs["cylinder"] = cylinderSubmesh;
 	geo->DrawArgs["quad"] = quadSubmesh;
 
-	mGeometries[geo->Name] = move(geo);
+	return geo;
 }
 
-void ShadowApp::BuildSkullGeometry()
+unique_ptr<MeshGeometry> ShadowApp::BuildSkullGeometry()
 {
 	ifstream fin("Models/skull.txt");
 
 	if (!fin)
 	{
 		MessageBox(0, L"Models/skull.txt not found.", 0, 0);
-		return;
+		return nullptr;
 	}
 
 	UINT vcount = 0;
@@ -493,12 +562,6 @@ void ShadowApp::BuildSkullGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = D3DUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = D3DUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
@@ -512,7 +575,7 @@ void ShadowApp::BuildSkullGeometry()
 
 	geo->DrawArgs["skull"] = submesh;
 
-	mGeometries[geo->Name] = move(geo);
+	return geo;
 }
 
 void ShadowApp::BuildMaterials()
@@ -572,7 +635,7 @@ void ShadowApp::BuildMaterials()
 void ShadowApp::BuildRenderItems()
 {
 	auto skyRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&skyRitem->World, XMMatrixScaling(5000.0f, 5000.0f, 5000.0f));
+	AttachTransform(skyRitem.get(), XMMatrixScaling(5000.0f, 5000.0f, 5000.0f));
 	skyRitem->TexTransform = MathHelper::Identity4x4();
 	skyRitem->ObjCBIndex = 0;
 	skyRitem->Mat = mMaterials["sky"].get();
@@ -586,7 +649,7 @@ void ShadowApp::BuildRenderItems()
 	mAllRitems.push_back(std::move(skyRitem));
 
 	auto quadRitem = std::make_unique<RenderItem>();
-	quadRitem->World = MathHelper::Identity4x4();
+	AttachTransform(quadRitem.get(), XMMatrixIdentity());
 	quadRitem->TexTransform = MathHelper::Identity4x4();
 	quadRitem->ObjCBIndex = 1;
 	quadRitem->Mat = mMaterials["bricks0"].get();
@@ -600,7 +663,7 @@ void ShadowApp::BuildRenderItems()
 	mAllRitems.push_back(std::move(quadRitem));
 
 	auto boxRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(2.0f, 1.0f, 2.0f) * XMMatrixTranslation(0.0f, 0.5f, 0.0f));
+	AttachTransform(boxRitem.get(), XMMatrixScaling(2.0f, 1.0f, 2.0f) * XMMatrixTranslation(0.0f, 0.5f, 0.0f));
 	XMStoreFloat4x4(&boxRitem->TexTransform, XMMatrixScaling(1.0f, 0.5f, 1.0f));
 	boxRitem->ObjCBIndex = 2;
 	boxRitem->Mat = mMaterials["bricks0"].get();
@@ -614,7 +677,7 @@ void ShadowApp::BuildRenderItems()
 	mAllRitems.push_back(std::move(boxRitem));
 
 	auto skullRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&skullRitem->World, XMMatrixScaling(0.4f, 0.4f, 0.4f) * XMMatrixTranslation(0.0f, 1.0f, 0.0f));
+	AttachTransform(skullRitem.get(), XMMatrixScaling(0.4f, 0.4f, 0.4f) * XMMatrixTranslation(0.0f, 1.0f, 0.0f));
 	skullRitem->TexTransform = MathHelper::Identity4x4();
 	skullRitem->ObjCBIndex = 3;
 	skullRitem->Mat = mMaterials["skullMat"].get();
@@ -628,7 +691,7 @@ void ShadowApp::BuildRenderItems()
 	mAllRitems.push_back(std::move(skullRitem));
 
 	auto gridRitem = std::make_unique<RenderItem>();
-	gridRitem->World = MathHelper::Identity4x4();
+	AttachTransform(gridRitem.get(), XMMatrixIdentity());
 	XMStoreFloat4x4(&gridRitem->TexTransform, XMMatrixScaling(8.0f, 8.0f, 1.0f));
 	gridRitem->ObjCBIndex = 4;
 	gridRitem->Mat = mMaterials["tile0"].get();
@@ -653,10 +716,10 @@ void ShadowApp::BuildRenderItems()
 		XMMATRIX leftCylWorld = XMMatrixTranslation(-5.0f, 1.5f, -10.0f + i * 5.0f);
 		XMMATRIX rightCylWorld = XMMatrixTranslation(+5.0f, 1.5f, -10.0f + i * 5.0f);
 
-		XMMATRIX leftSphereWorld = XMMatrixTranslation(-5.0f, 3.5f, -10.0f + i * 5.0f);
-		XMMATRIX rightSphereWorld = XMMatrixTranslation(+5.0f, 3.5f, -10.0f + i * 5.0f);
+		// The spheres sit on top of the columns and follow them.
+		XMMATRIX sphereOnColumn = XMMatrixTranslation(0.0f, 2.0f, 0.0f);
 
-		XMStoreFloat4x4(&leftCylRitem->World, rightCylWorld);
+		AttachTransform(leftCylRitem.get(), rightCylWorld);
 		XMStoreFloat4x4(&leftCylRitem->TexTransform, brickTexTransform);
 		leftCylRitem->ObjCBIndex = objCBIndex++;
 		leftCylRitem->Mat = mMaterials["bricks0"].get();
@@ -666,7 +729,7 @@ void ShadowApp::BuildRenderItems()
 		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
-		XMStoreFloat4x4(&rightCylRitem->World, leftCylWorld);
+		AttachTransform(rightCylRitem.get(), leftCylWorld);
 		XMStoreFloat4x4(&rightCylRitem->TexTransform, brickTexTransform);
 		rightCylRitem->ObjCBIndex = objCBIndex++;
 		rightCylRitem->Mat = mMaterials["bricks0"].get();
@@ -676,7 +739,7 @@ void ShadowApp::BuildRenderItems()
 		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 		rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
 
-		XMStoreFloat4x4(&leftSphereRitem->World, leftSphereWorld);
+		AttachTransform(leftSphereRitem.get(), sphereOnColumn, rightCylRitem->Transform);
 		leftSphereRitem->TexTransform = MathHelper::Identity4x4();
 		leftSphereRitem->ObjCBIndex = objCBIndex++;
 		leftSphereRitem->Mat = mMaterials["mirror0"].get();
@@ -686,7 +749,7 @@ void ShadowApp::BuildRenderItems()
 		leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 		leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
 
-		XMStoreFloat4x4(&rightSphereRitem->World, rightSphereWorld);
+		AttachTransform(rightSphereRitem.get(), sphereOnColumn, leftCylRitem->Transform);
 		rightSphereRitem->TexTransform = MathHelper::Identity4x4();
 		rightSphereRitem->ObjCBIndex = objCBIndex++;
 		rightSphereRitem->Mat = mMaterials["mirror0"].get();
@@ -713,7 +776,7 @@ void ShadowApp::BuildFrameResources()
 	for (int i = 0; i < gNumFrameResources; ++i)
 	{
 		mFrameResources.push_back(make_unique<FrameResource>(md3dDevice.Get(),
-			2, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
+			(UINT)mAllRitems.size(), (UINT)mMaterials.size()));
 	}
 }
 
@@ -743,7 +806,7 @@ void ShadowApp::BuildPSOs()
 	opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
 	opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = mDepthStencilFormat;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
+	mPsoDescs["opaque"] = opaquePsoDesc;
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowPsoDesc = opaquePsoDesc;
 	shadowPsoDesc.RasterizerState.DepthBias = 100000;
@@ -763,7 +826,7 @@ void ShadowApp::BuildPSOs()
 
 	shadowPsoDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
 	shadowPsoDesc.NumRenderTargets = 0;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&shadowPsoDesc, IID_PPV_ARGS(&mPSOs["shadow_opaque"])));
+	mPsoDescs["shadow_opaque"] = shadowPsoDesc;
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC debugPsoDesc = opaquePsoDesc;
 	debugPsoDesc.pRootSignature = mRootSignature.Get();
@@ -778,7 +841,7 @@ void ShadowApp::BuildPSOs()
 		mShaders["debugPS"]->GetBufferSize()
 	};
 
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&debugPsoDesc, IID_PPV_ARGS(&mPSOs["debug"])));
+	mPsoDescs["debug"] = debugPsoDesc;
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC skyPsoDesc = opaquePsoDesc;
 	skyPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -794,5 +857,15 @@ void ShadowApp::BuildPSOs()
 		reinterpret_cast<BYTE*>(mShaders["skyPS"]->GetBufferPointer()),
 		mShaders["skyPS"]->GetBufferSize()
 	};
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&skyPsoDesc, IID_PPV_ARGS(&mPSOs["sky"])));
+	mPsoDescs["sky"] = skyPsoDesc;
+
+	// Started together so they compile side by side on the workers.
+	for (auto& desc : mPsoDescs)
+	{
+		mPipelineCache->Request(desc.second);
+	}
+	for (auto& desc : mPsoDescs)
+	{
+		mPSOs[desc.first] = mPipelineCache->Get(desc.second);
+	}
 }
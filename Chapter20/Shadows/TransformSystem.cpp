@@ -0,0 +1,140 @@
+#include "TransformSystem.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	// Smaller levels are not worth handing to the job system.
+	const int ParallelLevelSize = 1024;
+}
+
+const int TransformSystem::None;
+
+int TransformSystem::Create(FXMMATRIX local, int parent)
+{
+	assert(parent == None || (parent >= 0 && parent < Count()));
+
+	const int transform = Count();
+
+	XMFLOAT4X4A m;
+	XMStoreFloat4x4A(&m, local);
+	mLocal.push_back(m);
+	mWorld.push_back(m);
+
+	mParent.push_back(parent);
+	mFirstChild.push_back(None);
+	mNextSibling.push_back(None);
+	mDepth.push_back(0);
+
+	if (parent != None)
+	{
+		mNextSibling[transform] = mFirstChild[parent];
+		mFirstChild[parent] = transform;
+		mDepth[transform] = mDepth[parent] + 1;
+	}
+
+	mQueued.push_back(1);
+	mDirty.push_back(transform);
+
+	return transform;
+}
+
+void TransformSystem::SetLocal(int transform, FXMMATRIX local)
+{
+	XMStoreFloat4x4A(&mLocal[transform], local);
+
+	if (!mQueued[transform])
+	{
+		mQueued[transform] = 1;
+		mDirty.push_back(transform);
+	}
+}
+
+const vector<int>& TransformSystem::Update()
+{
+	mChanged.clear();
+	if (mDirty.empty())
+	{
+		return mChanged;
+	}
+
+	// A queued transform drags its whole subtree along. The list grows while it is walked, so
+	// grandchildren are picked up as well.
+	for (size_t k = 0; k < mDirty.size(); ++k)
+	{
+		for (int child = mFirstChild[mDirty[k]]; child != None; child = mNextSibling[child])
+		{
+			if (!mQueued[child])
+			{
+				mQueued[child] = 1;
+				mDirty.push_back(child);
+			}
+		}
+	}
+
+	// Parents are one level above their children, so going level by level is a topological order
+	// and the transforms of one level do not depend on each other.
+	sort(mDirty.begin(), mDirty.end(), [this](int a, int b)
+		{
+			return mDepth[a] != mDepth[b] ? mDepth[a] < mDepth[b] : a < b;
+		});
+
+	const int count = (int)mDirty.size();
+	for (int begin = 0; begin < count;)
+	{
+		int end = begin + 1;
+		while (end < count && mDepth[mDirty[end]] == mDepth[mDirty[begin]])
+		{
+			++end;
+		}
+
+		UpdateLevel(mDirty.data() + begin, end - begin);
+		begin = end;
+	}
+
+	for (int transform : mDirty)
+	{
+		mQueued[transform] = 0;
+	}
+
+	mChanged.swap(mDirty);
+	return mChanged;
+}
+
+void TransformSystem::UpdateLevel(const int* transforms, int count)
+{
+	auto updateRange = [this, transforms](int begin, int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				const int t = transforms[i];
+				const int parent = mParent[t];
+
+				XMMATRIX local = XMLoadFloat4x4A(&mLocal[t]);
+				if (parent == None)
+				{
+					XMStoreFloat4x4A(&mWorld[t], local);
+				}
+				else
+				{
+					XMMATRIX parentWorld = XMLoadFloat4x4A(&mWorld[parent]);
+					XMStoreFloat4x4A(&mWorld[t], XMMatrixMultiply(local, parentWorld));
+				}
+			}
+		};
+
+	if (count < ParallelLevelSize)
+	{
+		updateRange(0, count);
+		return;
+	}
+
+	// Blocks of a few hundred keep the per job overhead small next to the multiplies.
+	const int blockSize = 256;
+	const int blocks = (count + blockSize - 1) / blockSize;
+	JobSystem::GetInstance().ParallelFor(0, blocks, [&](int block)
+		{
+			updateRange(block * blockSize, min(count, (block + 1) * blockSize));
+		});
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <DirectXMath.h>
+
+using namespace std;
+using namespace DirectX;
+
+// Parent-child transforms kept in parallel arrays indexed by transform id. Setting a local matrix
+// only queues the transform; Update recomputes the queued transforms and their descendants and
+// nothing else, so its cost follows the number of changes rather than the size of the scene.
+class TransformSystem
+{
+public:
+	static const int None = -1;
+
+	// A parent has to be created before its children.
+	int Create(FXMMATRIX local, int parent = None);
+
+	void SetLocal(int transform, FXMMATRIX local);
+
+	int Count() const { return (int)mParent.size(); }
+	int Parent(int transform) const { return mParent[transform]; }
+
+	const XMFLOAT4X4A& Local(int transform) const { return mLocal[transform]; }
+	const XMFLOAT4X4A& World(int transform) const { return mWorld[transform]; }
+	const XMFLOAT4X4A* WorldData() const { return mWorld.data(); }
+
+	// Brings every world matrix up to date and returns the transforms whose world matrix was
+	// recomputed, parents before children. The list stays valid until the next call.
+	const vector<int>& Update();
+
+private:
+	void UpdateLevel(const int* transforms, int count);
+
+private:
+	vector<XMFLOAT4X4A> mLocal;
+	vector<XMFLOAT4X4A> mWorld;
+
+	vector<int> mParent;
+	vector<int> mFirstChild;
+	vector<int> mNextSibling;
+	vector<int> mDepth;
+
+	vector<int> mDirty;
+	vector<uint8_t> mQueued;
+	vector<int> mChanged;
+};
@@ -1,5 +1,5 @@
 #include "Waves.h"
-#include <ppl.h>
+#include "JobSystem.h"
 #include <algorithm>
 #include <vector>
 #include <cassert>
@@ -59,7 +59,7 @@ void Waves::Update(float dt)
 
 	if (t >= mTimeStep)
 	{
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
+		JobSystem::GetInstance().ParallelFor(1, mNumRows - 1, [this](int i)
 			{
 				for (int j = 1; j < mNumCols - 1; ++j)
 				{
@@ -77,7 +77,7 @@ void Waves::Update(float dt)
 
 		t = 0.0f;
 
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
+		JobSystem::GetInstance().ParallelFor(1, mNumRows - 1, [this](int i)
 			{
 				for (int j = 1; j < mNumCols - 1; ++j)
 				{
@@ -92,7 +92,7 @@ void BaseApp::Draw(const Timer& gt)
 	mCommandList->SetGraphicsRootConstantBufferView(passCBRootParameterIndex, passCB->GetGPUVirtualAddress());
 #pragma region RenderItems
 
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+	DrawOpaque(mCommandList.Get());
 
 	mCommandList->SetPipelineState(mPSOs["alphaTested" + psoSuffix].Get());
 	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTested]);
@@ -296,6 +296,11 @@ void BaseApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const vector<R
 	}
 }
 
+void BaseApp::DrawOpaque(ID3D12GraphicsCommandList* cmdList)
+{
+	DrawRenderItems(cmdList, mRitemLayer[(int)RenderLayer::Opaque]);
+}
+
 void BaseApp::BuildWireFramePSOs()
 {
 	for (auto& desc : mPsoDescs)
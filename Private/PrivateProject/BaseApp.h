@@ -32,6 +32,9 @@ public:
 
 	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const vector<RenderItem*>& ritems);
 
+	// Draws the opaque layer with the tessellation PSO bound; apps can replace the land drawn there.
+	virtual void DrawOpaque(ID3D12GraphicsCommandList* cmdList);
+
 	void BuildWireFramePSOs();
 
 	void EnableD3D12DebugLayer();
@@ -64,6 +67,7 @@ protected:
 	vector<D3D12_INPUT_ELEMENT_DESC> mStdInputLayout;
 	vector<D3D12_INPUT_ELEMENT_DESC> mTreeSpriteInputLayout;
 	vector<D3D12_INPUT_ELEMENT_DESC> mLandInputLayout;
+	vector<D3D12_INPUT_ELEMENT_DESC> mTerrainInputLayout;
 
 	vector<unique_ptr<RenderItem>> mAllRitems;
 
@@ -0,0 +1,73 @@
+#include "BillboardBatcher.h"
+#include <ppl.h>
+
+void BillboardBatcher::SetTiles(vector<ScatterTile> tiles)
+{
+	mTiles = move(tiles);
+}
+
+void BillboardBatcher::Build(CXMMATRIX view, CXMMATRIX proj, vector<PointVertex>& sprites)
+{
+	auto detView = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&detView, view);
+
+	BoundingFrustum viewFrustum;
+	BoundingFrustum worldFrustum;
+	BoundingFrustum::CreateFromMatrix(viewFrustum, proj);
+	viewFrustum.Transform(worldFrustum, invView);
+
+	mVisibleTiles.clear();
+	mTileOffsets.clear();
+
+	size_t total = 0;
+	for (int t = 0; t < (int)mTiles.size(); ++t)
+	{
+		const ScatterTile& tile = mTiles[t];
+		if (tile.Points.empty() || worldFrustum.Contains(tile.Bounds) == DISJOINT)
+		{
+			continue;
+		}
+
+		mVisibleTiles.push_back(t);
+		mTileOffsets.push_back(total);
+		total += tile.Points.size();
+	}
+
+	mVisibleSprites.resize(total);
+	mKeys.resize(total);
+	mIndices.resize(total);
+
+	// View space z of a world point is its dot product with the third column of the view matrix.
+	XMFLOAT4X4 v;
+	XMStoreFloat4x4(&v, view);
+
+	concurrency::parallel_for(0, (int)mVisibleTiles.size(), [&](int k)
+		{
+			const auto& points = mTiles[mVisibleTiles[k]].Points;
+			size_t base = mTileOffsets[k];
+
+			for (size_t i = 0; i < points.size(); ++i)
+			{
+				const XMFLOAT3& p = points[i].Pos;
+				float depth = p.x * v._13 + p.y * v._23 + p.z * v._33 + v._43;
+
+				mVisibleSprites[base + i] = points[i];
+				mKeys[base + i] = ~RadixSort::FloatToKey(depth);
+				mIndices[base + i] = (uint32_t)(base + i);
+			}
+		});
+
+	mSorter.Sort(mKeys, mIndices);
+
+	sprites.resize(total);
+
+	const int blockSize = 4096;
+	concurrency::parallel_for(0, (int)((total + blockSize - 1) / blockSize), [&](int b)
+		{
+			size_t end = min(total, (size_t)(b + 1) * blockSize);
+			for (size_t i = (size_t)b * blockSize; i < end; ++i)
+			{
+				sprites[i] = mVisibleSprites[mIndices[i]];
+			}
+		});
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "PoissonScatter.h"
+#include "RadixSort.h"
+
+// Keeps sprites binned by terrain tile and builds a compact, back to front sorted sprite list each
+// frame: tiles are culled against the view frustum, the surviving sprites are keyed by view depth
+// and ordered with a parallel radix sort.
+class BillboardBatcher
+{
+public:
+	void SetTiles(vector<ScatterTile> tiles);
+
+	int TileCount() const { return (int)mTiles.size(); }
+	int VisibleTileCount() const { return (int)mVisibleTiles.size(); }
+
+	// Overwrites sprites with the visible sprites, farthest first.
+	void Build(CXMMATRIX view, CXMMATRIX proj, vector<PointVertex>& sprites);
+
+private:
+	vector<ScatterTile> mTiles;
+
+	vector<int> mVisibleTiles;
+	vector<size_t> mTileOffsets;
+	vector<PointVertex> mVisibleSprites;
+
+	vector<uint32_t> mKeys;
+	vector<uint32_t> mIndices;
+	RadixSort mSorter;
+};
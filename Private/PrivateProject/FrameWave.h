@@ -4,6 +4,8 @@
 #include "FrameResource.h"
 #include "UploadBuffer.h"
 
+static_assert(sizeof(Vertex) == 8 * sizeof(float), "Waves::StreamVertices writes { Pos, Normal, TexC } vertices.");
+
 struct FrameWave
 {
 public:
@@ -15,6 +17,7 @@ public:
 	unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
 
 	UINT64 Fence = 0;
+	uint64_t WavesVersion = 0;
 };
 
 FrameWave::FrameWave(ID3D12Device* device, UINT waveVertCount)
@@ -0,0 +1,414 @@
+#include "HeightTileCache.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cassert>
+#include <xmmintrin.h>
+
+HeightTileCache::HeightTileCache(const wstring& filename, size_t memoryBudget)
+	: mMemoryBudget(memoryBudget)
+{
+	mFile.open(filename, ios::binary);
+	if (mFile)
+	{
+		mFile.read(reinterpret_cast<char*>(&mHeader), sizeof(mHeader));
+		mOpen = mFile && mHeader.Magic == HeightTileFileHeader::MagicValue && mHeader.TileSize > 0;
+	}
+
+	if (!mOpen)
+	{
+		mHeader.TileCountX = 0;
+		mHeader.TileCountZ = 0;
+		return;
+	}
+
+	mLoader = thread(&HeightTileCache::LoaderThread, this);
+}
+
+HeightTileCache::~HeightTileCache()
+{
+	if (mLoader.joinable())
+	{
+		{
+			lock_guard<mutex> lock(mMutex);
+			mQuit = true;
+		}
+		mWakeLoader.notify_one();
+		mLoader.join();
+	}
+}
+
+void HeightTileCache::WriteTileFile(const wstring& filename, const vector<float>& heights, int width, int depth,
+	float spacing, float originX, float originZ, int tileSize)
+{
+	assert(width >= 2 && depth >= 2 && heights.size() == (size_t)width * depth);
+
+	HeightTileFileHeader header;
+	header.TileSize = tileSize;
+	header.TileCountX = (width - 2) / tileSize + 1;
+	header.TileCountZ = (depth - 2) / tileSize + 1;
+	header.OriginX = originX;
+	header.OriginZ = originZ;
+	header.Spacing = spacing;
+
+	auto range = minmax_element(heights.begin(), heights.end());
+	header.HeightOffset = *range.first;
+	header.HeightScale = max(*range.second - *range.first, FLT_MIN);
+
+	ofstream fout(filename, ios::binary);
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	const int samplesPerEdge = tileSize + 3;
+	vector<uint16_t> samples(samplesPerEdge * samplesPerEdge);
+
+	for (int tz = 0; tz < (int)header.TileCountZ; ++tz)
+	{
+		for (int tx = 0; tx < (int)header.TileCountX; ++tx)
+		{
+			for (int i = 0; i < samplesPerEdge; ++i)
+			{
+				int row = min(max(tz * tileSize + i - 1, 0), depth - 1);
+				for (int j = 0; j < samplesPerEdge; ++j)
+				{
+					int col = min(max(tx * tileSize + j - 1, 0), width - 1);
+
+					float t = (heights[row * width + col] - header.HeightOffset) / header.HeightScale;
+					samples[i * samplesPerEdge + j] = (uint16_t)(t * 65535.0f + 0.5f);
+				}
+			}
+
+			fout.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(uint16_t));
+		}
+	}
+}
+
+int HeightTileCache::PendingTileCount()
+{
+	lock_guard<mutex> lock(mMutex);
+	return (int)(mRequests.size() + mCompleted.size()) + (mLoading ? 1 : 0);
+}
+
+void HeightTileCache::Update(const XMFLOAT3& eyePos, float loadRadius)
+{
+	if (!mOpen)
+	{
+		return;
+	}
+
+	++mFrame;
+
+	const float tileWorldSize = TileWorldSize();
+	const int vertsPerEdge = mHeader.TileSize + 1;
+	const size_t tileBytes = (size_t)vertsPerEdge * vertsPerEdge * (sizeof(float) + sizeof(XMFLOAT3));
+
+	int minX = max(0, (int)floorf((eyePos.x - loadRadius - mHeader.OriginX) / tileWorldSize));
+	int maxX = min((int)mHeader.TileCountX - 1, (int)floorf((eyePos.x + loadRadius - mHeader.OriginX) / tileWorldSize));
+	int minZ = max(0, (int)floorf((eyePos.z - loadRadius - mHeader.OriginZ) / tileWorldSize));
+	int maxZ = min((int)mHeader.TileCountZ - 1, (int)floorf((eyePos.z + loadRadius - mHeader.OriginZ) / tileWorldSize));
+
+	vector<pair<float, TileKey>> inRange;
+
+	for (int tz = minZ; tz <= maxZ; ++tz)
+	{
+		for (int tx = minX; tx <= maxX; ++tx)
+		{
+			// Distance from the eye to the tile rectangle.
+			float x0 = mHeader.OriginX + tx * tileWorldSize;
+			float z0 = mHeader.OriginZ + tz * tileWorldSize;
+			float dx = max(0.0f, max(x0 - eyePos.x, eyePos.x - (x0 + tileWorldSize)));
+			float dz = max(0.0f, max(z0 - eyePos.z, eyePos.z - (z0 + tileWorldSize)));
+			float distSq = dx * dx + dz * dz;
+
+			if (distSq <= loadRadius * loadRadius)
+			{
+				inRange.push_back({ distSq, MakeKey(tx, tz) });
+			}
+		}
+	}
+
+	sort(inRange.begin(), inRange.end(), [](const pair<float, TileKey>& a, const pair<float, TileKey>& b)
+		{
+			return a.first < b.first;
+		});
+
+	lock_guard<mutex> lock(mMutex);
+
+	vector<unique_ptr<HeightTile>> completed;
+	completed.swap(mCompleted);
+
+	// The budget goes to the tiles in range nearest first, whether they are resident, just loaded or
+	// still to be requested. Whatever does not fit is left for eviction, so the resident set never
+	// outgrows the budget and the farthest tiles wait until the eye comes closer.
+	size_t reserved = mLoading ? tileBytes : 0;
+
+	// Requests that drifted out of range are dropped instead of queued behind closer tiles.
+	mRequests.clear();
+
+	for (const auto& t : inRange)
+	{
+		const TileKey key = t.second;
+
+		auto resident = mTiles.find(key);
+		if (resident != mTiles.end())
+		{
+			if (reserved + resident->second.Tile->ByteSize() <= mMemoryBudget)
+			{
+				reserved += resident->second.Tile->ByteSize();
+				Touch(key);
+			}
+			continue;
+		}
+
+		auto loaded = find_if(completed.begin(), completed.end(), [this, key](const unique_ptr<HeightTile>& tile)
+			{
+				return tile && MakeKey(tile->X, tile->Z) == key;
+			});
+
+		if (loaded != completed.end())
+		{
+			if (reserved + (*loaded)->ByteSize() <= mMemoryBudget)
+			{
+				reserved += (*loaded)->ByteSize();
+				Adopt(move(*loaded), true);
+			}
+		}
+		else if (!(mLoading && mLoadingKey == key) && reserved + tileBytes <= mMemoryBudget)
+		{
+			reserved += tileBytes;
+			mRequests.push_back(key);
+		}
+	}
+
+	// Sorted farthest first so the loader pops the nearest tile from the back.
+	reverse(mRequests.begin(), mRequests.end());
+	mWakeLoader.notify_one();
+
+	// Loads that no longer fit, or that the eye moved away from, are the first to be evicted.
+	for (auto& tile : completed)
+	{
+		if (tile)
+		{
+			Adopt(move(tile), false);
+		}
+	}
+
+	EvictToBudget();
+}
+
+const HeightTile* HeightTileCache::FindTile(int tileX, int tileZ)
+{
+	auto it = mTiles.find(MakeKey(tileX, tileZ));
+	if (it == mTiles.end())
+	{
+		return nullptr;
+	}
+
+	Touch(it->first);
+	return it->second.Tile.get();
+}
+
+bool HeightTileCache::TryGetHeight(float x, float z, float& height)
+{
+	if (!mOpen)
+	{
+		return false;
+	}
+
+	const int tileSize = mHeader.TileSize;
+
+	float col = (x - mHeader.OriginX) / mHeader.Spacing;
+	float row = (z - mHeader.OriginZ) / mHeader.Spacing;
+
+	int tileX = min(max((int)floorf(col / tileSize), 0), (int)mHeader.TileCountX - 1);
+	int tileZ = min(max((int)floorf(row / tileSize), 0), (int)mHeader.TileCountZ - 1);
+
+	const HeightTile* tile = FindTile(tileX, tileZ);
+	if (tile == nullptr)
+	{
+		return false;
+	}
+
+	float u = min(max(col - tileX * tileSize, 0.0f), (float)tileSize);
+	float v = min(max(row - tileZ * tileSize, 0.0f), (float)tileSize);
+
+	int j = min((int)u, tileSize - 1);
+	int i = min((int)v, tileSize - 1);
+	float s = u - j;
+	float t = v - i;
+
+	const int stride = tileSize + 1;
+	const float* h = tile->Heights.data() + i * stride + j;
+
+	height = (1.0f - t) * ((1.0f - s) * h[0] + s * h[1]) + t * ((1.0f - s) * h[stride] + s * h[stride + 1]);
+	return true;
+}
+
+void HeightTileCache::LoaderThread()
+{
+	while (true)
+	{
+		TileKey key;
+		{
+			unique_lock<mutex> lock(mMutex);
+			mWakeLoader.wait(lock, [this]() { return mQuit || !mRequests.empty(); });
+
+			if (mQuit)
+			{
+				return;
+			}
+
+			key = mRequests.back();
+			mRequests.pop_back();
+
+			mLoadingKey = key;
+			mLoading = true;
+		}
+
+		auto tile = LoadTile((int)(uint32_t)key, (int)(key >> 32));
+
+		lock_guard<mutex> lock(mMutex);
+		if (tile)
+		{
+			mCompleted.push_back(move(tile));
+		}
+		mLoading = false;
+	}
+}
+
+unique_ptr<HeightTile> HeightTileCache::LoadTile(int tileX, int tileZ)
+{
+	const int samplesPerEdge = mHeader.TileSize + 3;
+	const size_t tileBytes = (size_t)samplesPerEdge * samplesPerEdge * sizeof(uint16_t);
+	const size_t tileIndex = (size_t)tileZ * mHeader.TileCountX + tileX;
+
+	vector<uint16_t> samples(samplesPerEdge * samplesPerEdge);
+
+	mFile.seekg(sizeof(HeightTileFileHeader) + tileIndex * tileBytes, ios_base::beg);
+	mFile.read(reinterpret_cast<char*>(samples.data()), tileBytes);
+	if (!mFile)
+	{
+		mFile.clear();
+		return nullptr;
+	}
+
+	auto tile = make_unique<HeightTile>();
+	tile->X = tileX;
+	tile->Z = tileZ;
+
+	BuildNormals(samples, *tile);
+
+	return tile;
+}
+
+// Dequantizes the samples and builds central difference normals four vertices at a time.
+void HeightTileCache::BuildNormals(const vector<uint16_t>& samples, HeightTile& tile) const
+{
+	const int vertsPerEdge = mHeader.TileSize + 1;
+	const int samplesPerEdge = mHeader.TileSize + 3;
+
+	// Padded so the last SSE loads of the final row stay inside the buffer.
+	vector<float> apron(samples.size() + 4);
+
+	const float scale = mHeader.HeightScale / 65535.0f;
+	for (size_t k = 0; k < samples.size(); ++k)
+	{
+		apron[k] = mHeader.HeightOffset + scale * samples[k];
+	}
+
+	tile.Heights.resize(vertsPerEdge * vertsPerEdge);
+	tile.Normals.resize(vertsPerEdge * vertsPerEdge);
+
+	const __m128 twoSpacing = _mm_set1_ps(2.0f * mHeader.Spacing);
+	const __m128 twoSpacingSq = _mm_mul_ps(twoSpacing, twoSpacing);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (int i = 0; i < vertsPerEdge; ++i)
+	{
+		const float* up = apron.data() + i * samplesPerEdge + 1;
+		const float* center = apron.data() + (i + 1) * samplesPerEdge;
+		const float* down = apron.data() + (i + 2) * samplesPerEdge + 1;
+
+		copy(center + 1, center + 1 + vertsPerEdge, tile.Heights.begin() + i * vertsPerEdge);
+
+		for (int j = 0; j < vertsPerEdge; j += 4)
+		{
+			__m128 l = _mm_loadu_ps(center + j);
+			__m128 r = _mm_loadu_ps(center + j + 2);
+			__m128 u = _mm_loadu_ps(up + j);
+			__m128 d = _mm_loadu_ps(down + j);
+
+			// n = (hL - hR, 2 * spacing, hU - hD) / |n|
+			__m128 nx = _mm_sub_ps(l, r);
+			__m128 nz = _mm_sub_ps(u, d);
+			__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(nz, nz)), twoSpacingSq);
+			__m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+
+			XMFLOAT4 x, y, z;
+			_mm_storeu_ps(&x.x, _mm_mul_ps(nx, invLength));
+			_mm_storeu_ps(&y.x, _mm_mul_ps(twoSpacing, invLength));
+			_mm_storeu_ps(&z.x, _mm_mul_ps(nz, invLength));
+
+			const float* xs = &x.x;
+			const float* ys = &y.x;
+			const float* zs = &z.x;
+
+			int count = min(4, vertsPerEdge - j);
+			for (int k = 0; k < count; ++k)
+			{
+				tile.Normals[i * vertsPerEdge + j + k] = XMFLOAT3(xs[k], ys[k], zs[k]);
+			}
+		}
+	}
+}
+
+void HeightTileCache::Touch(TileKey key)
+{
+	CacheEntry& entry = mTiles[key];
+	mLru.splice(mLru.begin(), mLru, entry.LruPosition);
+	entry.LastUsedFrame = mFrame;
+}
+
+void HeightTileCache::Adopt(unique_ptr<HeightTile> tile, bool inUse)
+{
+	TileKey key = MakeKey(tile->X, tile->Z);
+	if (mTiles.count(key))
+	{
+		return;
+	}
+
+	mResidentBytes += tile->ByteSize();
+
+	CacheEntry& entry = mTiles[key];
+	entry.Tile = move(tile);
+	if (inUse)
+	{
+		mLru.push_front(key);
+		entry.LruPosition = mLru.begin();
+		entry.LastUsedFrame = mFrame;
+	}
+	else
+	{
+		mLru.push_back(key);
+		entry.LruPosition = prev(mLru.end());
+	}
+}
+
+// Tiles used during the current frame sit at the front of the LRU list and Update keeps them within the
+// budget, so evicting from the back always gets the resident set back under it.
+void HeightTileCache::EvictToBudget()
+{
+	while (mResidentBytes > mMemoryBudget && !mLru.empty())
+	{
+		TileKey key = mLru.back();
+
+		auto it = mTiles.find(key);
+		if (it->second.LastUsedFrame == mFrame)
+		{
+			break;
+		}
+
+		mResidentBytes -= it->second.Tile->ByteSize();
+		mTiles.erase(it);
+		mLru.pop_back();
+	}
+}
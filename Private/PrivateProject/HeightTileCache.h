@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <DirectXMath.h>
+
+using namespace std;
+using namespace DirectX;
+
+// Tiled height map file: this header followed by TileCountX * TileCountZ tiles, row by row. A tile
+// covers TileSize x TileSize quads and stores (TileSize + 3)^2 quantized samples: its (TileSize + 1)^2
+// vertices plus a one sample apron so normals can be built without touching the neighbours.
+struct HeightTileFileHeader
+{
+	static const uint32_t MagicValue = 0x534C5448; // "HTLS"
+
+	uint32_t Magic = MagicValue;
+	uint32_t Version = 1;
+	uint32_t TileSize = 0;
+	uint32_t TileCountX = 0;
+	uint32_t TileCountZ = 0;
+
+	// World position of sample (0, 0) and the distance between samples, x grows with columns and z with rows.
+	float OriginX = 0.0f;
+	float OriginZ = 0.0f;
+	float Spacing = 1.0f;
+
+	// height = HeightOffset + HeightScale * sample / 65535
+	float HeightOffset = 0.0f;
+	float HeightScale = 1.0f;
+};
+
+struct HeightTile
+{
+	int X = 0;
+	int Z = 0;
+
+	// (TileSize + 1)^2 vertices, row by row.
+	vector<float> Heights;
+	vector<XMFLOAT3> Normals;
+
+	size_t ByteSize() const { return Heights.size() * sizeof(float) + Normals.size() * sizeof(XMFLOAT3); }
+};
+
+// Streams tiles of a height map file on a background thread. Update requests the tiles around the
+// eye nearest first, adopts finished loads and evicts the least recently used tiles once the
+// resident set exceeds the memory budget. The budget is hard: loads are only queued and adopted
+// while they fit next to the tiles in use, so with a small budget the farthest tiles stay unloaded.
+class HeightTileCache
+{
+public:
+	HeightTileCache(const wstring& filename, size_t memoryBudget);
+	HeightTileCache(const HeightTileCache& rhs) = delete;
+	HeightTileCache& operator=(const HeightTileCache& rhs) = delete;
+	~HeightTileCache();
+
+	static void WriteTileFile(const wstring& filename, const vector<float>& heights, int width, int depth,
+		float spacing, float originX, float originZ, int tileSize);
+
+	bool IsOpen() const { return mOpen; }
+	const HeightTileFileHeader& Header() const { return mHeader; }
+
+	float TileWorldSize() const { return mHeader.TileSize * mHeader.Spacing; }
+	size_t ResidentBytes() const { return mResidentBytes; }
+	int ResidentTileCount() const { return (int)mTiles.size(); }
+	// Tiles requested and not adopted yet: queued, loading, or loaded and waiting for the next Update.
+	int PendingTileCount();
+
+	void Update(const XMFLOAT3& eyePos, float loadRadius);
+
+	// Both mark the tile as recently used. Return nullptr / false while the tile is not resident.
+	const HeightTile* FindTile(int tileX, int tileZ);
+	bool TryGetHeight(float x, float z, float& height);
+
+private:
+	using TileKey = uint64_t;
+
+	TileKey MakeKey(int tileX, int tileZ) const { return ((uint64_t)(uint32_t)tileZ << 32) | (uint32_t)tileX; }
+
+	void LoaderThread();
+	unique_ptr<HeightTile> LoadTile(int tileX, int tileZ);
+	void BuildNormals(const vector<uint16_t>& samples, HeightTile& tile) const;
+
+	void Adopt(unique_ptr<HeightTile> tile, bool inUse);
+	void Touch(TileKey key);
+	void EvictToBudget();
+
+private:
+	HeightTileFileHeader mHeader;
+	size_t mMemoryBudget = 0;
+
+	// Only the loader thread reads the file once it has started.
+	ifstream mFile;
+	bool mOpen = false;
+
+	struct CacheEntry
+	{
+		unique_ptr<HeightTile> Tile;
+		list<TileKey>::iterator LruPosition;
+		uint64_t LastUsedFrame = 0;
+	};
+
+	unordered_map<TileKey, CacheEntry> mTiles;
+	list<TileKey> mLru;
+	size_t mResidentBytes = 0;
+	uint64_t mFrame = 0;
+
+	// Shared with the loader thread.
+	mutex mMutex;
+	condition_variable mWakeLoader;
+
+	// Sorted farthest first so the loader pops the nearest tile from the back.
+	vector<TileKey> mRequests;
+	vector<unique_ptr<HeightTile>> mCompleted;
+	TileKey mLoadingKey = 0;
+	bool mLoading = false;
+	bool mQuit = false;
+
+	thread mLoader;
+};
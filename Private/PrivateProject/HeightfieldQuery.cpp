@@ -0,0 +1,290 @@
+#include "HeightfieldQuery.h"
+#include <ppl.h>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+HeightfieldQuery::HeightfieldQuery(vector<float> heights, int width, int depth, float originX, float originZ, float spacing)
+	: mHeights(move(heights)), mWidth(width), mDepth(depth), mOriginX(originX), mOriginZ(originZ), mSpacing(spacing)
+{
+	assert(width >= 2 && depth >= 2 && mHeights.size() == (size_t)width * depth);
+
+	BuildPyramid();
+}
+
+HeightfieldQuery::HeightfieldQuery(const function<float(float, float)>& heightFunc, int width, int depth, float originX, float originZ, float spacing)
+	: mWidth(width), mDepth(depth), mOriginX(originX), mOriginZ(originZ), mSpacing(spacing)
+{
+	assert(width >= 2 && depth >= 2);
+
+	mHeights.resize((size_t)width * depth);
+	for (int i = 0; i < depth; ++i)
+	{
+		for (int j = 0; j < width; ++j)
+		{
+			mHeights[i * width + j] = heightFunc(originX + j * spacing, originZ + i * spacing);
+		}
+	}
+
+	BuildPyramid();
+}
+
+HeightfieldQuery::~HeightfieldQuery()
+{
+}
+
+void HeightfieldQuery::BuildPyramid()
+{
+	Level base;
+	base.Width = mWidth - 1;
+	base.Depth = mDepth - 1;
+	base.MinMax.resize(base.Width * base.Depth);
+
+	for (int i = 0; i < base.Depth; ++i)
+	{
+		for (int j = 0; j < base.Width; ++j)
+		{
+			float h00 = Sample(i, j);
+			float h01 = Sample(i, j + 1);
+			float h10 = Sample(i + 1, j);
+			float h11 = Sample(i + 1, j + 1);
+
+			base.MinMax[i * base.Width + j] = XMFLOAT2(
+				min(min(h00, h01), min(h10, h11)),
+				max(max(h00, h01), max(h10, h11)));
+		}
+	}
+
+	mLevels.push_back(move(base));
+
+	while (mLevels.back().Width > 1 || mLevels.back().Depth > 1)
+	{
+		const Level& fine = mLevels.back();
+
+		Level coarse;
+		coarse.Width = (fine.Width + 1) / 2;
+		coarse.Depth = (fine.Depth + 1) / 2;
+		coarse.MinMax.resize(coarse.Width * coarse.Depth);
+
+		for (int i = 0; i < coarse.Depth; ++i)
+		{
+			for (int j = 0; j < coarse.Width; ++j)
+			{
+				XMFLOAT2 range(FLT_MAX, -FLT_MAX);
+
+				for (int k = 0; k < 4; ++k)
+				{
+					int fi = 2 * i + (k >> 1);
+					int fj = 2 * j + (k & 1);
+					if (fi < fine.Depth && fj < fine.Width)
+					{
+						const XMFLOAT2& r = fine.MinMax[fi * fine.Width + fj];
+						range.x = min(range.x, r.x);
+						range.y = max(range.y, r.y);
+					}
+				}
+
+				coarse.MinMax[i * coarse.Width + j] = range;
+			}
+		}
+
+		mLevels.push_back(move(coarse));
+	}
+}
+
+float HeightfieldQuery::HeightAt(float x, float z) const
+{
+	float u = min(max((x - mOriginX) / mSpacing, 0.0f), (float)(mWidth - 1));
+	float v = min(max((z - mOriginZ) / mSpacing, 0.0f), (float)(mDepth - 1));
+
+	int j = min((int)u, mWidth - 2);
+	int i = min((int)v, mDepth - 2);
+	float s = u - j;
+	float t = v - i;
+
+	if (s + t <= 1.0f)
+	{
+		float h00 = Sample(i, j);
+		return h00 + s * (Sample(i, j + 1) - h00) + t * (Sample(i + 1, j) - h00);
+	}
+
+	float h11 = Sample(i + 1, j + 1);
+	return h11 + (1.0f - s) * (Sample(i + 1, j) - h11) + (1.0f - t) * (Sample(i, j + 1) - h11);
+}
+
+void HeightfieldQuery::HeightsAt(const XMFLOAT2* points, size_t count, float* heights) const
+{
+	for (size_t k = 0; k < count; ++k)
+	{
+		heights[k] = HeightAt(points[k].x, points[k].y);
+	}
+}
+
+bool HeightfieldQuery::Intersect(const HeightfieldRay& ray, HeightfieldHit& hit) const
+{
+	hit = HeightfieldHit();
+
+	XMVECTOR dir = XMLoadFloat3(&ray.Direction);
+	float length = XMVectorGetX(XMVector3Length(dir));
+	if (length <= 0.0f)
+	{
+		return false;
+	}
+
+	RayState state;
+	state.Origin = ray.Origin;
+	XMStoreFloat3(&state.Direction, XMVectorScale(dir, 1.0f / length));
+	state.InvDirection = XMFLOAT3(1.0f / state.Direction.x, 1.0f / state.Direction.y, 1.0f / state.Direction.z);
+	state.MaxDistance = ray.MaxDistance;
+
+	const Level& top = mLevels.back();
+	float closest = ray.MaxDistance;
+
+	for (int i = 0; i < top.Depth; ++i)
+	{
+		for (int j = 0; j < top.Width; ++j)
+		{
+			IntersectNode(state, (int)mLevels.size() - 1, j, i, closest, hit);
+		}
+	}
+
+	return hit.Hit;
+}
+
+void HeightfieldQuery::IntersectRays(const HeightfieldRay* rays, size_t count, HeightfieldHit* hits) const
+{
+	const int batchSize = 64;
+	const int batchCount = (int)((count + batchSize - 1) / batchSize);
+
+	concurrency::parallel_for(0, batchCount, [this, rays, count, hits, batchSize](int batch)
+		{
+			size_t end = min(count, (size_t)(batch + 1) * batchSize);
+			for (size_t k = (size_t)batch * batchSize; k < end; ++k)
+			{
+				Intersect(rays[k], hits[k]);
+			}
+		});
+}
+
+// Descends the pyramid front to back, pruning every node whose height range the ray misses or
+// which starts beyond the closest hit found so far.
+bool HeightfieldQuery::IntersectNode(const RayState& ray, int level, int x, int z, float& closest, HeightfieldHit& hit) const
+{
+	const Level& node = mLevels[level];
+	const XMFLOAT2& range = node.MinMax[z * node.Width + x];
+
+	const int cells = 1 << level;
+	float cellSize = cells * mSpacing;
+
+	XMFLOAT3 boxMin(mOriginX + x * cellSize, range.x, mOriginZ + z * cellSize);
+	XMFLOAT3 boxMax(
+		mOriginX + min((x + 1) * cells, mWidth - 1) * mSpacing,
+		range.y,
+		mOriginZ + min((z + 1) * cells, mDepth - 1) * mSpacing);
+
+	float tEnter;
+	if (!RayBoxInterval(ray, boxMin, boxMax, tEnter) || tEnter > closest)
+	{
+		return false;
+	}
+
+	if (level == 0)
+	{
+		return IntersectCell(ray, x, z, closest, hit);
+	}
+
+	const Level& child = mLevels[level - 1];
+
+	// Visit the child on the ray origin's side first along each axis.
+	int firstX = ray.Direction.x >= 0.0f ? 0 : 1;
+	int firstZ = ray.Direction.z >= 0.0f ? 0 : 1;
+
+	bool found = false;
+	for (int k = 0; k < 4; ++k)
+	{
+		int cx = 2 * x + (firstX ^ (k & 1));
+		int cz = 2 * z + (firstZ ^ (k >> 1));
+
+		if (cx < child.Width && cz < child.Depth)
+		{
+			found |= IntersectNode(ray, level - 1, cx, cz, closest, hit);
+		}
+	}
+
+	return found;
+}
+
+bool HeightfieldQuery::IntersectCell(const RayState& ray, int x, int z, float& closest, HeightfieldHit& hit) const
+{
+	float x0 = mOriginX + x * mSpacing;
+	float z0 = mOriginZ + z * mSpacing;
+
+	XMVECTOR v00 = XMVectorSet(x0, Sample(z, x), z0, 0.0f);
+	XMVECTOR v01 = XMVectorSet(x0 + mSpacing, Sample(z, x + 1), z0, 0.0f);
+	XMVECTOR v10 = XMVectorSet(x0, Sample(z + 1, x), z0 + mSpacing, 0.0f);
+	XMVECTOR v11 = XMVectorSet(x0 + mSpacing, Sample(z + 1, x + 1), z0 + mSpacing, 0.0f);
+
+	XMVECTOR origin = XMLoadFloat3(&ray.Origin);
+	XMVECTOR dir = XMLoadFloat3(&ray.Direction);
+
+	XMVECTOR triangles[2][3] =
+	{
+		{ v00, v10, v01 },
+		{ v01, v10, v11 }
+	};
+
+	bool found = false;
+	for (auto& tri : triangles)
+	{
+		float t;
+		if (TriangleTests::Intersects(origin, dir, tri[0], tri[1], tri[2], t) && t < closest)
+		{
+			closest = t;
+			found = true;
+
+			XMVECTOR normal = XMVector3Normalize(XMVector3Cross(
+				XMVectorSubtract(tri[1], tri[0]),
+				XMVectorSubtract(tri[2], tri[0])));
+
+			hit.Hit = true;
+			hit.Distance = t;
+			XMStoreFloat3(&hit.Position, XMVectorMultiplyAdd(dir, XMVectorReplicate(t), origin));
+			XMStoreFloat3(&hit.Normal, normal);
+		}
+	}
+
+	return found;
+}
+
+bool HeightfieldQuery::RayBoxInterval(const RayState& ray, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, float& tEnter) const
+{
+	float t0 = 0.0f;
+	float t1 = ray.MaxDistance;
+
+	const float* origin = &ray.Origin.x;
+	const float* invDir = &ray.InvDirection.x;
+	const float* lo = &boxMin.x;
+	const float* hi = &boxMax.x;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float tNear = (lo[axis] - origin[axis]) * invDir[axis];
+		float tFar = (hi[axis] - origin[axis]) * invDir[axis];
+		if (tNear > tFar)
+		{
+			swap(tNear, tFar);
+		}
+
+		// NaN from 0 * inf (ray in a slab plane) falls through the comparisons and leaves the interval alone.
+		t0 = tNear > t0 ? tNear : t0;
+		t1 = tFar < t1 ? tFar : t1;
+
+		if (t0 > t1)
+		{
+			return false;
+		}
+	}
+
+	tEnter = t0;
+	return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <functional>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+using namespace std;
+using namespace DirectX;
+
+struct HeightfieldRay
+{
+	XMFLOAT3 Origin = { 0.0f, 0.0f, 0.0f };
+	XMFLOAT3 Direction = { 0.0f, -1.0f, 0.0f };
+	float MaxDistance = FLT_MAX;
+};
+
+struct HeightfieldHit
+{
+	bool Hit = false;
+	float Distance = 0.0f;
+	XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };
+	XMFLOAT3 Normal = { 0.0f, 1.0f, 0.0f };
+};
+
+// Ray and point queries against a regular height grid without any triangle structure. A min-max
+// pyramid over the grid cells lets a ray skip every region it passes above or below, so only the
+// few cells it actually reaches are tested against their two triangles. The triangulation matches
+// the terrain chunk meshes: each cell is split along the diagonal from (x1, z0) to (x0, z1).
+class HeightfieldQuery
+{
+public:
+	// heights holds width x depth samples, row by row; sample (i, j) sits at (originX + j * spacing, originZ + i * spacing).
+	HeightfieldQuery(vector<float> heights, int width, int depth, float originX, float originZ, float spacing);
+	HeightfieldQuery(const function<float(float, float)>& heightFunc, int width, int depth, float originX, float originZ, float spacing);
+	HeightfieldQuery(const HeightfieldQuery& rhs) = delete;
+	HeightfieldQuery& operator=(const HeightfieldQuery& rhs) = delete;
+	~HeightfieldQuery();
+
+	int LevelCount() const { return (int)mLevels.size(); }
+
+	// Height of the triangulated surface, clamped to the grid edges.
+	float HeightAt(float x, float z) const;
+	void HeightsAt(const XMFLOAT2* points, size_t count, float* heights) const;
+
+	bool Intersect(const HeightfieldRay& ray, HeightfieldHit& hit) const;
+	void IntersectRays(const HeightfieldRay* rays, size_t count, HeightfieldHit* hits) const;
+
+private:
+	struct Level
+	{
+		int Width;
+		int Depth;
+		vector<XMFLOAT2> MinMax;
+	};
+
+	struct RayState
+	{
+		XMFLOAT3 Origin;
+		XMFLOAT3 Direction;
+		XMFLOAT3 InvDirection;
+		float MaxDistance;
+	};
+
+	void BuildPyramid();
+
+	bool IntersectNode(const RayState& ray, int level, int x, int z, float& closest, HeightfieldHit& hit) const;
+	bool IntersectCell(const RayState& ray, int x, int z, float& closest, HeightfieldHit& hit) const;
+	bool RayBoxInterval(const RayState& ray, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, float& tEnter) const;
+
+	float Sample(int i, int j) const { return mHeights[i * mWidth + j]; }
+
+private:
+	vector<float> mHeights;
+	int mWidth = 0;
+	int mDepth = 0;
+	float mOriginX = 0.0f;
+	float mOriginZ = 0.0f;
+	float mSpacing = 1.0f;
+
+	// mLevels[0] holds one min/max pair per grid cell, every next level halves both dimensions.
+	vector<Level> mLevels;
+};
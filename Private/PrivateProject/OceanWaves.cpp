@@ -0,0 +1,654 @@
+#include "OceanWaves.h"
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <random>
+#include <cmath>
+#include <cassert>
+
+namespace
+{
+	const float Gravity = 9.81f;
+
+	// Threads are started once and parked between calls, so the four passes of an Update do not pay
+	// for creating threads. Run hands one slot to each thread and runs slot 0 on the caller.
+	class WorkerPool
+	{
+	public:
+		WorkerPool()
+		{
+			const int workerCount = std::max(1, (int)thread::hardware_concurrency()) - 1;
+			for (int i = 0; i < workerCount; ++i)
+			{
+				mThreads.emplace_back(&WorkerPool::WorkerMain, this, i + 1);
+			}
+		}
+
+		~WorkerPool()
+		{
+			{
+				lock_guard<mutex> lock(mLock);
+				mQuit = true;
+			}
+			mWake.notify_all();
+
+			for (auto& t : mThreads)
+			{
+				t.join();
+			}
+		}
+
+		int ThreadCount() const { return (int)mThreads.size() + 1; }
+
+		// Calls job(slot) for every slot in [0, slotCount) and returns once all of them finished.
+		void Run(int slotCount, const function<void(int)>& job)
+		{
+			lock_guard<mutex> runLock(mRunLock);
+			{
+				lock_guard<mutex> lock(mLock);
+				mJob = &job;
+				mSlotCount = slotCount;
+				mRemaining = slotCount - 1;
+				++mGeneration;
+			}
+			mWake.notify_all();
+
+			job(0);
+
+			unique_lock<mutex> lock(mLock);
+			mDone.wait(lock, [this]() { return mRemaining == 0; });
+			mJob = nullptr;
+		}
+
+	private:
+		void WorkerMain(int slot)
+		{
+			uint64_t generation = 0;
+			while (true)
+			{
+				const function<void(int)>* job = nullptr;
+				{
+					unique_lock<mutex> lock(mLock);
+					mWake.wait(lock, [this, generation]() { return mQuit || mGeneration != generation; });
+					if (mQuit)
+					{
+						return;
+					}
+
+					generation = mGeneration;
+					if (slot >= mSlotCount)
+					{
+						continue;
+					}
+					job = mJob;
+				}
+
+				(*job)(slot);
+
+				lock_guard<mutex> lock(mLock);
+				if (--mRemaining == 0)
+				{
+					mDone.notify_one();
+				}
+			}
+		}
+
+	private:
+		vector<thread> mThreads;
+
+		// Serializes Run calls from different threads.
+		mutex mRunLock;
+
+		mutex mLock;
+		condition_variable mWake;
+		condition_variable mDone;
+		const function<void(int)>* mJob = nullptr;
+		int mSlotCount = 0;
+		int mRemaining = 0;
+		uint64_t mGeneration = 0;
+		bool mQuit = false;
+	};
+
+	WorkerPool& Pool()
+	{
+		static WorkerPool pool;
+		return pool;
+	}
+
+	// One contiguous range per thread of the pool.
+	template<typename F>
+	void ParallelFor(int count, F&& func)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+
+		WorkerPool& pool = Pool();
+		const int chunkCount = std::min(count, pool.ThreadCount());
+		const int chunk = (count + chunkCount - 1) / chunkCount;
+
+		pool.Run(chunkCount, [&func, chunk, count](int c)
+			{
+				const int begin = std::min(c * chunk, count);
+				func(begin, std::min(begin + chunk, count));
+			});
+	}
+
+	float* Floats(vector<__m128>& v)
+	{
+		return reinterpret_cast<float*>(v.data());
+	}
+
+	const float* Floats(const vector<__m128>& v)
+	{
+		return reinterpret_cast<const float*>(v.data());
+	}
+
+	// Interleaves four consecutive rows so element k of row l ends up in lane l of lanes[k].
+	void GatherRows(const float* rows, int n, __m128* lanes)
+	{
+		for (int k = 0; k < n; k += 4)
+		{
+			__m128 r0 = _mm_load_ps(rows + k);
+			__m128 r1 = _mm_load_ps(rows + n + k);
+			__m128 r2 = _mm_load_ps(rows + 2 * n + k);
+			__m128 r3 = _mm_load_ps(rows + 3 * n + k);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			lanes[k] = r0;
+			lanes[k + 1] = r1;
+			lanes[k + 2] = r2;
+			lanes[k + 3] = r3;
+		}
+	}
+
+	void ScatterRows(const __m128* lanes, int n, float* rows)
+	{
+		for (int k = 0; k < n; k += 4)
+		{
+			__m128 r0 = lanes[k];
+			__m128 r1 = lanes[k + 1];
+			__m128 r2 = lanes[k + 2];
+			__m128 r3 = lanes[k + 3];
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_store_ps(rows + k, r0);
+			_mm_store_ps(rows + n + k, r1);
+			_mm_store_ps(rows + 2 * n + k, r2);
+			_mm_store_ps(rows + 3 * n + k, r3);
+		}
+	}
+}
+
+OceanWaves::OceanWaves(int n, float patchSize, const OceanSettings& settings)
+{
+	assert(n >= 4 && (n & (n - 1)) == 0);
+
+	mN = n;
+	mPatchSize = patchSize;
+	mChoppiness = settings.Choppiness;
+
+	while ((1 << mLog2N) < n)
+	{
+		++mLog2N;
+	}
+
+	mBitReverse.resize(n);
+	for (int k = 0; k < n; ++k)
+	{
+		int r = 0;
+		for (int b = 0; b < mLog2N; ++b)
+		{
+			r |= ((k >> b) & 1) << (mLog2N - 1 - b);
+		}
+		mBitReverse[k] = r;
+	}
+
+	mTwiddleRe.resize(n / 2);
+	mTwiddleIm.resize(n / 2);
+	for (int k = 0; k < n / 2; ++k)
+	{
+		float angle = XM_2PI * k / n;
+		mTwiddleRe[k] = cosf(angle);
+		mTwiddleIm[k] = sinf(angle);
+	}
+
+	size_t vectorCount = (size_t)n * n / 4;
+
+	mH0Re.resize(vectorCount);
+	mH0Im.resize(vectorCount);
+	mH0ConjMinusRe.resize(vectorCount);
+	mH0ConjMinusIm.resize(vectorCount);
+	mOmega.resize(vectorCount);
+	mKx.resize(vectorCount);
+	mKz.resize(vectorCount);
+	mKxOverK.resize(vectorCount);
+	mKzOverK.resize(vectorCount);
+
+	for (int f = 0; f < FieldCount; ++f)
+	{
+		mFieldRe[f].resize(vectorCount);
+		mFieldIm[f].resize(vectorCount);
+	}
+
+	mPositions.resize(n * n);
+	mNormals.resize(n * n);
+	mTexC.resize(n * n);
+
+	float dx = patchSize / n;
+	for (int i = 0; i < n; ++i)
+	{
+		for (int j = 0; j < n; ++j)
+		{
+			float x = (j - n / 2) * dx;
+			float z = (n / 2 - i) * dx;
+			mTexC[i * n + j] = XMFLOAT2(0.5f + x / Width(), 0.5f - z / Depth());
+		}
+	}
+
+	BuildSpectrum(settings);
+
+	Update(0.0f);
+}
+
+OceanWaves::~OceanWaves()
+{
+}
+
+void OceanWaves::Update(float dt)
+{
+	mTime += dt;
+
+	EvaluateSpectrum(mTime);
+	InverseFFTRows();
+	InverseFFTColumns();
+	ResolveVertices();
+
+	++mVersion;
+}
+
+uint64_t OceanWaves::StreamVertices(void* mappedVertices, uint64_t lastVersion) const
+{
+	if (lastVersion >= mVersion)
+	{
+		return mVersion;
+	}
+
+	float* dst = reinterpret_cast<float*>(mappedVertices);
+	assert((reinterpret_cast<uintptr_t>(dst) & 15) == 0);
+
+	for (int k = 0; k < VertexCount(); ++k)
+	{
+		const XMFLOAT3& p = mPositions[k];
+		const XMFLOAT3& n = mNormals[k];
+		const XMFLOAT2& uv = mTexC[k];
+
+		_mm_stream_ps(dst + k * 8, _mm_setr_ps(p.x, p.y, p.z, n.x));
+		_mm_stream_ps(dst + k * 8 + 4, _mm_setr_ps(n.y, n.z, uv.x, uv.y));
+	}
+
+	_mm_sfence();
+
+	return mVersion;
+}
+
+void OceanWaves::BuildSpectrum(const OceanSettings& settings)
+{
+	const int n = mN;
+	const float dk = XM_2PI / mPatchSize;
+
+	mt19937 rng(settings.Seed);
+	normal_distribution<float> gauss(0.0f, 1.0f);
+
+	float* h0Re = Floats(mH0Re);
+	float* h0Im = Floats(mH0Im);
+	float* kxs = Floats(mKx);
+	float* kzs = Floats(mKz);
+	float* kxOverK = Floats(mKxOverK);
+	float* kzOverK = Floats(mKzOverK);
+	float* omega = Floats(mOmega);
+
+	for (int i = 0; i < n; ++i)
+	{
+		for (int j = 0; j < n; ++j)
+		{
+			int idx = i * n + j;
+
+			float kx = (j - n / 2) * dk;
+			float kz = (i - n / 2) * dk;
+			float k = sqrtf(kx * kx + kz * kz);
+
+			// The Nyquist row and column have no conjugate partner, so they are left empty to keep
+			// every packed field exactly Hermitian.
+			float p = 0.0f;
+			if (i != 0 && j != 0)
+			{
+				p = settings.Spectrum == OceanSpectrum::Jonswap ?
+					JonswapSpectrum(kx, kz, settings) :
+					PhillipsSpectrum(kx, kz, settings);
+			}
+
+			float amplitude = sqrtf(0.5f * p);
+			float xr = gauss(rng);
+			float xi = gauss(rng);
+
+			h0Re[idx] = xr * amplitude;
+			h0Im[idx] = xi * amplitude;
+
+			kxs[idx] = kx;
+			kzs[idx] = kz;
+			kxOverK[idx] = k > 1e-6f ? kx / k : 0.0f;
+			kzOverK[idx] = k > 1e-6f ? kz / k : 0.0f;
+			omega[idx] = sqrtf(Gravity * k);
+		}
+	}
+
+	float* conjRe = Floats(mH0ConjMinusRe);
+	float* conjIm = Floats(mH0ConjMinusIm);
+
+	for (int i = 0; i < n; ++i)
+	{
+		for (int j = 0; j < n; ++j)
+		{
+			int mirror = ((n - i) % n) * n + (n - j) % n;
+
+			conjRe[i * n + j] = h0Re[mirror];
+			conjIm[i * n + j] = -h0Im[mirror];
+		}
+	}
+}
+
+float OceanWaves::PhillipsSpectrum(float kx, float kz, const OceanSettings& settings) const
+{
+	float k2 = kx * kx + kz * kz;
+	if (k2 < 1e-12f)
+	{
+		return 0.0f;
+	}
+
+	// World z runs against the FFT row axis, see ResolveVertices.
+	XMVECTOR w = XMVector2Normalize(XMVectorSet(settings.WindDirection.x, -settings.WindDirection.y, 0.0f, 0.0f));
+	float kDotW = (kx * XMVectorGetX(w) + kz * XMVectorGetY(w)) / sqrtf(k2);
+
+	float L = settings.WindSpeed * settings.WindSpeed / Gravity;
+	float l = settings.SmallWaveLength;
+
+	return settings.PhillipsAmplitude * expf(-1.0f / (k2 * L * L)) / (k2 * k2) *
+		kDotW * kDotW * expf(-k2 * l * l);
+}
+
+float OceanWaves::JonswapSpectrum(float kx, float kz, const OceanSettings& settings) const
+{
+	float k = sqrtf(kx * kx + kz * kz);
+	if (k < 1e-6f)
+	{
+		return 0.0f;
+	}
+
+	XMVECTOR w = XMVector2Normalize(XMVectorSet(settings.WindDirection.x, -settings.WindDirection.y, 0.0f, 0.0f));
+	float cosTheta = (kx * XMVectorGetX(w) + kz * XMVectorGetY(w)) / k;
+	if (cosTheta <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	float U = settings.WindSpeed;
+	float F = settings.Fetch;
+
+	float omega = sqrtf(Gravity * k);
+	float omegaPeak = 22.0f * powf(Gravity * Gravity / (U * F), 1.0f / 3.0f);
+	float alpha = 0.076f * powf(U * U / (F * Gravity), 0.22f);
+	float sigma = omega <= omegaPeak ? 0.07f : 0.09f;
+
+	float d = (omega - omegaPeak) / (sigma * omegaPeak);
+	float r = expf(-0.5f * d * d);
+	float peak = omegaPeak / omega;
+
+	float spectrumOmega = alpha * Gravity * Gravity / powf(omega, 5.0f) *
+		expf(-1.25f * peak * peak * peak * peak) * powf(settings.PeakEnhancement, r);
+
+	// S(k) = S(omega) * d(omega)/dk / k, spread with a normalized cos^2 lobe around the wind.
+	float dOmegaDk = Gravity / (2.0f * omega);
+	float spreading = 2.0f / XM_PI * cosTheta * cosTheta;
+	float dk = XM_2PI / mPatchSize;
+
+	return 2.0f * spectrumOmega * dOmegaDk / k * spreading * dk * dk;
+}
+
+void OceanWaves::EvaluateSpectrum(float time)
+{
+	const int vectorCount = mN * mN / 4;
+
+	ParallelFor(vectorCount, [this, time](int begin, int end)
+		{
+			const __m128 t = _mm_set1_ps(time);
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 zero = _mm_setzero_ps();
+
+			for (int v = begin; v < end; ++v)
+			{
+				XMVECTOR s;
+				XMVECTOR c;
+				XMVectorSinCos(&s, &c, _mm_mul_ps(mOmega[v], t));
+
+				__m128 a = mH0Re[v];
+				__m128 b = mH0Im[v];
+				__m128 p = mH0ConjMinusRe[v];
+				__m128 q = mH0ConjMinusIm[v];
+
+				// h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t)
+				__m128 hRe = _mm_add_ps(_mm_mul_ps(_mm_add_ps(a, p), c), _mm_mul_ps(_mm_sub_ps(q, b), s));
+				__m128 hIm = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(a, p), s), _mm_mul_ps(_mm_add_ps(b, q), c));
+
+				__m128 kx = mKx[v];
+				__m128 kz = mKz[v];
+				__m128 ux = mKxOverK[v];
+				__m128 uz = mKzOverK[v];
+
+				// height + i * dispX, where dispX = -i kx/|k| h
+				__m128 scale = _mm_add_ps(one, ux);
+				mFieldRe[0][v] = _mm_mul_ps(hRe, scale);
+				mFieldIm[0][v] = _mm_mul_ps(hIm, scale);
+
+				// dispZ + i * slopeX, where dispZ = -i kz/|k| h and slopeX = i kx h
+				mFieldRe[1][v] = _mm_sub_ps(_mm_mul_ps(uz, hIm), _mm_mul_ps(kx, hRe));
+				mFieldIm[1][v] = _mm_sub_ps(_mm_sub_ps(zero, _mm_mul_ps(uz, hRe)), _mm_mul_ps(kx, hIm));
+
+				// slopeZ = i kz h
+				mFieldRe[2][v] = _mm_sub_ps(zero, _mm_mul_ps(kz, hIm));
+				mFieldIm[2][v] = _mm_mul_ps(kz, hRe);
+			}
+		});
+}
+
+void OceanWaves::InverseFFTRows()
+{
+	ParallelFor(mN / 4, [this](int begin, int end)
+		{
+			vector<__m128> scratchRe(mN);
+			vector<__m128> scratchIm(mN);
+
+			for (int f = 0; f < FieldCount; ++f)
+			{
+				for (int g = begin; g < end; ++g)
+				{
+					float* re = Floats(mFieldRe[f]) + (size_t)g * 4 * mN;
+					float* im = Floats(mFieldIm[f]) + (size_t)g * 4 * mN;
+
+					GatherRows(re, mN, scratchRe.data());
+					GatherRows(im, mN, scratchIm.data());
+
+					InverseFFT(Floats(scratchRe), Floats(scratchIm), 4);
+
+					ScatterRows(scratchRe.data(), mN, re);
+					ScatterRows(scratchIm.data(), mN, im);
+				}
+			}
+		});
+}
+
+void OceanWaves::InverseFFTColumns()
+{
+	ParallelFor(mN / 4, [this](int begin, int end)
+		{
+			for (int f = 0; f < FieldCount; ++f)
+			{
+				for (int g = begin; g < end; ++g)
+				{
+					InverseFFT(Floats(mFieldRe[f]) + g * 4, Floats(mFieldIm[f]) + g * 4, mN);
+				}
+			}
+		});
+}
+
+// Unnormalized inverse FFT of four sequences at once: element k of sequence l is re[k * stride + l].
+// Decimation in time after a bit reversal, with pairs of radix-2 stages fused into radix-4
+// butterflies and one leading radix-2 stage when log2(N) is odd.
+void OceanWaves::InverseFFT(float* re, float* im, size_t stride) const
+{
+	const int n = mN;
+
+	for (int k = 0; k < n; ++k)
+	{
+		int r = mBitReverse[k];
+		if (k < r)
+		{
+			__m128 tr = _mm_load_ps(re + k * stride);
+			__m128 ti = _mm_load_ps(im + k * stride);
+			_mm_store_ps(re + k * stride, _mm_load_ps(re + r * stride));
+			_mm_store_ps(im + k * stride, _mm_load_ps(im + r * stride));
+			_mm_store_ps(re + r * stride, tr);
+			_mm_store_ps(im + r * stride, ti);
+		}
+	}
+
+	int h = 1;
+
+	if (mLog2N & 1)
+	{
+		for (int b = 0; b < n; b += 2)
+		{
+			float* r0 = re + b * stride;
+			float* i0 = im + b * stride;
+			float* r1 = re + (b + 1) * stride;
+			float* i1 = im + (b + 1) * stride;
+
+			__m128 ar = _mm_load_ps(r0);
+			__m128 ai = _mm_load_ps(i0);
+			__m128 br = _mm_load_ps(r1);
+			__m128 bi = _mm_load_ps(i1);
+
+			_mm_store_ps(r0, _mm_add_ps(ar, br));
+			_mm_store_ps(i0, _mm_add_ps(ai, bi));
+			_mm_store_ps(r1, _mm_sub_ps(ar, br));
+			_mm_store_ps(i1, _mm_sub_ps(ai, bi));
+		}
+		h = 2;
+	}
+
+	for (; h < n; h *= 4)
+	{
+		const int step1 = n / (2 * h);
+		const int step2 = n / (4 * h);
+
+		for (int j = 0; j < h; ++j)
+		{
+			const __m128 w1r = _mm_set1_ps(mTwiddleRe[j * step1]);
+			const __m128 w1i = _mm_set1_ps(mTwiddleIm[j * step1]);
+			const __m128 w2r = _mm_set1_ps(mTwiddleRe[j * step2]);
+			const __m128 w2i = _mm_set1_ps(mTwiddleIm[j * step2]);
+
+			for (int b = 0; b < n; b += 4 * h)
+			{
+				float* pr[4];
+				float* pi[4];
+				for (int q = 0; q < 4; ++q)
+				{
+					pr[q] = re + (b + j + q * h) * stride;
+					pi[q] = im + (b + j + q * h) * stride;
+				}
+
+				__m128 x0r = _mm_load_ps(pr[0]);
+				__m128 x0i = _mm_load_ps(pi[0]);
+				__m128 x1r = _mm_load_ps(pr[1]);
+				__m128 x1i = _mm_load_ps(pi[1]);
+				__m128 x2r = _mm_load_ps(pr[2]);
+				__m128 x2i = _mm_load_ps(pi[2]);
+				__m128 x3r = _mm_load_ps(pr[3]);
+				__m128 x3i = _mm_load_ps(pi[3]);
+
+				// First radix-2 stage (span h, twiddle W_2h^j).
+				__m128 tr = _mm_sub_ps(_mm_mul_ps(x1r, w1r), _mm_mul_ps(x1i, w1i));
+				__m128 ti = _mm_add_ps(_mm_mul_ps(x1r, w1i), _mm_mul_ps(x1i, w1r));
+				__m128 a0r = _mm_add_ps(x0r, tr);
+				__m128 a0i = _mm_add_ps(x0i, ti);
+				__m128 a1r = _mm_sub_ps(x0r, tr);
+				__m128 a1i = _mm_sub_ps(x0i, ti);
+
+				tr = _mm_sub_ps(_mm_mul_ps(x3r, w1r), _mm_mul_ps(x3i, w1i));
+				ti = _mm_add_ps(_mm_mul_ps(x3r, w1i), _mm_mul_ps(x3i, w1r));
+				__m128 a2r = _mm_add_ps(x2r, tr);
+				__m128 a2i = _mm_add_ps(x2i, ti);
+				__m128 a3r = _mm_sub_ps(x2r, tr);
+				__m128 a3i = _mm_sub_ps(x2i, ti);
+
+				// Second radix-2 stage (span 2h). W_4h^(j+h) = i * W_4h^j for the inverse transform.
+				tr = _mm_sub_ps(_mm_mul_ps(a2r, w2r), _mm_mul_ps(a2i, w2i));
+				ti = _mm_add_ps(_mm_mul_ps(a2r, w2i), _mm_mul_ps(a2i, w2r));
+				_mm_store_ps(pr[0], _mm_add_ps(a0r, tr));
+				_mm_store_ps(pi[0], _mm_add_ps(a0i, ti));
+				_mm_store_ps(pr[2], _mm_sub_ps(a0r, tr));
+				_mm_store_ps(pi[2], _mm_sub_ps(a0i, ti));
+
+				tr = _mm_sub_ps(_mm_mul_ps(a3r, w2r), _mm_mul_ps(a3i, w2i));
+				ti = _mm_add_ps(_mm_mul_ps(a3r, w2i), _mm_mul_ps(a3i, w2r));
+				_mm_store_ps(pr[1], _mm_sub_ps(a1r, ti));
+				_mm_store_ps(pi[1], _mm_add_ps(a1i, tr));
+				_mm_store_ps(pr[3], _mm_add_ps(a1r, ti));
+				_mm_store_ps(pi[3], _mm_sub_ps(a1i, tr));
+			}
+		}
+	}
+}
+
+void OceanWaves::ResolveVertices()
+{
+	const float* heightRe = Floats(mFieldRe[0]);
+	const float* dispXIm = Floats(mFieldIm[0]);
+	const float* dispZRe = Floats(mFieldRe[1]);
+	const float* slopeXIm = Floats(mFieldIm[1]);
+	const float* slopeZRe = Floats(mFieldRe[2]);
+
+	ParallelFor(mN, [=](int begin, int end)
+		{
+			const int n = mN;
+			const float dx = mPatchSize / n;
+
+			for (int i = begin; i < end; ++i)
+			{
+				for (int j = 0; j < n; ++j)
+				{
+					int idx = i * n + j;
+
+					// The spectrum is centered on k = 0, which multiplies the FFT output by (-1)^(i + j).
+					float sign = ((i + j) & 1) ? -1.0f : 1.0f;
+
+					float height = sign * heightRe[idx];
+					float dispX = sign * dispXIm[idx];
+					float dispZ = sign * dispZRe[idx];
+					float slopeX = sign * slopeXIm[idx];
+					float slopeZ = sign * slopeZRe[idx];
+
+					// Rows run towards -z in world space like Waves, so z displacement and slope flip sign.
+					float x = (j - n / 2) * dx;
+					float z = (n / 2 - i) * dx;
+
+					mPositions[idx] = XMFLOAT3(x + mChoppiness * dispX, height, z - mChoppiness * dispZ);
+
+					float invLength = 1.0f / sqrtf(slopeX * slopeX + 1.0f + slopeZ * slopeZ);
+					mNormals[idx] = XMFLOAT3(-slopeX * invLength, invLength, slopeZ * invLength);
+				}
+			}
+		});
+}
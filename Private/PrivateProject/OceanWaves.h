@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <xmmintrin.h>
+#include <DirectXMath.h>
+
+using namespace std;
+using namespace DirectX;
+
+enum class OceanSpectrum : int
+{
+	Phillips = 0,
+	Jonswap
+};
+
+struct OceanSettings
+{
+	OceanSpectrum Spectrum = OceanSpectrum::Phillips;
+
+	float WindSpeed = 12.0f;
+	XMFLOAT2 WindDirection = { 1.0f, 0.0f };
+
+	// Phillips only: overall amplitude and the wavelength below which waves are damped.
+	float PhillipsAmplitude = 0.0005f;
+	float SmallWaveLength = 0.05f;
+
+	// JONSWAP only: fetch in meters and the peak enhancement factor (gamma).
+	float Fetch = 120000.0f;
+	float PeakEnhancement = 3.3f;
+
+	float Choppiness = 1.0f;
+	unsigned int Seed = 1;
+};
+
+// Tessendorf style spectral ocean. Every Update evaluates the time evolved spectrum and
+// runs inverse 2D FFTs (rows then columns, four sequences per SSE register) to rebuild
+// heights, choppy displacements and normals on an n x n grid covering patchSize meters.
+class OceanWaves
+{
+public:
+	OceanWaves(int n, float patchSize, const OceanSettings& settings);
+	OceanWaves(const OceanWaves& rhs) = delete;
+	OceanWaves& operator=(const OceanWaves& rhs) = delete;
+	~OceanWaves();
+
+	int RowCount() const { return mN; }
+	int ColumnCount() const { return mN; }
+	int VertexCount() const { return mN * mN; }
+	int TriangleCount() const { return (mN - 1) * (mN - 1) * 2; }
+	float Width() const { return mPatchSize; }
+	float Depth() const { return mPatchSize; }
+
+	const XMFLOAT3& Position(int i) const { return mPositions[i]; }
+	const XMFLOAT3& Normal(int i) const { return mNormals[i]; }
+	const XMFLOAT2& TexC(int i) const { return mTexC[i]; }
+
+	uint64_t Version() const { return mVersion; }
+
+	void Update(float dt);
+
+	// Same contract as Waves::StreamVertices, so the ocean can feed a FrameWave buffer directly.
+	uint64_t StreamVertices(void* mappedVertices, uint64_t lastVersion) const;
+
+private:
+	void BuildSpectrum(const OceanSettings& settings);
+	float PhillipsSpectrum(float kx, float kz, const OceanSettings& settings) const;
+	float JonswapSpectrum(float kx, float kz, const OceanSettings& settings) const;
+
+	void EvaluateSpectrum(float time);
+	void InverseFFTRows();
+	void InverseFFTColumns();
+	void InverseFFT(float* re, float* im, size_t stride) const;
+	void ResolveVertices();
+
+private:
+	int mN = 0;
+	int mLog2N = 0;
+	float mPatchSize = 0.0f;
+	float mChoppiness = 1.0f;
+	float mTime = 0.0f;
+
+	uint64_t mVersion = 1;
+
+	vector<int> mBitReverse;
+	vector<float> mTwiddleRe;
+	vector<float> mTwiddleIm;
+
+	// Per frequency constants, N * N floats each, stored as SSE vectors so they stay 16 byte aligned.
+	vector<__m128> mH0Re;
+	vector<__m128> mH0Im;
+	vector<__m128> mH0ConjMinusRe;
+	vector<__m128> mH0ConjMinusIm;
+	vector<__m128> mOmega;
+	vector<__m128> mKx;
+	vector<__m128> mKz;
+	vector<__m128> mKxOverK;
+	vector<__m128> mKzOverK;
+
+	// Three packed complex fields: (height, dispX), (dispZ, slopeX), (slopeZ, unused).
+	static const int FieldCount = 3;
+	vector<__m128> mFieldRe[FieldCount];
+	vector<__m128> mFieldIm[FieldCount];
+
+	vector<XMFLOAT3> mPositions;
+	vector<XMFLOAT3> mNormals;
+	vector<XMFLOAT2> mTexC;
+};
@@ -0,0 +1,268 @@
+#include "PoissonScatter.h"
+#include <ppl.h>
+#include <random>
+#include <cmath>
+
+namespace
+{
+	unsigned int TileSeed(unsigned int seed, int tileX, int tileZ)
+	{
+		unsigned int h = seed * 0x9E3779B1u;
+		h ^= (unsigned int)tileX * 0x85EBCA6Bu + 0x7F4A7C15u + (h << 6) + (h >> 2);
+		h ^= (unsigned int)tileZ * 0xC2B2AE35u + 0x7F4A7C15u + (h << 6) + (h >> 2);
+		return h;
+	}
+
+	uint32_t SpreadBits(uint32_t v)
+	{
+		v &= 0xFFFF;
+		v = (v | (v << 8)) & 0x00FF00FF;
+		v = (v | (v << 4)) & 0x0F0F0F0F;
+		v = (v | (v << 2)) & 0x33333333;
+		v = (v | (v << 1)) & 0x55555555;
+		return v;
+	}
+}
+
+vector<ScatterTile> PoissonScatter::Scatter(const ScatterSettings& settings, const HeightFunction& heightFunc)
+{
+	assert(settings.MinDistance > 0.0f && settings.MinDistance <= settings.TileSize);
+
+	const int tilesX = max(1, (int)ceilf((settings.Max.x - settings.Min.x) / settings.TileSize));
+	const int tilesZ = max(1, (int)ceilf((settings.Max.y - settings.Min.y) / settings.TileSize));
+
+	vector<vector<XMFLOAT2>> samples(tilesX * tilesZ);
+
+	// Tiles of one pass never touch each other, so they can run in parallel while reading the
+	// finished tiles of earlier passes.
+	for (int pass = 0; pass < 4; ++pass)
+	{
+		vector<int> tiles;
+		for (int tz = pass >> 1; tz < tilesZ; tz += 2)
+		{
+			for (int tx = pass & 1; tx < tilesX; tx += 2)
+			{
+				tiles.push_back(tz * tilesX + tx);
+			}
+		}
+
+		concurrency::parallel_for(0, (int)tiles.size(), [&](int k)
+			{
+				int tile = tiles[k];
+				ScatterTilePoints(settings, tilesX, tilesZ, tile % tilesX, tile / tilesX, samples, samples[tile]);
+			});
+	}
+
+	vector<ScatterTile> result(tilesX * tilesZ);
+
+	concurrency::parallel_for(0, tilesX * tilesZ, [&](int tile)
+		{
+			ScatterTile& out = result[tile];
+			out.X = tile % tilesX;
+			out.Z = tile / tilesX;
+
+			XMFLOAT2 tileMin(
+				settings.Min.x + out.X * settings.TileSize,
+				settings.Min.y + out.Z * settings.TileSize);
+
+			out.Points = BuildSprites(settings, heightFunc, TileSeed(settings.Seed, out.X, out.Z) ^ 0x5BD1E995u,
+				tileMin, samples[tile], out.Bounds);
+		});
+
+	return result;
+}
+
+void PoissonScatter::ScatterTilePoints(const ScatterSettings& settings, int tilesX, int tilesZ, int tileX, int tileZ,
+	const vector<vector<XMFLOAT2>>& samples, vector<XMFLOAT2>& points)
+{
+	const float r = settings.MinDistance;
+	const float rSq = r * r;
+	const float cellSize = r / sqrtf(2.0f);
+
+	const float x0 = settings.Min.x + tileX * settings.TileSize;
+	const float z0 = settings.Min.y + tileZ * settings.TileSize;
+	const float x1 = min(x0 + settings.TileSize, settings.Max.x);
+	const float z1 = min(z0 + settings.TileSize, settings.Max.y);
+
+	// The background grid also covers a MinDistance wide margin for the neighbours' points.
+	const float gridX = x0 - r;
+	const float gridZ = z0 - r;
+	const int gridW = (int)ceilf((x1 - x0 + 2.0f * r) / cellSize) + 1;
+	const int gridD = (int)ceilf((z1 - z0 + 2.0f * r) / cellSize) + 1;
+
+	vector<XMFLOAT2> known;
+	vector<int> grid(gridW * gridD, -1);
+
+	auto cellOf = [&](const XMFLOAT2& p, int& ci, int& cj)
+		{
+			cj = (int)((p.x - gridX) / cellSize);
+			ci = (int)((p.y - gridZ) / cellSize);
+		};
+
+	auto insert = [&](const XMFLOAT2& p)
+		{
+			int ci, cj;
+			cellOf(p, ci, cj);
+			grid[ci * gridW + cj] = (int)known.size();
+			known.push_back(p);
+		};
+
+	auto isFree = [&](const XMFLOAT2& p)
+		{
+			int ci, cj;
+			cellOf(p, ci, cj);
+
+			for (int i = max(ci - 2, 0); i <= min(ci + 2, gridD - 1); ++i)
+			{
+				for (int j = max(cj - 2, 0); j <= min(cj + 2, gridW - 1); ++j)
+				{
+					int k = grid[i * gridW + j];
+					if (k >= 0)
+					{
+						float dx = known[k].x - p.x;
+						float dz = known[k].y - p.y;
+						if (dx * dx + dz * dz < rSq)
+						{
+							return false;
+						}
+					}
+				}
+			}
+			return true;
+		};
+
+	for (int dz = -1; dz <= 1; ++dz)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			int nx = tileX + dx;
+			int nz = tileZ + dz;
+			if ((dx == 0 && dz == 0) || nx < 0 || nz < 0 || nx >= tilesX || nz >= tilesZ)
+			{
+				continue;
+			}
+
+			for (const auto& p : samples[nz * tilesX + nx])
+			{
+				if (p.x >= x0 - r && p.x < x1 + r && p.y >= z0 - r && p.y < z1 + r)
+				{
+					insert(p);
+				}
+			}
+		}
+	}
+
+	mt19937 rng(TileSeed(settings.Seed, tileX, tileZ));
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	vector<int> active;
+
+	for (int attempt = 0; attempt < settings.CandidateCount && active.empty(); ++attempt)
+	{
+		XMFLOAT2 p(x0 + unit(rng) * (x1 - x0), z0 + unit(rng) * (z1 - z0));
+		if (isFree(p))
+		{
+			active.push_back((int)known.size());
+			points.push_back(p);
+			insert(p);
+		}
+	}
+
+	while (!active.empty())
+	{
+		int slot = (int)(unit(rng) * active.size()) % (int)active.size();
+		XMFLOAT2 center = known[active[slot]];
+
+		bool placed = false;
+		for (int attempt = 0; attempt < settings.CandidateCount; ++attempt)
+		{
+			// Uniform by area over the annulus [r, 2r).
+			float radius = sqrtf(rSq + unit(rng) * 3.0f * rSq);
+			float angle = XM_2PI * unit(rng);
+
+			XMFLOAT2 p(center.x + radius * cosf(angle), center.y + radius * sinf(angle));
+			if (p.x < x0 || p.x >= x1 || p.y < z0 || p.y >= z1 || !isFree(p))
+			{
+				continue;
+			}
+
+			active.push_back((int)known.size());
+			points.push_back(p);
+			insert(p);
+			placed = true;
+			break;
+		}
+
+		if (!placed)
+		{
+			active[slot] = active.back();
+			active.pop_back();
+		}
+	}
+}
+
+vector<PointVertex> PoissonScatter::BuildSprites(const ScatterSettings& settings, const HeightFunction& heightFunc,
+	unsigned int seed, const XMFLOAT2& tileMin, const vector<XMFLOAT2>& points, BoundingBox& bounds)
+{
+	const float eps = 0.25f * settings.MinDistance;
+	const float maxSlopeSq = settings.MaxSlope * settings.MaxSlope;
+
+	mt19937 rng(seed);
+	uniform_real_distribution<float> variation(-settings.SizeVariation, settings.SizeVariation);
+
+	vector<pair<uint32_t, PointVertex>> sprites;
+	sprites.reserve(points.size());
+
+	XMFLOAT3 vMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 vMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (const auto& p : points)
+	{
+		// Draw the size first so the random sequence does not depend on which points are filtered.
+		float scale = 1.0f + variation(rng);
+
+		float h = heightFunc(p.x, p.y);
+		if (h < settings.MinHeight || h > settings.MaxHeight)
+		{
+			continue;
+		}
+
+		float dhdx = (heightFunc(p.x + eps, p.y) - heightFunc(p.x - eps, p.y)) / (2.0f * eps);
+		float dhdz = (heightFunc(p.x, p.y + eps) - heightFunc(p.x, p.y - eps)) / (2.0f * eps);
+		if (dhdx * dhdx + dhdz * dhdz > maxSlopeSq)
+		{
+			continue;
+		}
+
+		XMFLOAT2 size(settings.SpriteSize.x * scale, settings.SpriteSize.y * scale);
+
+		PointVertex v;
+		v.Pos = XMFLOAT3(p.x, h + 0.5f * size.y, p.y);
+		v.Size = size;
+
+		uint32_t qx = (uint32_t)min(max((p.x - tileMin.x) / settings.TileSize * 65535.0f, 0.0f), 65535.0f);
+		uint32_t qz = (uint32_t)min(max((p.y - tileMin.y) / settings.TileSize * 65535.0f, 0.0f), 65535.0f);
+		sprites.push_back({ SpreadBits(qx) | (SpreadBits(qz) << 1), v });
+
+		vMin = XMFLOAT3(min(vMin.x, p.x - 0.5f * size.x), min(vMin.y, h), min(vMin.z, p.y - 0.5f * size.x));
+		vMax = XMFLOAT3(max(vMax.x, p.x + 0.5f * size.x), max(vMax.y, h + size.y), max(vMax.z, p.y + 0.5f * size.x));
+	}
+
+	sort(sprites.begin(), sprites.end(), [](const pair<uint32_t, PointVertex>& a, const pair<uint32_t, PointVertex>& b)
+		{
+			return a.first < b.first;
+		});
+
+	vector<PointVertex> result(sprites.size());
+	for (size_t k = 0; k < sprites.size(); ++k)
+	{
+		result[k] = sprites[k].second;
+	}
+
+	if (!result.empty())
+	{
+		BoundingBox::CreateFromPoints(bounds, XMLoadFloat3(&vMin), XMLoadFloat3(&vMax));
+	}
+
+	return result;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "FrameResource.h"
+#include <cfloat>
+#include <functional>
+
+struct ScatterSettings
+{
+	// World space rectangle in x and z covered by the scatter, split into square tiles.
+	XMFLOAT2 Min = { -512.0f, -512.0f };
+	XMFLOAT2 Max = { 512.0f, 512.0f };
+	float TileSize = 64.0f;
+
+	// Bridson parameters: no two points closer than MinDistance, CandidateCount tries per active point.
+	float MinDistance = 8.0f;
+	int CandidateCount = 30;
+
+	// Points on terrain outside the height band or steeper than MaxSlope (rise over run) are dropped.
+	float MinHeight = -FLT_MAX;
+	float MaxHeight = FLT_MAX;
+	float MaxSlope = 1.0f;
+
+	XMFLOAT2 SpriteSize = { 20.0f, 20.0f };
+	float SizeVariation = 0.0f;
+
+	unsigned int Seed = 1;
+};
+
+struct ScatterTile
+{
+	int X = 0;
+	int Z = 0;
+	BoundingBox Bounds;
+
+	// Sprite centers, sorted along a Morton curve within the tile.
+	vector<PointVertex> Points;
+};
+
+// Poisson disk scatter for sprites such as trees. Each tile runs Bridson's algorithm over its own
+// background grid with a seed derived from its coordinates, so results do not depend on thread count.
+// Tiles are generated in four passes of non-adjacent tiles; every tile sees the points of the
+// neighbours finished in earlier passes, which keeps the spacing across tile borders.
+class PoissonScatter
+{
+public:
+	using HeightFunction = function<float(float, float)>;
+
+	static vector<ScatterTile> Scatter(const ScatterSettings& settings, const HeightFunction& heightFunc);
+
+private:
+	static void ScatterTilePoints(const ScatterSettings& settings, int tilesX, int tilesZ, int tileX, int tileZ,
+		const vector<vector<XMFLOAT2>>& samples, vector<XMFLOAT2>& points);
+
+	static vector<PointVertex> BuildSprites(const ScatterSettings& settings, const HeightFunction& heightFunc,
+		unsigned int seed, const XMFLOAT2& tileMin, const vector<XMFLOAT2>& points, BoundingBox& bounds);
+};
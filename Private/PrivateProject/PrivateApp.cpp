@@ -4,6 +4,11 @@
 #include "FrameWave.h"
 #include "Waves.h"
 #include "GeometryGenerator.h"
+#include "LandUtility.h"
+#include "PoissonScatter.h"
+#include "BillboardBatcher.h"
+#include "TerrainQuadtree.h"
+#include "TessellationPlanner.h"
 
 class PrivateApp : public BaseApp
 {
@@ -18,18 +23,25 @@ private:
 	virtual void Update(const Timer& gt) override;
 	virtual void OnKeyboardInput(const Timer& gt) override;
 	virtual void AnimateMaterials(const Timer& gt) override;
+	virtual void DrawOpaque(ID3D12GraphicsCommandList* cmdList) override;
 
 	void UpdateWaves(const Timer& gt);
+	void UpdateTreeSprites();
+	void UpdateTerrain();
+	void UpdateLandPatches();
+
+	void DrawTerrainChunks(ID3D12GraphicsCommandList* cmdList);
 
 	void LoadTextures();
 	void BuildRootSignature();
 	void BuildDescriptorHeaps();
 	void BuildShadersAndInputLayout();
 
-	void BuildQuadPatchGeometry();
+	void BuildLandPatchGeometry();
 	void BuildWavesGeometry();
 	void BuildBoxGeometry();
 	void BuildTreeGeometry();
+	void BuildTerrainGeometry();
 
 	void BuildMaterials();
 	void BuildRenderItems();
@@ -40,6 +52,28 @@ private:
 	vector<unique_ptr<FrameWave>> mFrameWaves;
 	unique_ptr<Waves> mWaves;
 	RenderItem* mWavesRitem = nullptr;
+
+	BillboardBatcher mTreeBatcher;
+	vector<PointVertex> mTreeSprites;
+	vector<unique_ptr<UploadBuffer<PointVertex>>> mFrameTreeVBs;
+	RenderItem* mTreeRitem = nullptr;
+
+	// Key 2 switches the land between the tessellated patch and the CDLOD terrain.
+	bool mDrawTerrain = false;
+	bool mTerrainKeyDown = false;
+	unique_ptr<TerrainQuadtree> mTerrain;
+	vector<TerrainChunk> mTerrainChunks;
+	vector<unique_ptr<UploadBuffer<TerrainChunkConstants>>> mFrameTerrainCBs;
+
+	// The tessellated land is a grid of patches; only those in view are submitted each frame, and
+	// the hull shader reads the factors planned for them from a root SRV.
+	UINT tessFactorsRootParameterIndex = 4;
+	unique_ptr<TessellationPlanner> mLandPlanner;
+	vector<int> mVisiblePatches;
+	vector<PatchTessFactors> mPatchFactors;
+	vector<unique_ptr<UploadBuffer<PatchTessFactors>>> mFramePatchFactors;
+	vector<unique_ptr<UploadBuffer<uint16_t>>> mFramePatchIBs;
+	RenderItem* mLandRitem = nullptr;
 };
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
@@ -84,14 +118,26 @@ bool PrivateApp::Initialize()
 
 	mWaves = make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
 
+	// Covers the same 320 x 320 area as the tessellated land patches.
+	TerrainSettings terrainSettings;
+	terrainSettings.WorldSize = 320.0f;
+	terrainSettings.LeafSize = 20.0f;
+	mTerrain = make_unique<TerrainQuadtree>(terrainSettings, LandUtility::GetHillsHeight);
+
+	// The domain shader displaces the patches with the same hills function.
+	TessellationPlannerSettings landSettings;
+	landSettings.TriangleBudget = 400000;
+	mLandPlanner = make_unique<TessellationPlanner>(landSettings, LandUtility::GetHillsHeight);
+
 	LoadTextures();
 	BuildRootSignature();
 	BuildDescriptorHeaps();
 	BuildShadersAndInputLayout();
-	BuildQuadPatchGeometry();
+	BuildLandPatchGeometry();
 	BuildWavesGeometry();
 	BuildBoxGeometry();
 	BuildTreeGeometry();
+	BuildTerrainGeometry();
 	BuildMaterials();
 	BuildRenderItems();
 	BuildFrameResources();
@@ -112,11 +158,21 @@ void PrivateApp::Update(const Timer& gt)
 {
 	BaseApp::Update(gt);
 	UpdateWaves(gt);
+	UpdateTreeSprites();
+	UpdateTerrain();
+	UpdateLandPatches();
 }
 
 void PrivateApp::OnKeyboardInput(const Timer& gt)
 {
 	BaseApp::OnKeyboardInput(gt);
+
+	bool terrainKeyDown = (GetAsyncKeyState('2') & 0x8000) != 0;
+	if (terrainKeyDown && !mTerrainKeyDown)
+	{
+		mDrawTerrain = !mDrawTerrain;
+	}
+	mTerrainKeyDown = terrainKeyDown;
 }
 
 void PrivateApp::AnimateMaterials(const Timer& gt)
@@ -162,20 +218,140 @@ void PrivateApp::UpdateWaves(const Timer& gt)
 	mWaves->Update(gt.GetDeltaTime());
 
 	auto currWavesVB = mFrameWaves[mCurrFrameResourceIndex].get();
-	for (int i = 0; i < mWaves->VertexCount(); ++i)
+	currWavesVB->WavesVersion = mWaves->StreamVertices(currWavesVB->WavesVB->MappedData(), currWavesVB->WavesVersion);
+
+	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->WavesVB->Resource();
+}
+
+// Streams the sprites of the tiles in view, farthest first, into this frame's vertex buffer.
+void PrivateApp::UpdateTreeSprites()
+{
+	mTreeBatcher.Build(XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj), mTreeSprites);
+
+	auto currTreeVB = mFrameTreeVBs[mCurrFrameResourceIndex].get();
+	CopyMemory(currTreeVB->MappedData(), mTreeSprites.data(), mTreeSprites.size() * sizeof(PointVertex));
+
+	mTreeRitem->Geo->VertexBufferGPU = currTreeVB->Resource();
+	mTreeRitem->IndexCount = (UINT)mTreeSprites.size();
+}
+
+// Selects the chunks in view and writes their constants into this frame's buffer.
+void PrivateApp::UpdateTerrain()
+{
+	if (!mDrawTerrain)
+	{
+		return;
+	}
+
+	mTerrain->Select(mEyePos, XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj), (float)mClientHeight, mTerrainChunks);
+
+	// Chunks never overlap and none is smaller than a leaf, so there are fewer chunks than nodes.
+	assert(mTerrainChunks.size() <= (size_t)mTerrain->NodeCount());
+
+	auto currTerrainCB = mFrameTerrainCBs[mCurrFrameResourceIndex].get();
+	for (size_t i = 0; i < mTerrainChunks.size(); ++i)
 	{
-		Vertex v;
+		const TerrainChunk& chunk = mTerrainChunks[i];
 
-		v.Pos = mWaves->Position(i);
-		v.Normal = mWaves->Normal(i);
+		TerrainChunkConstants chunkConstants;
+		chunkConstants.ChunkOrigin = chunk.Origin;
+		chunkConstants.ChunkSize = chunk.Size;
+		chunkConstants.GridResolution = (float)mTerrain->ChunkResolution();
+		chunkConstants.MorphStart = chunk.MorphStart;
+		chunkConstants.MorphEnd = chunk.MorphEnd;
+		chunkConstants.TerrainSize = mTerrain->WorldSize();
 
-		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
-		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
+		currTerrainCB->CopyData((int)i, chunkConstants);
+	}
+}
 
-		currWavesVB->WavesVB->CopyData(i, v);
+// Plans the factors of the patches in view and writes them, with the indices of those patches,
+// into this frame's buffers. Patch k of the draw reads factor k, since SV_PrimitiveID counts the
+// patches submitted.
+void PrivateApp::UpdateLandPatches()
+{
+	if (mDrawTerrain)
+	{
+		return;
 	}
 
-	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->WavesVB->Resource();
+	mLandPlanner->Plan(mEyePos, XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj), (float)mClientHeight,
+		mVisiblePatches, mPatchFactors);
+
+	auto currFactors = mFramePatchFactors[mCurrFrameResourceIndex].get();
+	auto currIB = mFramePatchIBs[mCurrFrameResourceIndex].get();
+	for (size_t i = 0; i < mVisiblePatches.size(); ++i)
+	{
+		currFactors->CopyData((int)i, mPatchFactors[i]);
+
+		uint16_t firstVertex = (uint16_t)(4 * mVisiblePatches[i]);
+		for (int corner = 0; corner < 4; ++corner)
+		{
+			currIB->CopyData(4 * (int)i + corner, (uint16_t)(firstVertex + corner));
+		}
+	}
+
+	mLandRitem->Geo->IndexBufferGPU = currIB->Resource();
+	mLandRitem->IndexCount = 4 * (UINT)mVisiblePatches.size();
+}
+
+void PrivateApp::DrawOpaque(ID3D12GraphicsCommandList* cmdList)
+{
+	if (mDrawTerrain)
+	{
+		DrawTerrainChunks(cmdList);
+	}
+	else
+	{
+		auto factors = mFramePatchFactors[mCurrFrameResourceIndex]->Resource();
+		cmdList->SetGraphicsRootShaderResourceView(tessFactorsRootParameterIndex, factors->GetGPUVirtualAddress());
+
+		BaseApp::DrawOpaque(cmdList);
+	}
+}
+
+// Every chunk is drawn with the same grid, whole or one quadrant of it; its constants place it in
+// the world and set up the morph.
+void PrivateApp::DrawTerrainChunks(ID3D12GraphicsCommandList* cmdList)
+{
+	string psoSuffix = mWireFrameMode ? "_wireframe" : "";
+	cmdList->SetPipelineState(mPSOs["terrain" + psoSuffix].Get());
+
+	auto geo = mGeometries["terrainGeo"].get();
+	auto vertexBufferView = geo->VertexBufferView();
+	auto indexBufferView = geo->IndexBufferView();
+	cmdList->IASetVertexBuffers(0, 1, &vertexBufferView);
+	cmdList->IASetIndexBuffer(&indexBufferView);
+	cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	auto grass = mMaterials["grassMat"].get();
+	UINT matCBByteSize = D3DUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	cmdList->SetGraphicsRootConstantBufferView(matCBRootParameterIndex, matCB->GetGPUVirtualAddress() + grass->MatCBIndex * matCBByteSize);
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	tex.Offset(grass->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+	cmdList->SetGraphicsRootDescriptorTable(texRootParameterIndex, tex);
+
+	UINT chunkCBByteSize = D3DUtil::CalcConstantBufferByteSize(sizeof(TerrainChunkConstants));
+	auto chunkCB = mFrameTerrainCBs[mCurrFrameResourceIndex]->Resource();
+	UINT quadrantIndexCount = mTerrain->QuadrantIndexCount();
+
+	for (size_t i = 0; i < mTerrainChunks.size(); ++i)
+	{
+		const TerrainChunk& chunk = mTerrainChunks[i];
+
+		cmdList->SetGraphicsRootConstantBufferView(objRootParameterIndex, chunkCB->GetGPUVirtualAddress() + i * chunkCBByteSize);
+
+		if (chunk.Quadrant < 0)
+		{
+			cmdList->DrawIndexedInstanced(4 * quadrantIndexCount, 1, 0, 0, 0);
+		}
+		else
+		{
+			cmdList->DrawIndexedInstanced(quadrantIndexCount, 1, chunk.Quadrant * quadrantIndexCount, 0, 0);
+		}
+	}
 }
 
 void PrivateApp::LoadTextures()
@@ -219,17 +395,18 @@ void PrivateApp::BuildRootSignature()
 	CD3DX12_DESCRIPTOR_RANGE texTable;
 	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
 
-	CD3DX12_ROOT_PARAMETER slotRootParameters[4];
+	CD3DX12_ROOT_PARAMETER slotRootParameters[5];
 
 	slotRootParameters[objRootParameterIndex].InitAsConstantBufferView(0);
 	slotRootParameters[passCBRootParameterIndex].InitAsConstantBufferView(1);
 	slotRootParameters[matCBRootParameterIndex].InitAsConstantBufferView(2);
 	slotRootParameters[texRootParameterIndex].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameters[tessFactorsRootParameterIndex].InitAsShaderResourceView(1, 0, D3D12_SHADER_VISIBILITY_HULL);
 
 	auto staticSamplers = StaticSampler::GetStaticSamplers();
 
 	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(
-		4,
+		5,
 		slotRootParameters,
 		(UINT)staticSamplers.size(),
 		staticSamplers.data(),
@@ -303,6 +480,12 @@ void PrivateApp::BuildShadersAndInputLayout()
 		NULL, NULL
 	};
 
+	const D3D_SHADER_MACRO tessDefines[] =
+	{
+		"CPU_TESS_FACTORS", "1",
+		NULL, NULL
+	};
+
 	const D3D_SHADER_MACRO alphaTestDefines[] =
 	{
 		"FOG", "1",
@@ -315,10 +498,13 @@ void PrivateApp::BuildShadersAndInputLayout()
 	mShaders["alphaTestedPS"] = D3DUtil::CompileShader(L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_0");
 
 	mShaders["tessVS"] = D3DUtil::CompileShader(L"Shaders\\LandTessellation.hlsl", nullptr, "VS", "vs_5_0");
-	mShaders["tessHS"] = D3DUtil::CompileShader(L"Shaders\\LandTessellation.hlsl", nullptr, "HS", "hs_5_0");
+	mShaders["tessHS"] = D3DUtil::CompileShader(L"Shaders\\LandTessellation.hlsl", tessDefines, "HS", "hs_5_0");
 	mShaders["tessDS"] = D3DUtil::CompileShader(L"Shaders\\LandTessellation.hlsl", nullptr, "DS", "ds_5_0");
 	mShaders["tessPS"] = D3DUtil::CompileShader(L"Shaders\\LandTessellation.hlsl", defines, "PS", "ps_5_0");
 
+	mShaders["terrainVS"] = D3DUtil::CompileShader(L"Shaders\\Terrain.hlsl", nullptr, "VS", "vs_5_0");
+	mShaders["terrainPS"] = D3DUtil::CompileShader(L"Shaders\\Terrain.hlsl", defines, "PS", "ps_5_0");
+
 	mShaders["treeVS"] = D3DUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_0");
 	mShaders["treeGS"] = D3DUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_0");
 	mShaders["treePS"] = D3DUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_0");
@@ -336,6 +522,11 @@ void PrivateApp::BuildShadersAndInputLayout()
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
 	};
 
+	mTerrainInputLayout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
+	};
+
 	mTreeSpriteInputLayout =
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
@@ -343,23 +534,23 @@ void PrivateApp::BuildShadersAndInputLayout()
 	};
 }
 
-void PrivateApp::BuildQuadPatchGeometry()
+// Every patch is listed once here; each frame the index buffer is replaced with the patches in view.
+void PrivateApp::BuildLandPatchGeometry()
 {
-	array<XMFLOAT3, 4> vertices =
-	{
-		XMFLOAT3(-160.0f, 0.0f,  160.0f),
-		XMFLOAT3(160.0f, 0.0f,  160.0f),
-		XMFLOAT3(-160.0f, 0.0f, -160.0f),
-		XMFLOAT3(160.0f, 0.0f, -160.0f),
-	};
+	vector<XMFLOAT3> vertices = mLandPlanner->BuildPatchVertices();
 
-	array<uint16_t, 4> indices = { 0, 1, 2, 3 };
+	assert(vertices.size() < 0x0000ffff);
+	vector<uint16_t> indices(vertices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		indices[i] = (uint16_t)i;
+	}
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(XMFLOAT3);
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(uint16_t);
 
 	auto geo = make_unique<MeshGeometry>();
-	geo->Name = "quadpatchGeo";
+	geo->Name = "landPatchGeo";
 
 	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
@@ -383,7 +574,7 @@ void PrivateApp::BuildQuadPatchGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
-	geo->DrawArgs["quadpatch"] = submesh;
+	geo->DrawArgs["patches"] = submesh;
 
 	mGeometries[geo->Name] = move(geo);
 }
@@ -492,31 +683,81 @@ void PrivateApp::BuildBoxGeometry()
 
 void PrivateApp::BuildTreeGeometry()
 {
-	static const int numTrees = 16;
+	ScatterSettings settings;
+	settings.Min = XMFLOAT2(-45.0f, -45.0f);
+	settings.Max = XMFLOAT2(45.0f, 45.0f);
+	settings.TileSize = 45.0f;
+	settings.MinDistance = 18.0f;
+	settings.MaxSlope = 1.5f;
+	settings.SpriteSize = XMFLOAT2(20.0f, 20.0f);
+	settings.SizeVariation = 0.15f;
+
+	vector<ScatterTile> tiles = PoissonScatter::Scatter(settings, LandUtility::GetHillsHeight);
+
+	size_t spriteCount = 0;
+	for (const auto& tile : tiles)
+	{
+		spriteCount += tile.Points.size();
+	}
+	assert(spriteCount < 0x0000ffff);
 
-	array<PointVertex, numTrees> vertices;
+	mTreeBatcher.SetTiles(move(tiles));
 
-	for (UINT i = 0; i < numTrees; ++i)
+	// The vertices are written every frame by UpdateTreeSprites, sorted back to front.
+	vector<uint16_t> indices(spriteCount);
+	for (size_t i = 0; i < indices.size(); ++i)
 	{
-		float x = MathHelper::RandF(-45.0f, 45.0f);
-		float z = MathHelper::RandF(-45.0f, 45.0f);
-		float y = 0.0f;
-
-		vertices[i].Pos = XMFLOAT3(x, y, z);
-		vertices[i].Size = XMFLOAT2(20.0f, 20.0f);
+		indices[i] = (uint16_t)i;
 	}
 
-	array<uint16_t, numTrees> indices =
+	const UINT vbByteSize = (UINT)spriteCount * sizeof(PointVertex);
+	const UINT ibByteSize = (UINT)indices.size() * sizeof(uint16_t);
+
+	auto geo = make_unique<MeshGeometry>();
+	geo->Name = "treeGeo";
+
+	geo->VertexBufferCPU = nullptr;
+	geo->VertexBufferGPU = nullptr;
+
+	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+
+	geo->IndexBufferGPU = D3DUtil::CreateDefaultBuffer(md3dDevice.Get(),
+		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+
+	geo->VertexByteStride = sizeof(PointVertex);
+	geo->VertexBufferByteSize = vbByteSize;
+	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexBufferByteSize = ibByteSize;
+
+	SubmeshGeometry submesh;
+	submesh.IndexCount = (UINT)indices.size();
+	submesh.StartIndexLocation = 0;
+	submesh.BaseVertexLocation = 0;
+
+	geo->DrawArgs["tree"] = submesh;
+	mGeometries[geo->Name] = move(geo);
+}
+
+void PrivateApp::BuildTerrainGeometry()
+{
+	GeometryGenerator::MeshData grid = mTerrain->BuildChunkMesh();
+
+	// Only the unit grid position is stored; the vertex shader places, morphs and lights it.
+	vector<XMFLOAT3> vertices(grid.Vertices.size());
+	for (size_t i = 0; i < grid.Vertices.size(); ++i)
 	{
-		0, 1, 2, 3, 4, 5, 6, 7,
-		8, 9, 10, 11, 12, 13, 14, 15
-	};
+		vertices[i] = grid.Vertices[i].Position;
+	}
+
+	assert(vertices.size() < 0x0000ffff);
+	vector<uint16_t> indices = grid.GetIndices16();
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(PointVertex);
+	const UINT vbByteSize = (UINT)vertices.size() * sizeof(XMFLOAT3);
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(uint16_t);
 
 	auto geo = make_unique<MeshGeometry>();
-	geo->Name = "treeGeo";
+	geo->Name = "terrainGeo";
 
 	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
@@ -530,7 +771,7 @@ void PrivateApp::BuildTreeGeometry()
 	geo->IndexBufferGPU = D3DUtil::CreateDefaultBuffer(md3dDevice.Get(),
 		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
 
-	geo->VertexByteStride = sizeof(PointVertex);
+	geo->VertexByteStride = sizeof(XMFLOAT3);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
@@ -540,7 +781,7 @@ void PrivateApp::BuildTreeGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
-	geo->DrawArgs["tree"] = submesh;
+	geo->DrawArgs["chunk"] = submesh;
 	mGeometries[geo->Name] = move(geo);
 }
 
@@ -586,18 +827,19 @@ void PrivateApp::BuildMaterials()
 
 void PrivateApp::BuildRenderItems()
 {
-	auto quadPatchRitem = make_unique<RenderItem>();
-	quadPatchRitem->World = MathHelper::Identity4x4();
-	quadPatchRitem->TexTransform = MathHelper::Identity4x4();
-	quadPatchRitem->ObjCBIndex = 0;
-	quadPatchRitem->Mat = mMaterials["grassMat"].get();
-	quadPatchRitem->Geo = mGeometries["quadpatchGeo"].get();
-	quadPatchRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_4_CONTROL_POINT_PATCHLIST;
-	quadPatchRitem->IndexCount = quadPatchRitem->Geo->DrawArgs["quadpatch"].IndexCount;
-	quadPatchRitem->StartIndexLocation = quadPatchRitem->Geo->DrawArgs["quadpatch"].StartIndexLocation;
-	quadPatchRitem->baseVertexLocation = quadPatchRitem->Geo->DrawArgs["quadpatch"].BaseVertexLocation;
-
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(quadPatchRitem.get());
+	auto landPatchRitem = make_unique<RenderItem>();
+	landPatchRitem->World = MathHelper::Identity4x4();
+	landPatchRitem->TexTransform = MathHelper::Identity4x4();
+	landPatchRitem->ObjCBIndex = 0;
+	landPatchRitem->Mat = mMaterials["grassMat"].get();
+	landPatchRitem->Geo = mGeometries["landPatchGeo"].get();
+	landPatchRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_4_CONTROL_POINT_PATCHLIST;
+	landPatchRitem->IndexCount = landPatchRitem->Geo->DrawArgs["patches"].IndexCount;
+	landPatchRitem->StartIndexLocation = landPatchRitem->Geo->DrawArgs["patches"].StartIndexLocation;
+	landPatchRitem->baseVertexLocation = landPatchRitem->Geo->DrawArgs["patches"].BaseVertexLocation;
+
+	mLandRitem = landPatchRitem.get();
+	mRitemLayer[(int)RenderLayer::Opaque].push_back(landPatchRitem.get());
 
 	auto wavesRitem = make_unique<RenderItem>();
 	wavesRitem->World = MathHelper::Identity4x4();
@@ -637,9 +879,10 @@ void PrivateApp::BuildRenderItems()
 	treeRitem->StartIndexLocation = treeRitem->Geo->DrawArgs["tree"].StartIndexLocation;
 	treeRitem->baseVertexLocation = treeRitem->Geo->DrawArgs["tree"].BaseVertexLocation;
 
+	mTreeRitem = treeRitem.get();
 	mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites].push_back(treeRitem.get());
 
-	mAllRitems.push_back(move(quadPatchRitem));
+	mAllRitems.push_back(move(landPatchRitem));
 	mAllRitems.push_back(move(wavesRitem));
 	mAllRitems.push_back(move(wirefenceRitem));
 	mAllRitems.push_back(move(treeRitem));
@@ -653,6 +896,18 @@ void PrivateApp::BuildFrameResources()
 			1, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
 
 		mFrameWaves.push_back(make_unique<FrameWave>(md3dDevice.Get(), mWaves->VertexCount()));
+
+		mFrameTreeVBs.push_back(make_unique<UploadBuffer<PointVertex>>(md3dDevice.Get(),
+			mGeometries["treeGeo"]->DrawArgs["tree"].IndexCount, false));
+
+		mFrameTerrainCBs.push_back(make_unique<UploadBuffer<TerrainChunkConstants>>(md3dDevice.Get(),
+			mTerrain->NodeCount(), true));
+
+		mFramePatchFactors.push_back(make_unique<UploadBuffer<PatchTessFactors>>(md3dDevice.Get(),
+			mLandPlanner->PatchCount(), false));
+
+		mFramePatchIBs.push_back(make_unique<UploadBuffer<uint16_t>>(md3dDevice.Get(),
+			4 * mLandPlanner->PatchCount(), false));
 	}
 }
 
@@ -738,6 +993,22 @@ void PrivateApp::BuildPSOs()
 		&treePsoDesc,
 		IID_PPV_ARGS(&mPSOs["treeSprites"])));
 
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC terrainPsoDesc = opaquePsoDesc;
+	terrainPsoDesc.InputLayout = { mTerrainInputLayout.data(), (UINT)mTerrainInputLayout.size() };
+	terrainPsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["terrainVS"]->GetBufferPointer()),
+		mShaders["terrainVS"]->GetBufferSize()
+	};
+	terrainPsoDesc.PS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["terrainPS"]->GetBufferPointer()),
+		mShaders["terrainPS"]->GetBufferSize()
+	};
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(
+		&terrainPsoDesc,
+		IID_PPV_ARGS(&mPSOs["terrain"])));
+
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 	psoDesc.InputLayout = { mLandInputLayout.data(), (UINT)mLandInputLayout.size() };
 	psoDesc.pRootSignature = mRootSignature.Get();
@@ -781,5 +1052,6 @@ void PrivateApp::BuildPSOs()
 	mPsoDescs["transparent"] = transparentPsoDesc;
 	mPsoDescs["alphaTested"] = alphaTestedPsoDesc;
 	mPsoDescs["treeSprites"] = treePsoDesc;
+	mPsoDescs["terrain"] = terrainPsoDesc;
 	mPsoDescs["tessellation"] = psoDesc;
 }
\ No newline at end of file
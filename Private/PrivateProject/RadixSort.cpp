@@ -0,0 +1,83 @@
+#include "RadixSort.h"
+#include <ppl.h>
+#include <algorithm>
+#include <thread>
+#include <cassert>
+
+void RadixSort::Sort(vector<uint32_t>& keys, vector<uint32_t>& values)
+{
+	assert(keys.size() == values.size());
+
+	const size_t n = keys.size();
+	if (n < 2)
+	{
+		return;
+	}
+
+	const int threadCount = max(1, (int)thread::hardware_concurrency());
+	const int blockCount = (int)min((size_t)threadCount, max((size_t)1, n / MinBlockSize));
+	const size_t blockSize = (n + blockCount - 1) / blockCount;
+
+	mKeyScratch.resize(n);
+	mValueScratch.resize(n);
+	mHistograms.resize(blockCount * BucketCount);
+
+	for (int shift = 0; shift < 32; shift += RadixBits)
+	{
+		const uint32_t* srcKeys = keys.data();
+		const uint32_t* srcValues = values.data();
+		uint32_t* dstKeys = mKeyScratch.data();
+		uint32_t* dstValues = mValueScratch.data();
+
+		concurrency::parallel_for(0, blockCount, [&](int b)
+			{
+				uint32_t* histogram = mHistograms.data() + b * BucketCount;
+				fill(histogram, histogram + BucketCount, 0);
+
+				size_t end = min(n, (b + 1) * blockSize);
+				for (size_t i = b * blockSize; i < end; ++i)
+				{
+					++histogram[(srcKeys[i] >> shift) & (BucketCount - 1)];
+				}
+			});
+
+		// Turn the counts into scatter offsets, digit major and block minor so the sort stays stable.
+		bool trivial = false;
+		uint32_t running = 0;
+		for (int d = 0; d < BucketCount; ++d)
+		{
+			uint32_t digitTotal = 0;
+			for (int b = 0; b < blockCount; ++b)
+			{
+				uint32_t count = mHistograms[b * BucketCount + d];
+				mHistograms[b * BucketCount + d] = running;
+				running += count;
+				digitTotal += count;
+			}
+
+			trivial |= digitTotal == n;
+		}
+
+		if (trivial)
+		{
+			continue;
+		}
+
+		concurrency::parallel_for(0, blockCount, [&](int b)
+			{
+				uint32_t* offsets = mHistograms.data() + b * BucketCount;
+
+				size_t end = min(n, (b + 1) * blockSize);
+				for (size_t i = b * blockSize; i < end; ++i)
+				{
+					uint32_t key = srcKeys[i];
+					uint32_t pos = offsets[(key >> shift) & (BucketCount - 1)]++;
+					dstKeys[pos] = key;
+					dstValues[pos] = srcValues[i];
+				}
+			});
+
+		keys.swap(mKeyScratch);
+		values.swap(mValueScratch);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// Stable LSD radix sort of 32-bit keys with a 32-bit payload, 8 bits per pass. Every pass builds
+// per block histograms and scatters the blocks in parallel; passes where all keys share the same
+// digit are skipped. Scratch memory is kept between calls.
+class RadixSort
+{
+public:
+	void Sort(vector<uint32_t>& keys, vector<uint32_t>& values);
+
+	// Maps a float to a key whose unsigned order matches the float order, negative values included.
+	static uint32_t FloatToKey(float f)
+	{
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+
+private:
+	static const int RadixBits = 8;
+	static const int BucketCount = 1 << RadixBits;
+	static const int MinBlockSize = 16384;
+
+	vector<uint32_t> mKeyScratch;
+	vector<uint32_t> mValueScratch;
+	vector<uint32_t> mHistograms;
+};
@@ -89,10 +89,32 @@ struct PatchTess
     float InsideTess[2] : SV_InsideTessFactor;
 };
 
+#ifdef CPU_TESS_FACTORS
+// Written by TessellationPlanner, one entry per submitted patch.
+struct PatchTessFactors
+{
+    float EdgeTess[4];
+    float InsideTess[2];
+};
+
+StructuredBuffer<PatchTessFactors> gPatchTess : register(t1);
+#endif
+
 PatchTess ConstantHS(InputPatch<VertexOut, 4> patch, uint patchID : SV_PrimitiveID)
 {
     PatchTess pt;
     
+#ifdef CPU_TESS_FACTORS
+    PatchTessFactors f = gPatchTess[patchID];
+
+    pt.EdgeTess[0] = f.EdgeTess[0];
+    pt.EdgeTess[1] = f.EdgeTess[1];
+    pt.EdgeTess[2] = f.EdgeTess[2];
+    pt.EdgeTess[3] = f.EdgeTess[3];
+
+    pt.InsideTess[0] = f.InsideTess[0];
+    pt.InsideTess[1] = f.InsideTess[1];
+#else
     float3 centerL = 0.25f * (patch[0].PosL + patch[1].PosL + patch[2].PosL + patch[3].PosL);
     float3 centerW = mul(float4(centerL, 1.0f), gWorld).xyz;
 
@@ -109,6 +131,7 @@ PatchTess ConstantHS(InputPatch<VertexOut, 4> patch, uint patchID : SV_Primitive
     
     pt.InsideTess[0] = tess;
     pt.InsideTess[1] = tess;
+#endif
 
     return pt;
 }
@@ -156,7 +179,8 @@ DomainOut DS(PatchTess patchTess,
     // p.y = 0.3f * (p.z * sin(p.x) + p.x * cos(p.z));
     p.y = 0.3f * (p.z * sin(0.1f * p.x) + p.x * cos(0.1f * p.z));
     
-    dout.TexC = uv;
+    // Stretched over the whole 320 x 320 land rather than repeated per patch.
+    dout.TexC = float2(p.x, -p.z) / 320.0f + 0.5f;
 
 //     float3 normal = normalize(float3(
 //         -0.03f * p.z * cos(p.x) - 0.3f * cos(p.z),
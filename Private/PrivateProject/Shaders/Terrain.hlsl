@@ -0,0 +1,150 @@
+#ifndef NUM_DIR_LIGHTS
+#define NUM_DIR_LIGHTS 3
+#endif
+
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 0
+#endif
+
+#ifndef NUM_SPOT_LIGHTS
+#define NUM_SPOT_LIGHTS 0
+#endif
+
+#include "LightingUtil.hlsl"
+
+Texture2D gDiffuseMap : register(t0);
+
+SamplerState gsamPointWrap : register(s0);
+SamplerState gsamPointClamp : register(s1);
+SamplerState gsamLinearWrap : register(s2);
+SamplerState gsamLinearClamp : register(s3);
+SamplerState gsamAnisotropicWrap : register(s4);
+SamplerState gsamAnisotropicClamp : register(s5);
+
+#include "TerrainMorph.hlsl"
+
+// One TerrainChunk of TerrainQuadtree, written per frame by PrivateApp::UpdateTerrain.
+cbuffer cbTerrainChunk : register(b0)
+{
+    float2 gChunkOrigin;
+    float gChunkSize;
+    float gGridResolution;
+    float gMorphStart;
+    float gMorphEnd;
+    float gTerrainSize;
+    float cbTerrainChunkPad;
+};
+
+cbuffer cbPass : register(b1)
+{
+    float4x4 gView;
+    float4x4 gInvView;
+    float4x4 gProj;
+    float4x4 gInvProj;
+    float4x4 gViewProj;
+    float4x4 gInvViewProj;
+    float3 gEyePosW;
+    float cbPerObjectPad1;
+    float2 gRenderTargetSize;
+    float2 gInvRenderTargetSize;
+    float gNearZ;
+    float gFarZ;
+    float gTotalTime;
+    float gDeltaTime;
+    float4 gAmbientLight;
+
+    float4 gFogColor;
+    float gFogStart;
+    float gFogRange;
+    float2 cbPerObjectPad2;
+    
+    Light gLights[MaxLights];
+};
+
+cbuffer cbMaterial : register(b2)
+{
+    float4 gDiffuseAlbedo;
+    float3 gFresnelR0;
+    float gRoughness;
+    float4x4 gMatTransform;
+};
+
+struct VertexIn
+{
+    float3 GridPos : POSITION;
+};
+
+struct VertexOut
+{
+    float4 PosH : SV_POSITION;
+    float3 PosW : POSITION;
+    float3 NormalW : NORMAL;
+    float2 TexC : TEXCOORD;
+};
+
+// Same surface as the domain shader in LandTessellation.hlsl and LandUtility::GetHillsHeight.
+float HillsHeight(float2 p)
+{
+    return 0.3f * (p.y * sin(0.1f * p.x) + p.x * cos(0.1f * p.y));
+}
+
+float3 HillsNormal(float2 p)
+{
+    return normalize(float3(
+        -0.03f * p.y * cos(0.1f * p.x) - 0.3f * cos(0.1f * p.y),
+        1.0f,
+        -0.3f * sin(0.1f * p.x) + 0.03f * p.x * sin(0.1f * p.y)));
+}
+
+VertexOut VS(VertexIn vin)
+{
+    VertexOut vout = (VertexOut) 0.0f;
+
+    float2 unmorphedXZ = gChunkOrigin + vin.GridPos.xz * gChunkSize;
+    float2 posXZ = TerrainWorldXZ(vin.GridPos.xz, gGridResolution, gChunkOrigin, gChunkSize,
+        gEyePosW, gMorphStart, gMorphEnd, HillsHeight(unmorphedXZ));
+
+    vout.PosW = float3(posXZ.x, HillsHeight(posXZ), posXZ.y);
+    vout.NormalW = HillsNormal(posXZ);
+    vout.PosH = mul(float4(vout.PosW, 1.0f), gViewProj);
+
+    // Stretched over the whole terrain like the tessellated land patch.
+    vout.TexC = float2(posXZ.x, -posXZ.y) / gTerrainSize + 0.5f;
+
+    return vout;
+}
+
+float4 PS(VertexOut pin) : SV_Target
+{
+    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+
+#ifdef ALPHA_TEST
+    clip(diffuseAlbedo.a - 0.1f);
+#endif
+
+    pin.NormalW = normalize(pin.NormalW);
+
+    float3 toEyeW = gEyePosW - pin.PosW;
+    float distToEye = length(toEyeW);
+    toEyeW /= distToEye;
+    
+    float4 ambient = gAmbientLight * diffuseAlbedo;
+
+    const float shininess = 1.0f - gRoughness;
+    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+
+    float3 shadowFactor = 1.0f;
+    float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
+        pin.NormalW, toEyeW, shadowFactor);
+
+    float4 litColor = ambient + directLight;
+    
+#ifdef FOG
+    float fogAmount = saturate((distToEye - gFogStart) / gFogRange);
+    litColor = lerp(litColor, gFogColor, fogAmount);
+#endif
+    
+    litColor.a = diffuseAlbedo.a;
+    
+    return litColor;
+}
\ No newline at end of file
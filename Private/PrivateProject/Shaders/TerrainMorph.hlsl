@@ -0,0 +1,25 @@
+// Vertex side of TerrainQuadtree. gridPos is the chunk mesh position in [0, 1] and resolution the
+// number of quads per chunk edge; chunkOrigin, chunkSize and the morph range come from TerrainChunk.
+
+float TerrainMorphFactor(float eyeDist, float morphStart, float morphEnd)
+{
+    return saturate((eyeDist - morphStart) / (morphEnd - morphStart));
+}
+
+// Slides every odd grid vertex onto its even neighbour as morphK goes to 1, at which point the chunk
+// matches the grid of the next coarser level exactly.
+float2 MorphTerrainVertex(float2 gridPos, float resolution, float morphK)
+{
+    float2 fracPart = frac(gridPos * resolution * 0.5f) * 2.0f / resolution;
+    return gridPos - fracPart * morphK;
+}
+
+float2 TerrainWorldXZ(float2 gridPos, float resolution, float2 chunkOrigin, float chunkSize,
+                      float3 eyePosW, float morphStart, float morphEnd, float approxHeight)
+{
+    float2 posXZ = chunkOrigin + gridPos * chunkSize;
+    float eyeDist = distance(float3(posXZ.x, approxHeight, posXZ.y), eyePosW);
+
+    float morphK = TerrainMorphFactor(eyeDist, morphStart, morphEnd);
+    return chunkOrigin + MorphTerrainVertex(gridPos, resolution, morphK) * chunkSize;
+}
@@ -0,0 +1,294 @@
+#include "TerrainQuadtree.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cassert>
+
+TerrainQuadtree::TerrainQuadtree(const TerrainSettings& settings, HeightFunction heightFunc)
+	: mSettings(settings), mHeightFunc(move(heightFunc))
+{
+	assert(mSettings.ChunkResolution >= 2 && (mSettings.ChunkResolution & 1) == 0);
+	assert(mSettings.WorldSize >= mSettings.LeafSize);
+
+	mLevelCount = 1;
+	while (mSettings.LeafSize * (1 << (mLevelCount - 1)) < mSettings.WorldSize)
+	{
+		++mLevelCount;
+	}
+
+	// Round the world up to a whole quadtree of leaves.
+	mSettings.WorldSize = mSettings.LeafSize * (1 << (mLevelCount - 1));
+
+	int nodeCount = 0;
+	for (int level = 0; level < mLevelCount; ++level)
+	{
+		nodeCount += 1 << (2 * level);
+	}
+
+	mNodes.resize(nodeCount);
+	mLevelErrors.assign(mLevelCount, 0.0f);
+	mLevelRanges.assign(mLevelCount, 0.0f);
+
+	float halfSize = 0.5f * mSettings.WorldSize;
+	int nextFreeNode = 1;
+	BuildNode(0, -halfSize, -halfSize, mSettings.WorldSize, mLevelCount - 1, nextFreeNode);
+
+	for (const auto& node : mNodes)
+	{
+		mLevelErrors[node.Level] = max(mLevelErrors[node.Level], MeasureNodeError(node));
+	}
+}
+
+TerrainQuadtree::~TerrainQuadtree()
+{
+}
+
+void TerrainQuadtree::BuildNode(int nodeIndex, float x, float z, float size, int level, int& nextFreeNode)
+{
+	Node& node = mNodes[nodeIndex];
+	node.Origin = XMFLOAT2(x, z);
+	node.Size = size;
+	node.Level = level;
+	node.FirstChild = -1;
+
+	if (level == 0)
+	{
+		const int n = mSettings.ChunkResolution;
+		const float step = size / n;
+
+		node.MinY = FLT_MAX;
+		node.MaxY = -FLT_MAX;
+
+		for (int i = 0; i <= n; ++i)
+		{
+			for (int j = 0; j <= n; ++j)
+			{
+				float y = mHeightFunc(x + j * step, z + i * step);
+				node.MinY = min(node.MinY, y);
+				node.MaxY = max(node.MaxY, y);
+			}
+		}
+		return;
+	}
+
+	node.FirstChild = nextFreeNode;
+	nextFreeNode += 4;
+
+	float half = 0.5f * size;
+	for (int q = 0; q < 4; ++q)
+	{
+		BuildNode(node.FirstChild + q, x + (q & 1) * half, z + (q >> 1) * half, half, level - 1, nextFreeNode);
+	}
+
+	node.MinY = FLT_MAX;
+	node.MaxY = -FLT_MAX;
+	for (int q = 0; q < 4; ++q)
+	{
+		const Node& child = mNodes[node.FirstChild + q];
+		node.MinY = min(node.MinY, child.MinY);
+		node.MaxY = max(node.MaxY, child.MaxY);
+	}
+}
+
+// Largest height error made by drawing the node with its own grid instead of one twice as dense:
+// every vertex the finer grid adds is compared against the coarse grid's interpolation.
+float TerrainQuadtree::MeasureNodeError(const Node& node) const
+{
+	const int n = mSettings.ChunkResolution;
+	const float step = node.Size / n;
+	const float halfStep = 0.5f * step;
+
+	float error = 0.0f;
+
+	for (int i = 0; i < n; ++i)
+	{
+		float z = node.Origin.y + i * step;
+		for (int j = 0; j < n; ++j)
+		{
+			float x = node.Origin.x + j * step;
+
+			float h00 = mHeightFunc(x, z);
+			float h01 = mHeightFunc(x + step, z);
+			float h10 = mHeightFunc(x, z + step);
+
+			error = max(error, fabsf(mHeightFunc(x + halfStep, z) - 0.5f * (h00 + h01)));
+			error = max(error, fabsf(mHeightFunc(x, z + halfStep) - 0.5f * (h00 + h10)));
+			error = max(error, fabsf(mHeightFunc(x + halfStep, z + halfStep) - 0.5f * (h01 + h10)));
+		}
+	}
+
+	return error;
+}
+
+// Turns the per level geometric errors into view distances. A level may be used while its error,
+// projected at that distance, stays under MaxScreenError; each range is also kept at least twice the
+// previous one so a node's neighbours never differ by more than one level.
+void TerrainQuadtree::UpdateLevelRanges(float screenScale)
+{
+	mScreenScale = screenScale;
+
+	float prevRange = mSettings.LeafSize;
+	for (int level = 0; level < mLevelCount; ++level)
+	{
+		float range = mLevelErrors[level] * screenScale / mSettings.MaxScreenError;
+		range = max(range, 2.0f * prevRange);
+
+		mLevelRanges[level] = range;
+		prevRange = range;
+	}
+}
+
+GeometryGenerator::MeshData TerrainQuadtree::BuildChunkMesh() const
+{
+	const int n = mSettings.ChunkResolution;
+	const int half = n / 2;
+	const float step = 1.0f / n;
+
+	GeometryGenerator::MeshData meshData;
+	meshData.Vertices.resize((n + 1) * (n + 1));
+
+	for (int i = 0; i <= n; ++i)
+	{
+		for (int j = 0; j <= n; ++j)
+		{
+			auto& v = meshData.Vertices[i * (n + 1) + j];
+			v.Position = XMFLOAT3(j * step, 0.0f, i * step);
+			v.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			v.TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+			v.TexC = XMFLOAT2(j * step, 1.0f - i * step);
+		}
+	}
+
+	meshData.Indices32.reserve(n * n * 6);
+
+	for (int q = 0; q < 4; ++q)
+	{
+		int rowBegin = (q >> 1) * half;
+		int colBegin = (q & 1) * half;
+
+		for (int i = rowBegin; i < rowBegin + half; ++i)
+		{
+			for (int j = colBegin; j < colBegin + half; ++j)
+			{
+				GeometryGenerator::uint32 a = i * (n + 1) + j;
+				GeometryGenerator::uint32 b = a + 1;
+				GeometryGenerator::uint32 c = a + (n + 1);
+				GeometryGenerator::uint32 d = c + 1;
+
+				meshData.Indices32.push_back(a);
+				meshData.Indices32.push_back(c);
+				meshData.Indices32.push_back(b);
+
+				meshData.Indices32.push_back(b);
+				meshData.Indices32.push_back(c);
+				meshData.Indices32.push_back(d);
+			}
+		}
+	}
+
+	return meshData;
+}
+
+uint32_t TerrainQuadtree::QuadrantIndexCount() const
+{
+	uint32_t half = mSettings.ChunkResolution / 2;
+	return half * half * 6;
+}
+
+void TerrainQuadtree::Select(const XMFLOAT3& eyePos, CXMMATRIX view, CXMMATRIX proj, float viewportHeight, vector<TerrainChunk>& chunks)
+{
+	// proj(1, 1) is 1 / tan(fovY / 2), so this converts a world space error at unit distance to pixels.
+	float screenScale = 0.5f * viewportHeight * XMVectorGetY(proj.r[1]);
+	if (screenScale != mScreenScale)
+	{
+		UpdateLevelRanges(screenScale);
+	}
+
+	mEyePos = eyePos;
+
+	auto detView = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&detView, view);
+
+	BoundingFrustum viewFrustum;
+	BoundingFrustum::CreateFromMatrix(viewFrustum, proj);
+	viewFrustum.Transform(mWorldFrustum, invView);
+
+	chunks.clear();
+	SelectNode(0, false, chunks);
+}
+
+// Returns false when the node is too far away for its level, in which case the parent covers its area.
+bool TerrainQuadtree::SelectNode(int nodeIndex, bool parentFullyVisible, vector<TerrainChunk>& chunks)
+{
+	const Node& node = mNodes[nodeIndex];
+	float distSq = DistanceSqToNode(node);
+
+	// The root has no parent to fall back on, so it is never out of range.
+	if (nodeIndex != 0 && distSq > mLevelRanges[node.Level] * mLevelRanges[node.Level])
+	{
+		return false;
+	}
+
+	ContainmentType visibility = parentFullyVisible ? CONTAINS : mWorldFrustum.Contains(NodeBounds(node));
+	if (visibility == DISJOINT)
+	{
+		return true;
+	}
+
+	if (node.Level == 0 || distSq > mLevelRanges[node.Level - 1] * mLevelRanges[node.Level - 1])
+	{
+		AddChunk(node, -1, chunks);
+		return true;
+	}
+
+	bool fullyVisible = visibility == CONTAINS;
+
+	for (int q = 0; q < 4; ++q)
+	{
+		if (!SelectNode(node.FirstChild + q, fullyVisible, chunks))
+		{
+			const Node& child = mNodes[node.FirstChild + q];
+			if (fullyVisible || mWorldFrustum.Contains(NodeBounds(child)) != DISJOINT)
+			{
+				AddChunk(node, q, chunks);
+			}
+		}
+	}
+
+	return true;
+}
+
+void TerrainQuadtree::AddChunk(const Node& node, int quadrant, vector<TerrainChunk>& chunks) const
+{
+	float morphEnd = mLevelRanges[node.Level];
+	float prevRange = node.Level > 0 ? mLevelRanges[node.Level - 1] : 0.0f;
+
+	TerrainChunk chunk;
+	chunk.Origin = node.Origin;
+	chunk.Size = node.Size;
+	chunk.Level = node.Level;
+	chunk.Quadrant = quadrant;
+	chunk.MorphEnd = morphEnd;
+	chunk.MorphStart = morphEnd - (morphEnd - prevRange) * mSettings.MorphRatio;
+	chunk.Bounds = NodeBounds(quadrant < 0 ? node : mNodes[node.FirstChild + quadrant]);
+
+	chunks.push_back(chunk);
+}
+
+BoundingBox TerrainQuadtree::NodeBounds(const Node& node) const
+{
+	float half = 0.5f * node.Size;
+
+	return BoundingBox(
+		XMFLOAT3(node.Origin.x + half, 0.5f * (node.MinY + node.MaxY), node.Origin.y + half),
+		XMFLOAT3(half, 0.5f * (node.MaxY - node.MinY), half));
+}
+
+float TerrainQuadtree::DistanceSqToNode(const Node& node) const
+{
+	float dx = max(0.0f, max(node.Origin.x - mEyePos.x, mEyePos.x - (node.Origin.x + node.Size)));
+	float dy = max(0.0f, max(node.MinY - mEyePos.y, mEyePos.y - node.MaxY));
+	float dz = max(0.0f, max(node.Origin.y - mEyePos.z, mEyePos.z - (node.Origin.y + node.Size)));
+
+	return dx * dx + dy * dy + dz * dz;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "GeometryGenerator.h"
+
+using namespace std;
+using namespace DirectX;
+
+struct TerrainSettings
+{
+	// World extent of the root node, centered on the origin.
+	float WorldSize = 1024.0f;
+	float LeafSize = 32.0f;
+
+	// Quads per chunk edge. Every node, whatever its level, is drawn with the same grid.
+	int ChunkResolution = 32;
+
+	// Largest allowed projected geometric error in pixels.
+	float MaxScreenError = 2.0f;
+
+	// Fraction of each LOD range, measured from its far end, over which vertices morph into the next level.
+	float MorphRatio = 0.3f;
+};
+
+struct TerrainChunk
+{
+	// World space x and z of the node's minimum corner and its edge length.
+	XMFLOAT2 Origin = { 0.0f, 0.0f };
+	float Size = 0.0f;
+
+	// 0 is the finest level.
+	int Level = 0;
+
+	// -1 draws the whole chunk grid, 0..3 only one quadrant of it, see QuadrantIndexCount.
+	int Quadrant = -1;
+
+	float MorphStart = 0.0f;
+	float MorphEnd = 0.0f;
+
+	BoundingBox Bounds;
+};
+
+// Same layout as cbTerrainChunk in Terrain.hlsl.
+struct TerrainChunkConstants
+{
+	XMFLOAT2 ChunkOrigin = { 0.0f, 0.0f };
+	float ChunkSize = 0.0f;
+	float GridResolution = 0.0f;
+	float MorphStart = 0.0f;
+	float MorphEnd = 0.0f;
+	float TerrainSize = 0.0f;
+	float Pad = 0.0f;
+};
+
+// CDLOD terrain: the height field is split into a quadtree of chunks, each drawn with the same
+// grid mesh. Select picks a chunk set whose projected error stays under MaxScreenError; vertices
+// morph towards the next coarser level near the end of every LOD range so neighbours never crack.
+class TerrainQuadtree
+{
+public:
+	using HeightFunction = function<float(float, float)>;
+
+	TerrainQuadtree(const TerrainSettings& settings, HeightFunction heightFunc);
+	TerrainQuadtree(const TerrainQuadtree& rhs) = delete;
+	TerrainQuadtree& operator=(const TerrainQuadtree& rhs) = delete;
+	~TerrainQuadtree();
+
+	int LevelCount() const { return mLevelCount; }
+	int NodeCount() const { return (int)mNodes.size(); }
+	int ChunkResolution() const { return mSettings.ChunkResolution; }
+	float WorldSize() const { return mSettings.WorldSize; }
+
+	float LevelRange(int level) const { return mLevelRanges[level]; }
+	float LevelError(int level) const { return mLevelErrors[level]; }
+
+	// Unit grid in x and z with indices laid out quadrant by quadrant, so a whole chunk is the full
+	// index range and quadrant q is QuadrantIndexCount() indices starting at q * QuadrantIndexCount().
+	GeometryGenerator::MeshData BuildChunkMesh() const;
+	uint32_t QuadrantIndexCount() const;
+
+	void Select(const XMFLOAT3& eyePos, CXMMATRIX view, CXMMATRIX proj, float viewportHeight, vector<TerrainChunk>& chunks);
+
+private:
+	struct Node
+	{
+		XMFLOAT2 Origin;
+		float Size;
+		float MinY;
+		float MaxY;
+		int Level;
+		int FirstChild;
+	};
+
+	void BuildNode(int nodeIndex, float x, float z, float size, int level, int& nextFreeNode);
+	float MeasureNodeError(const Node& node) const;
+	void UpdateLevelRanges(float screenScale);
+
+	bool SelectNode(int nodeIndex, bool parentFullyVisible, vector<TerrainChunk>& chunks);
+	void AddChunk(const Node& node, int quadrant, vector<TerrainChunk>& chunks) const;
+
+	BoundingBox NodeBounds(const Node& node) const;
+	float DistanceSqToNode(const Node& node) const;
+
+private:
+	TerrainSettings mSettings;
+	HeightFunction mHeightFunc;
+
+	int mLevelCount = 0;
+	vector<Node> mNodes;
+
+	vector<float> mLevelErrors;
+	vector<float> mLevelRanges;
+	float mScreenScale = 0.0f;
+
+	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
+	BoundingFrustum mWorldFrustum;
+};
@@ -0,0 +1,251 @@
+#include "TessellationPlanner.h"
+#include <ppl.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cassert>
+
+TessellationPlanner::TessellationPlanner(const TessellationPlannerSettings& settings, HeightFunction heightFunc)
+	: mSettings(settings), mHeightFunc(move(heightFunc))
+{
+	assert(mSettings.PatchesX > 0 && mSettings.PatchesZ > 0);
+
+	const int patchesX = mSettings.PatchesX;
+	const int patchesZ = mSettings.PatchesZ;
+
+	mPatchSize = XMFLOAT2(
+		(mSettings.Max.x - mSettings.Min.x) / patchesX,
+		(mSettings.Max.y - mSettings.Min.y) / patchesZ);
+
+	mVerticalEdgeCount = (patchesX + 1) * patchesZ;
+	const int edgeCount = mVerticalEdgeCount + patchesX * (patchesZ + 1);
+
+	mEdgeMidpoints.resize(edgeCount);
+	mEdgeLengths.resize(edgeCount);
+	mEdgeFactors.resize(edgeCount);
+
+	auto setEdge = [&](int edge, const XMFLOAT3& a, const XMFLOAT3& b)
+		{
+			float mx = 0.5f * (a.x + b.x);
+			float mz = 0.5f * (a.z + b.z);
+			mEdgeMidpoints[edge] = XMFLOAT3(mx, mHeightFunc(mx, mz), mz);
+			mEdgeLengths[edge] = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&b), XMLoadFloat3(&a))));
+		};
+
+	for (int row = 0; row < patchesZ; ++row)
+	{
+		for (int column = 0; column <= patchesX; ++column)
+		{
+			setEdge(VerticalEdge(column, row), GridPoint(column, row), GridPoint(column, row + 1));
+		}
+	}
+
+	for (int row = 0; row <= patchesZ; ++row)
+	{
+		for (int column = 0; column < patchesX; ++column)
+		{
+			setEdge(HorizontalEdge(column, row), GridPoint(column, row), GridPoint(column + 1, row));
+		}
+	}
+
+	// Heights are sampled on a small grid per patch and padded, the surface is smooth between samples.
+	const int samples = 9;
+	mPatchBounds.resize(patchesX * patchesZ);
+
+	concurrency::parallel_for(0, patchesX * patchesZ, [&](int patch)
+		{
+			float x0 = mSettings.Min.x + (patch % patchesX) * mPatchSize.x;
+			float z0 = mSettings.Min.y + (patch / patchesX) * mPatchSize.y;
+
+			float minY = FLT_MAX;
+			float maxY = -FLT_MAX;
+			for (int i = 0; i < samples; ++i)
+			{
+				for (int j = 0; j < samples; ++j)
+				{
+					float y = mHeightFunc(x0 + mPatchSize.x * j / (samples - 1), z0 + mPatchSize.y * i / (samples - 1));
+					minY = min(minY, y);
+					maxY = max(maxY, y);
+				}
+			}
+
+			float pad = 0.1f * (maxY - minY) + 0.01f * max(mPatchSize.x, mPatchSize.y);
+
+			mPatchBounds[patch] = BoundingBox(
+				XMFLOAT3(x0 + 0.5f * mPatchSize.x, 0.5f * (minY + maxY), z0 + 0.5f * mPatchSize.y),
+				XMFLOAT3(0.5f * mPatchSize.x, 0.5f * (maxY - minY) + pad, 0.5f * mPatchSize.y));
+		});
+}
+
+TessellationPlanner::~TessellationPlanner()
+{
+}
+
+XMFLOAT3 TessellationPlanner::GridPoint(int column, int row) const
+{
+	float x = mSettings.Min.x + column * mPatchSize.x;
+	float z = mSettings.Min.y + row * mPatchSize.y;
+	return XMFLOAT3(x, mHeightFunc(x, z), z);
+}
+
+vector<XMFLOAT3> TessellationPlanner::BuildPatchVertices() const
+{
+	vector<XMFLOAT3> vertices;
+	vertices.reserve(PatchCount() * 4);
+
+	for (int row = 0; row < mSettings.PatchesZ; ++row)
+	{
+		for (int column = 0; column < mSettings.PatchesX; ++column)
+		{
+			float x0 = mSettings.Min.x + column * mPatchSize.x;
+			float z0 = mSettings.Min.y + row * mPatchSize.y;
+			float x1 = x0 + mPatchSize.x;
+			float z1 = z0 + mPatchSize.y;
+
+			// The domain shader computes the height itself.
+			vertices.push_back(XMFLOAT3(x0, 0.0f, z1));
+			vertices.push_back(XMFLOAT3(x1, 0.0f, z1));
+			vertices.push_back(XMFLOAT3(x0, 0.0f, z0));
+			vertices.push_back(XMFLOAT3(x1, 0.0f, z0));
+		}
+	}
+
+	return vertices;
+}
+
+TessellationReport TessellationPlanner::Plan(const XMFLOAT3& eyePos, CXMMATRIX view, CXMMATRIX proj, float viewportHeight,
+	vector<int>& visiblePatches, vector<PatchTessFactors>& factors)
+{
+	auto detView = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&detView, view);
+
+	BoundingFrustum viewFrustum;
+	BoundingFrustum worldFrustum;
+	BoundingFrustum::CreateFromMatrix(viewFrustum, proj);
+	viewFrustum.Transform(worldFrustum, invView);
+
+	visiblePatches.clear();
+	for (int patch = 0; patch < PatchCount(); ++patch)
+	{
+		if (worldFrustum.Contains(mPatchBounds[patch]) != DISJOINT)
+		{
+			visiblePatches.push_back(patch);
+		}
+	}
+
+	XMFLOAT4X4 p;
+	XMStoreFloat4x4(&p, proj);
+	ComputeEdgeFactors(eyePos, 0.5f * viewportHeight * p._22);
+
+	TessellationReport report;
+	report.VisiblePatches = (int)visiblePatches.size();
+	report.CulledPatches = PatchCount() - report.VisiblePatches;
+	report.UnclampedTriangles = BuildPatchFactors(1.0f, visiblePatches, factors);
+	report.EstimatedTriangles = report.UnclampedTriangles;
+
+	const uint64_t budget = mSettings.TriangleBudget;
+	if (budget == 0 || report.UnclampedTriangles <= budget)
+	{
+		return report;
+	}
+
+	// The count only grows with the scale, so search for the largest scale that fits.
+	float lo = 0.0f;
+	float hi = 1.0f;
+	for (int i = 0; i < 12; ++i)
+	{
+		float mid = 0.5f * (lo + hi);
+		if (BuildPatchFactors(mid, visiblePatches, factors) <= budget)
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	report.BudgetScale = lo;
+	report.EstimatedTriangles = BuildPatchFactors(lo, visiblePatches, factors);
+
+	return report;
+}
+
+void TessellationPlanner::ComputeEdgeFactors(const XMFLOAT3& eyePos, float pixelsPerUnit)
+{
+	const float farDistSq = mSettings.FarDistance * mSettings.FarDistance;
+	XMVECTOR eye = XMLoadFloat3(&eyePos);
+
+	concurrency::parallel_for(0, (int)mEdgeFactors.size(), [&](int edge)
+		{
+			float distSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&mEdgeMidpoints[edge]), eye)));
+			if (distSq > farDistSq)
+			{
+				mEdgeFactors[edge] = 0.0f;
+				return;
+			}
+
+			// Projected size of the sphere around the edge, which does not depend on the view direction
+			// and so is the same for both patches sharing the edge.
+			float pixels = mEdgeLengths[edge] * pixelsPerUnit / max(sqrtf(distSq), 1e-3f);
+			mEdgeFactors[edge] = pixels / mSettings.TargetEdgePixels;
+		});
+}
+
+uint64_t TessellationPlanner::BuildPatchFactors(float scale, const vector<int>& patches, vector<PatchTessFactors>& factors) const
+{
+	const float maxFactor = mSettings.MaxTessFactor;
+
+	auto edgeFactor = [&](int edge)
+		{
+			return min(max(ceilf(mEdgeFactors[edge] * scale), 1.0f), maxFactor);
+		};
+
+	factors.resize(patches.size());
+
+	uint64_t triangles = 0;
+	for (size_t k = 0; k < patches.size(); ++k)
+	{
+		int column = patches[k] % mSettings.PatchesX;
+		int row = patches[k] / mSettings.PatchesX;
+
+		// Quad domain order: u == 0, v == 0, u == 1, v == 1, where u runs along +x and v along -z.
+		PatchTessFactors& f = factors[k];
+		f.EdgeTess[0] = edgeFactor(VerticalEdge(column, row));
+		f.EdgeTess[1] = edgeFactor(HorizontalEdge(column, row + 1));
+		f.EdgeTess[2] = edgeFactor(VerticalEdge(column + 1, row));
+		f.EdgeTess[3] = edgeFactor(HorizontalEdge(column, row));
+		f.InsideTess[0] = max(f.EdgeTess[1], f.EdgeTess[3]);
+		f.InsideTess[1] = max(f.EdgeTess[0], f.EdgeTess[2]);
+
+		triangles += EstimateTriangles(f);
+	}
+
+	return triangles;
+}
+
+uint64_t TessellationPlanner::EstimateTriangles(const PatchTessFactors& factors)
+{
+	const uint64_t insideU = (uint64_t)factors.InsideTess[0];
+	const uint64_t insideV = (uint64_t)factors.InsideTess[1];
+
+	if (insideU <= 1 && insideV <= 1 &&
+		factors.EdgeTess[0] <= 1.0f && factors.EdgeTess[1] <= 1.0f &&
+		factors.EdgeTess[2] <= 1.0f && factors.EdgeTess[3] <= 1.0f)
+	{
+		return 2;
+	}
+
+	// A regular interior grid one ring in from the border, plus a transition ring that stitches each
+	// outer edge to the matching inner edge.
+	const uint64_t innerU = insideU > 2 ? insideU - 2 : 0;
+	const uint64_t innerV = insideV > 2 ? insideV - 2 : 0;
+
+	uint64_t triangles = 2 * innerU * innerV;
+	triangles += (uint64_t)factors.EdgeTess[0] + innerV;
+	triangles += (uint64_t)factors.EdgeTess[2] + innerV;
+	triangles += (uint64_t)factors.EdgeTess[1] + innerU;
+	triangles += (uint64_t)factors.EdgeTess[3] + innerU;
+
+	return triangles;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+using namespace std;
+using namespace DirectX;
+
+struct TessellationPlannerSettings
+{
+	// World space x and z extent of the land, split into PatchesX by PatchesZ quad patches.
+	XMFLOAT2 Min = { -160.0f, -160.0f };
+	XMFLOAT2 Max = { 160.0f, 160.0f };
+	int PatchesX = 16;
+	int PatchesZ = 16;
+
+	// Desired projected length of one tessellated edge segment in pixels.
+	float TargetEdgePixels = 16.0f;
+
+	// Edges farther than this are never subdivided.
+	float FarDistance = 400.0f;
+
+	// Matches maxtessfactor in LandTessellation.hlsl.
+	float MaxTessFactor = 64.0f;
+
+	// Upper bound for the estimated triangle count of the visible patches, 0 for none.
+	uint32_t TriangleBudget = 0;
+};
+
+// Same layout as PatchTess in LandTessellation.hlsl.
+struct PatchTessFactors
+{
+	float EdgeTess[4];
+	float InsideTess[2];
+};
+
+struct TessellationReport
+{
+	int VisiblePatches = 0;
+	int CulledPatches = 0;
+
+	// Estimate for integer partitioning, after the budget was applied.
+	uint64_t EstimatedTriangles = 0;
+	uint64_t UnclampedTriangles = 0;
+
+	// Factor applied to every edge to meet the budget, 1 when it was not needed.
+	float BudgetScale = 1.0f;
+};
+
+// Plans the tessellation of a grid of land patches on the CPU. Factors are computed per edge from
+// its projected length and shared by both patches that touch it, so neighbours always agree and
+// the surface never cracks. Patches outside the frustum are dropped before submission, and when
+// the estimated triangle count is over budget all factors are scaled down together.
+class TessellationPlanner
+{
+public:
+	using HeightFunction = function<float(float, float)>;
+
+	TessellationPlanner(const TessellationPlannerSettings& settings, HeightFunction heightFunc);
+	TessellationPlanner(const TessellationPlanner& rhs) = delete;
+	TessellationPlanner& operator=(const TessellationPlanner& rhs) = delete;
+	~TessellationPlanner();
+
+	int PatchCount() const { return mSettings.PatchesX * mSettings.PatchesZ; }
+	const BoundingBox& PatchBounds(int patch) const { return mPatchBounds[patch]; }
+
+	void SetTriangleBudget(uint32_t budget) { mSettings.TriangleBudget = budget; }
+
+	// Four control points per patch in the order LandTessellation.hlsl expects: (-x, +z), (+x, +z), (-x, -z), (+x, -z).
+	vector<XMFLOAT3> BuildPatchVertices() const;
+
+	// Fills visiblePatches and factors with one entry per patch that survives culling, in patch order.
+	TessellationReport Plan(const XMFLOAT3& eyePos, CXMMATRIX view, CXMMATRIX proj, float viewportHeight,
+		vector<int>& visiblePatches, vector<PatchTessFactors>& factors);
+
+	// Triangle count of one quad patch with integer partitioning.
+	static uint64_t EstimateTriangles(const PatchTessFactors& factors);
+
+private:
+	void ComputeEdgeFactors(const XMFLOAT3& eyePos, float pixelsPerUnit);
+	uint64_t BuildPatchFactors(float scale, const vector<int>& patches, vector<PatchTessFactors>& factors) const;
+
+	int VerticalEdge(int column, int row) const { return row * (mSettings.PatchesX + 1) + column; }
+	int HorizontalEdge(int column, int row) const { return mVerticalEdgeCount + row * mSettings.PatchesX + column; }
+
+	XMFLOAT3 GridPoint(int column, int row) const;
+
+private:
+	TessellationPlannerSettings mSettings;
+	HeightFunction mHeightFunc;
+
+	XMFLOAT2 mPatchSize;
+	int mVerticalEdgeCount = 0;
+
+	vector<BoundingBox> mPatchBounds;
+
+	// Per edge, vertical edges (constant x) first, then horizontal edges (constant z).
+	vector<XMFLOAT3> mEdgeMidpoints;
+	vector<float> mEdgeLengths;
+	vector<float> mEdgeFactors;
+};
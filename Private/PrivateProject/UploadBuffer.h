@@ -48,6 +48,11 @@ public:
 		return mUploadBuffer.Get();
 	}
 
+	BYTE* MappedData() const
+	{
+		return mMappedData;
+	}
+
 	void CopyData(int elementIndex, const T& data)
 	{
 		memcpy(&mMappedData[elementIndex * mElementByteSize], &data, sizeof(T));
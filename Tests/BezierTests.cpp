@@ -0,0 +1,226 @@
+#include "Test.h"
+#include "../Chapter14/BezierPatch/BezierTessellator.h"
+#include <cmath>
+
+namespace
+{
+	// The patch BezierApp draws.
+	const array<XMFLOAT3, 16> ControlPoints =
+	{
+		XMFLOAT3(-10.0f, -10.0f, +15.0f),
+		XMFLOAT3(-5.0f,  0.0f, +15.0f),
+		XMFLOAT3(+5.0f,  0.0f, +15.0f),
+		XMFLOAT3(+10.0f, 0.0f, +15.0f),
+
+		XMFLOAT3(-15.0f, 0.0f, +5.0f),
+		XMFLOAT3(-5.0f,  0.0f, +5.0f),
+		XMFLOAT3(+5.0f,  20.0f, +5.0f),
+		XMFLOAT3(+15.0f, 0.0f, +5.0f),
+
+		XMFLOAT3(-15.0f, 0.0f, -5.0f),
+		XMFLOAT3(-5.0f,  0.0f, -5.0f),
+		XMFLOAT3(+5.0f,  0.0f, -5.0f),
+		XMFLOAT3(+15.0f, 0.0f, -5.0f),
+
+		XMFLOAT3(-10.0f, 10.0f, -15.0f),
+		XMFLOAT3(-5.0f,  0.0f, -15.0f),
+		XMFLOAT3(+5.0f,  0.0f, -15.0f),
+		XMFLOAT3(+25.0f, 10.0f, -15.0f)
+	};
+
+	// Positions are compared against a patch about 40 units across.
+	const double PositionTolerance = 1e-4;
+	const double DirectionTolerance = 1e-5;
+
+	struct Double3
+	{
+		double X = 0.0;
+		double Y = 0.0;
+		double Z = 0.0;
+	};
+
+	Double3 Normalized(const Double3& a)
+	{
+		double length = sqrt(a.X * a.X + a.Y * a.Y + a.Z * a.Z);
+		return { a.X / length, a.Y / length, a.Z / length };
+	}
+
+	double Distance(const Double3& a, const XMFLOAT3& b)
+	{
+		double dx = a.X - b.x;
+		double dy = a.Y - b.y;
+		double dz = a.Z - b.z;
+		return sqrt(dx * dx + dy * dy + dz * dz);
+	}
+
+	// Double precision ports of BezierUtil.hlsl.
+	void BernsteinBasis(double t, double basis[4])
+	{
+		double invT = 1.0 - t;
+		basis[0] = invT * invT * invT;
+		basis[1] = 3.0 * t * invT * invT;
+		basis[2] = 3.0 * t * t * invT;
+		basis[3] = t * t * t;
+	}
+
+	void dBernsteinBasis(double t, double basis[4])
+	{
+		double invT = 1.0 - t;
+		basis[0] = -3.0 * invT * invT;
+		basis[1] = 3.0 * invT * invT - 6.0 * t * invT;
+		basis[2] = 6.0 * t * invT - 3.0 * t * t;
+		basis[3] = 3.0 * t * t;
+	}
+
+	Double3 CubicBezierSum(const double basisU[4], const double basisV[4])
+	{
+		Double3 sum;
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				const XMFLOAT3& p = ControlPoints[r * 4 + c];
+				double w = basisV[r] * basisU[c];
+				sum.X += w * p.x;
+				sum.Y += w * p.y;
+				sum.Z += w * p.z;
+			}
+		}
+		return sum;
+	}
+
+	struct Reference
+	{
+		Double3 Position;
+		Double3 Normal;
+		Double3 Tangent;
+	};
+
+	Reference Evaluate(double u, double v)
+	{
+		double basisU[4], basisV[4], dBasisU[4], dBasisV[4];
+		BernsteinBasis(u, basisU);
+		BernsteinBasis(v, basisV);
+		dBernsteinBasis(u, dBasisU);
+		dBernsteinBasis(v, dBasisV);
+
+		Double3 du = CubicBezierSum(dBasisU, basisV);
+		Double3 dv = CubicBezierSum(basisU, dBasisV);
+
+		Reference reference;
+		reference.Position = CubicBezierSum(basisU, basisV);
+		reference.Normal = Normalized({ du.Y * dv.Z - du.Z * dv.Y, du.Z * dv.X - du.X * dv.Z, du.X * dv.Y - du.Y * dv.X });
+		reference.Tangent = Normalized(du);
+		return reference;
+	}
+
+	vector<XMFLOAT2> Samples(int n)
+	{
+		vector<XMFLOAT2> uv;
+		for (int i = 0; i <= n; ++i)
+		{
+			for (int j = 0; j <= n; ++j)
+			{
+				uv.push_back(XMFLOAT2((float)j / n, (float)i / n));
+			}
+		}
+		return uv;
+	}
+}
+
+TEST(BezierBasisMatchesHlsl)
+{
+	for (int i = 0; i <= 64; ++i)
+	{
+		float t = i / 64.0f;
+
+		double basis[4], dBasis[4];
+		BernsteinBasis(t, basis);
+		dBernsteinBasis(t, dBasis);
+
+		XMFLOAT4 b = BezierTessellator::BernsteinBasis(t);
+		XMFLOAT4 d = BezierTessellator::dBernsteinBasis(t);
+		CHECK(fabs(b.x - basis[0]) < 1e-6 && fabs(b.y - basis[1]) < 1e-6 && fabs(b.z - basis[2]) < 1e-6 && fabs(b.w - basis[3]) < 1e-6);
+		CHECK(fabs(d.x - dBasis[0]) < 1e-5 && fabs(d.y - dBasis[1]) < 1e-5 && fabs(d.z - dBasis[2]) < 1e-5 && fabs(d.w - dBasis[3]) < 1e-5);
+	}
+}
+
+TEST(BezierScalarEvaluateMatchesHlsl)
+{
+	BezierTessellator tessellator(ControlPoints);
+
+	double error = 0.0;
+	for (const XMFLOAT2& uv : Samples(32))
+	{
+		error = max(error, Distance(Evaluate(uv.x, uv.y).Position, tessellator.Evaluate(uv.x, uv.y)));
+	}
+	CHECK(error < PositionTolerance);
+}
+
+TEST(BezierBatchEvaluateMatchesHlsl)
+{
+	BezierTessellator tessellator(ControlPoints);
+
+	// An odd count so the last batch of four is partial.
+	vector<XMFLOAT2> uv = Samples(32);
+	uv.pop_back();
+
+	vector<XMFLOAT3> positions(uv.size());
+	vector<XMFLOAT3> normals(uv.size());
+	vector<XMFLOAT3> tangents(uv.size());
+	tessellator.Evaluate(uv.data(), uv.size(), positions.data(), normals.data(), tangents.data());
+
+	double positionError = 0.0;
+	double normalError = 0.0;
+	double tangentError = 0.0;
+	for (size_t i = 0; i < uv.size(); ++i)
+	{
+		Reference reference = Evaluate(uv[i].x, uv[i].y);
+		positionError = max(positionError, Distance(reference.Position, positions[i]));
+		normalError = max(normalError, Distance(reference.Normal, normals[i]));
+		tangentError = max(tangentError, Distance(reference.Tangent, tangents[i]));
+	}
+	CHECK(positionError < PositionTolerance);
+	CHECK(normalError < DirectionTolerance);
+	CHECK(tangentError < DirectionTolerance);
+}
+
+TEST(BezierTessellationIsTheEvaluatedGrid)
+{
+	BezierTessellator tessellator(ControlPoints);
+
+	BezierLod lod;
+	lod.LevelU = 3;
+	lod.LevelV = 2;
+	const GeometryGenerator::MeshData& mesh = tessellator.GetTessellation(lod);
+
+	const int columns = (1 << lod.LevelU) + 1;
+	const int rows = (1 << lod.LevelV) + 1;
+	CHECK(mesh.Vertices.size() == (size_t)(columns * rows));
+	CHECK(mesh.Indices32.size() == (size_t)((columns - 1) * (rows - 1) * 6));
+
+	double error = 0.0;
+	for (const GeometryGenerator::Vertex& vertex : mesh.Vertices)
+	{
+		error = max(error, Distance(Evaluate(vertex.TexC.x, vertex.TexC.y).Position, vertex.Position));
+	}
+	CHECK(error < PositionTolerance);
+}
+
+TEST(BezierErrorShrinksWithLevel)
+{
+	BezierTessellator tessellator(ControlPoints);
+
+	for (int level = 1; level <= BezierTessellator::MaxLevel; ++level)
+	{
+		BezierLod coarse;
+		coarse.LevelU = level - 1;
+		coarse.LevelV = level - 1;
+
+		BezierLod fine;
+		fine.LevelU = level;
+		fine.LevelV = level;
+
+		CHECK(tessellator.Error(fine) <= tessellator.Error(coarse));
+	}
+}
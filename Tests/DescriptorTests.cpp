@@ -0,0 +1,65 @@
+#include "Test.h"
+#include "../Chapter20/Shadows/DescriptorAllocator.h"
+
+TEST(FreeListTakesFirstFit)
+{
+	DescriptorFreeList list(10, 100);
+
+	DescriptorRange a = list.Allocate(30);
+	DescriptorRange b = list.Allocate(20);
+	CHECK(a.Index == 10 && a.Count == 30);
+	CHECK(b.Index == 40 && b.Count == 20);
+	CHECK(list.FreeCount() == 50);
+
+	CHECK(!list.Allocate(51).IsValid());
+	CHECK(!list.Allocate(0).IsValid());
+}
+
+TEST(FreeListMergesNeighbours)
+{
+	DescriptorFreeList list(0, 64);
+
+	DescriptorRange a = list.Allocate(16);
+	DescriptorRange b = list.Allocate(16);
+	DescriptorRange c = list.Allocate(16);
+	CHECK(list.FreeCount() == 16);
+
+	// Freeing both sides of b and then b leaves one run of 64 again.
+	list.Free(a);
+	list.Free(c);
+	CHECK(!list.Allocate(48).IsValid());
+
+	list.Free(b);
+	CHECK(list.FreeCount() == 64);
+
+	DescriptorRange all = list.Allocate(64);
+	CHECK(all.Index == 0 && all.Count == 64);
+}
+
+TEST(RingSkipsTheTailInsteadOfWrapping)
+{
+	DescriptorRing ring(100, 10);
+
+	DescriptorRange a = ring.Allocate(6);
+	ring.EndFrame(1);
+	CHECK(a.Index == 100 && a.Count == 6);
+
+	// Only four slots are left before the end and ranges never wrap, so this waits for a retire.
+	CHECK(!ring.Allocate(5).IsValid());
+
+	ring.Retire(1);
+	CHECK(ring.UsedCount() == 0);
+
+	DescriptorRange b = ring.Allocate(3);
+	DescriptorRange c = ring.Allocate(3);
+	CHECK(b.Index == 106 && b.Count == 3);
+	CHECK(c.Index == 100 && c.Count == 3);
+
+	// The skipped slot counts as used until the frame retires.
+	CHECK(ring.UsedCount() == 7);
+	ring.EndFrame(2);
+	ring.Retire(1);
+	CHECK(ring.UsedCount() == 7);
+	ring.Retire(2);
+	CHECK(ring.UsedCount() == 0);
+}
@@ -0,0 +1,474 @@
+#include "Test.h"
+#include "../Chapter20/Shadows/DrawQueue.h"
+#include "../Chapter20/Shadows/JobSystem.h"
+#include <random>
+#include <numeric>
+
+namespace
+{
+	// Large enough for the blocked paths, which start at 4096 elements.
+	const int LargeCount = 50000;
+
+	JobSystem& Jobs()
+	{
+		JobSystem& jobs = JobSystem::GetInstance();
+		if (jobs.WorkerCount() == 0)
+		{
+			jobs.Initialize(4);
+		}
+		return jobs;
+	}
+
+	// Expected output of Compact, built with a plain serial loop.
+	struct ExpectedDraws
+	{
+		vector<UINT> Instances;
+		vector<UINT> RecordDraws;
+		vector<UINT> FirstInstances;
+		vector<UINT> InstanceCounts;
+	};
+
+	void BuildRandomDraws(int instanceCount, float visibleRatio, IndirectDrawBuilder& builder, ExpectedDraws& expected)
+	{
+		mt19937 random(7);
+		uniform_int_distribution<int> drawSize(0, 40);
+		bernoulli_distribution visible(visibleRatio);
+
+		builder.Clear();
+
+		UINT draw = 0;
+		for (int i = 0; i < instanceCount; ++draw)
+		{
+			builder.AddDraw(36 + draw, draw * 3, (INT)draw);
+
+			const UINT first = (UINT)expected.Instances.size();
+			const int size = min(drawSize(random), instanceCount - i);
+			for (int k = 0; k < size; ++k, ++i)
+			{
+				const bool v = visible(random);
+				builder.AddInstance((UINT)i, v);
+				if (v)
+				{
+					expected.Instances.push_back((UINT)i);
+				}
+			}
+
+			const UINT count = (UINT)expected.Instances.size() - first;
+			if (count > 0)
+			{
+				expected.RecordDraws.push_back(draw);
+				expected.FirstInstances.push_back(first);
+				expected.InstanceCounts.push_back(count);
+			}
+		}
+	}
+
+	// Stands in for a GPU buffer: MeshGeometry only asks it for its address, everything else fails.
+	class FakeBuffer : public ID3D12Resource
+	{
+	public:
+		explicit FakeBuffer(D3D12_GPU_VIRTUAL_ADDRESS address) : mAddress(address) {}
+
+		virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override { *object = nullptr; return E_NOINTERFACE; }
+		virtual ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+		virtual ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+		virtual HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return E_NOTIMPL; }
+		virtual HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return E_NOTIMPL; }
+		virtual HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return E_NOTIMPL; }
+		virtual HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override { return E_NOTIMPL; }
+		virtual HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override { *device = nullptr; return E_NOTIMPL; }
+
+		virtual HRESULT STDMETHODCALLTYPE Map(UINT, const D3D12_RANGE*, void** data) override { *data = nullptr; return E_NOTIMPL; }
+		virtual void STDMETHODCALLTYPE Unmap(UINT, const D3D12_RANGE*) override {}
+		virtual D3D12_RESOURCE_DESC STDMETHODCALLTYPE GetDesc() override { return {}; }
+		virtual D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE GetGPUVirtualAddress() override { return mAddress; }
+		virtual HRESULT STDMETHODCALLTYPE WriteToSubresource(UINT, const D3D12_BOX*, const void*, UINT, UINT) override { return E_NOTIMPL; }
+		virtual HRESULT STDMETHODCALLTYPE ReadFromSubresource(void*, UINT, UINT, UINT, const D3D12_BOX*) override { return E_NOTIMPL; }
+		virtual HRESULT STDMETHODCALLTYPE GetHeapProperties(D3D12_HEAP_PROPERTIES*, D3D12_HEAP_FLAGS*) override { return E_NOTIMPL; }
+
+	private:
+		D3D12_GPU_VIRTUAL_ADDRESS mAddress = 0;
+	};
+
+	// Records every command DrawQueue submits, with the state bound when each ExecuteIndirect was issued.
+	class RecordingCommandList : public DrawCommandList
+	{
+	public:
+		struct IndirectCall
+		{
+			ID3D12PipelineState* Pso = nullptr;
+			D3D12_GPU_VIRTUAL_ADDRESS VertexBuffer = 0;
+			D3D12_GPU_VIRTUAL_ADDRESS IndexBuffer = 0;
+			ID3D12CommandSignature* Signature = nullptr;
+			ID3D12Resource* Arguments = nullptr;
+			UINT CommandCount = 0;
+			UINT64 ArgumentOffset = 0;
+		};
+
+		virtual void SetPipelineState(ID3D12PipelineState* pso) override
+		{
+			mPso = pso;
+			PsoBinds.push_back(pso);
+			Commands.push_back('P');
+		}
+
+		virtual void IASetVertexBuffer(const D3D12_VERTEX_BUFFER_VIEW& view) override
+		{
+			mVertexBuffer = view.BufferLocation;
+			Commands.push_back('V');
+		}
+
+		virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view) override
+		{
+			mIndexBuffer = view.BufferLocation;
+			Commands.push_back('I');
+		}
+
+		virtual void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override
+		{
+			Commands.push_back('T');
+		}
+
+		virtual void ExecuteIndirect(ID3D12CommandSignature* signature, UINT commandCount, ID3D12Resource* arguments, UINT64 argumentOffset) override
+		{
+			IndirectCall call;
+			call.Pso = mPso;
+			call.VertexBuffer = mVertexBuffer;
+			call.IndexBuffer = mIndexBuffer;
+			call.Signature = signature;
+			call.Arguments = arguments;
+			call.CommandCount = commandCount;
+			call.ArgumentOffset = argumentOffset;
+			Calls.push_back(call);
+			Commands.push_back('E');
+		}
+
+		vector<ID3D12PipelineState*> PsoBinds;
+		vector<IndirectCall> Calls;
+		string Commands;
+
+	private:
+		ID3D12PipelineState* mPso = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS mVertexBuffer = 0;
+		D3D12_GPU_VIRTUAL_ADDRESS mIndexBuffer = 0;
+	};
+
+	void CheckCompact(int instanceCount, float visibleRatio)
+	{
+		Jobs();
+
+		IndirectDrawBuilder builder;
+		ExpectedDraws expected;
+		BuildRandomDraws(instanceCount, visibleRatio, builder, expected);
+		builder.Compact();
+
+		CHECK(builder.Instances() == expected.Instances);
+		CHECK(builder.RecordDraws() == expected.RecordDraws);
+		CHECK(builder.Records().size() == expected.RecordDraws.size());
+
+		for (size_t r = 0; r < builder.Records().size() && r < expected.RecordDraws.size(); ++r)
+		{
+			const IndirectDrawRecord& record = builder.Records()[r];
+			const UINT draw = expected.RecordDraws[r];
+			CHECK(record.FirstInstance == expected.FirstInstances[r]);
+			CHECK(record.Draw.InstanceCount == expected.InstanceCounts[r]);
+			CHECK(record.Draw.IndexCountPerInstance == 36 + draw);
+			CHECK(record.Draw.StartIndexLocation == draw * 3);
+			CHECK(record.Draw.BaseVertexLocation == (INT)draw);
+			CHECK(record.Draw.StartInstanceLocation == 0);
+		}
+	}
+
+	void CheckRadixSort(int count, uint64_t keyMask)
+	{
+		Jobs();
+
+		mt19937_64 random(11);
+		vector<uint64_t> keys(count);
+		vector<UINT> values(count);
+		for (int i = 0; i < count; ++i)
+		{
+			keys[i] = random() & keyMask;
+			values[i] = (UINT)i;
+		}
+
+		// Values are the original positions, so a stable sort orders equal keys by value.
+		vector<pair<uint64_t, UINT>> expected(count);
+		for (int i = 0; i < count; ++i)
+		{
+			expected[i] = { keys[i], values[i] };
+		}
+		stable_sort(expected.begin(), expected.end(), [](const pair<uint64_t, UINT>& a, const pair<uint64_t, UINT>& b)
+			{
+				return a.first < b.first;
+			});
+
+		DrawQueue::RadixSort(keys, values);
+
+		bool same = true;
+		for (int i = 0; i < count; ++i)
+		{
+			same = same && keys[i] == expected[i].first && values[i] == expected[i].second;
+		}
+		CHECK(same);
+	}
+}
+
+TEST(CompactSerial)
+{
+	CheckCompact(1000, 0.5f);
+}
+
+TEST(CompactBlocked)
+{
+	CheckCompact(LargeCount, 0.3f);
+}
+
+TEST(CompactNothingVisible)
+{
+	CheckCompact(LargeCount, 0.0f);
+}
+
+TEST(CompactEverythingVisible)
+{
+	CheckCompact(LargeCount, 1.0f);
+}
+
+TEST(CompactDropsEmptyDraws)
+{
+	Jobs();
+
+	IndirectDrawBuilder builder;
+	builder.AddDraw(6, 0, 0);
+	builder.AddInstance(0, false);
+	builder.AddInstance(1, false);
+	builder.AddDraw(12, 6, 4);
+	builder.AddDraw(18, 18, 8);
+	builder.AddInstance(2, true);
+	builder.AddInstance(3, false);
+	builder.AddInstance(4, true);
+	builder.Compact();
+
+	CHECK(builder.Records().size() == 1);
+	CHECK(builder.RecordDraws() == vector<UINT>({ 2 }));
+	CHECK(builder.Instances() == vector<UINT>({ 2, 4 }));
+	if (builder.Records().size() == 1)
+	{
+		CHECK(builder.Records()[0].FirstInstance == 0);
+		CHECK(builder.Records()[0].Draw.InstanceCount == 2);
+		CHECK(builder.Records()[0].Draw.IndexCountPerInstance == 18);
+	}
+}
+
+TEST(RadixSortSerialMatchesStableSort)
+{
+	CheckRadixSort(1000, ~0ull);
+}
+
+TEST(RadixSortBlockedMatchesStableSort)
+{
+	CheckRadixSort(LargeCount, ~0ull);
+}
+
+TEST(RadixSortKeepsEqualKeysInOrder)
+{
+	// Few distinct keys, spread over bytes that are skipped and bytes that are not.
+	CheckRadixSort(LargeCount, 0x0300000000000700ull);
+}
+
+TEST(SortSplitsDrawsBeyondThePsoIdRange)
+{
+	Jobs();
+
+	MeshGeometry geo;
+	Material mat;
+	mat.MatCBIndex = 0;
+
+	// More PSOs than the key has ids for, all drawing the same submesh. Only the addresses are compared.
+	const int psoCount = 300;
+	vector<unique_ptr<RenderItem>> ritems;
+	DrawQueue queue;
+	for (int i = 0; i < psoCount; ++i)
+	{
+		auto ri = make_unique<RenderItem>();
+		ri->Geo = &geo;
+		ri->Mat = &mat;
+		ri->ObjCBIndex = (UINT)i;
+		ri->IndexCount = 36;
+
+		queue.Add(0, reinterpret_cast<ID3D12PipelineState*>((uintptr_t)(i + 1) * 256), ri.get(), 1.0f);
+		ritems.push_back(move(ri));
+	}
+
+	queue.Sort();
+	CHECK(queue.DrawCount() == psoCount);
+}
+
+TEST(SubmitBindsEachStateOncePerRun)
+{
+	Jobs();
+
+	const int psoCount = 4;
+	const int geometryCount = 3;
+	const int submeshCount = 4;
+	const int itemCount = 1000;
+
+	// Declared before the geometries that reference them, so they outlive them.
+	vector<unique_ptr<FakeBuffer>> buffers;
+	vector<MeshGeometry> geometries(geometryCount);
+	for (int g = 0; g < geometryCount; ++g)
+	{
+		buffers.push_back(make_unique<FakeBuffer>(0x10000 * (g + 1)));
+		buffers.push_back(make_unique<FakeBuffer>(0x10000 * (g + 1) + 0x8000));
+		geometries[g].VertexBufferGPU = buffers[2 * g].get();
+		geometries[g].IndexBufferGPU = buffers[2 * g + 1].get();
+	}
+
+	vector<Material> materials(8);
+	for (int m = 0; m < (int)materials.size(); ++m)
+	{
+		materials[m].MatCBIndex = m;
+	}
+
+	// Only the addresses of the PSOs and the signature are compared.
+	ID3D12PipelineState* psos[psoCount];
+	for (int p = 0; p < psoCount; ++p)
+	{
+		psos[p] = reinterpret_cast<ID3D12PipelineState*>((uintptr_t)(p + 1) * 256);
+	}
+	auto signature = reinterpret_cast<ID3D12CommandSignature*>((uintptr_t)0x5000);
+	FakeBuffer arguments(0x900000);
+	const UINT64 argumentOffset = 3 * sizeof(IndirectDrawRecord);
+
+	mt19937 random(39);
+	uniform_int_distribution<int> pso(0, psoCount - 1);
+	uniform_int_distribution<int> geometry(0, geometryCount - 1);
+	uniform_int_distribution<int> submesh(0, submeshCount - 1);
+	uniform_int_distribution<int> material(0, (int)materials.size() - 1);
+	uniform_real_distribution<float> depth(1.0f, 500.0f);
+	bernoulli_distribution visible(0.8);
+
+	vector<unique_ptr<RenderItem>> ritems;
+	vector<int> itemPsos;
+	DrawQueue queue;
+	int visibleCount = 0;
+	for (int i = 0; i < itemCount; ++i)
+	{
+		int p = pso(random);
+		int s = submesh(random);
+
+		// The first two PSOs draw only the first geometry, so its binds carry over from one PSO run to the next.
+		auto ri = make_unique<RenderItem>();
+		ri->Geo = &geometries[p < 2 ? 0 : geometry(random)];
+		ri->Mat = &materials[material(random)];
+		ri->ObjCBIndex = (UINT)i;
+		ri->IndexCount = 36 + 6 * s;
+		ri->StartIndexLocation = 100 * s;
+		ri->Visible = visible(random);
+		visibleCount += ri->Visible ? 1 : 0;
+
+		itemPsos.push_back(p);
+		queue.Add(0, psos[p], ri.get(), depth(random));
+		ritems.push_back(move(ri));
+	}
+
+	queue.Sort();
+
+	RecordingCommandList cmdList;
+	DrawStats stats = queue.Submit(cmdList, signature, &arguments, argumentOffset);
+
+	const vector<IndirectDrawRecord>& records = queue.Records();
+	const vector<UINT>& instances = queue.InstanceIndices();
+
+	// Every record is drawn by exactly one call, in order, and every instance by one record.
+	bool contiguous = true;
+	bool statePerCall = true;
+	UINT nextRecord = 0;
+	for (const RecordingCommandList::IndirectCall& call : cmdList.Calls)
+	{
+		contiguous = contiguous && call.CommandCount > 0 &&
+			call.ArgumentOffset == argumentOffset + nextRecord * sizeof(IndirectDrawRecord) &&
+			call.Signature == signature && call.Arguments == &arguments;
+
+		// The instances of the call belong to items of the bound PSO and geometry.
+		for (UINT r = nextRecord; r < nextRecord + call.CommandCount && r < records.size(); ++r)
+		{
+			const IndirectDrawRecord& record = records[r];
+			for (UINT k = 0; k < record.Draw.InstanceCount; ++k)
+			{
+				UINT item = instances[record.FirstInstance + k];
+				const RenderItem* ri = ritems[item].get();
+				statePerCall = statePerCall && psos[itemPsos[item]] == call.Pso &&
+					ri->Geo->VertexBufferGPU->GetGPUVirtualAddress() == call.VertexBuffer &&
+					ri->Geo->IndexBufferGPU->GetGPUVirtualAddress() == call.IndexBuffer &&
+					ri->IndexCount == record.Draw.IndexCountPerInstance &&
+					ri->StartIndexLocation == record.Draw.StartIndexLocation;
+			}
+		}
+
+		nextRecord += call.CommandCount;
+	}
+	CHECK(contiguous);
+	CHECK(statePerCall);
+	CHECK(nextRecord == records.size());
+
+	// One call per run of the same PSO and geometry; with one layer every pair forms a single run.
+	vector<pair<int, const MeshGeometry*>> runs;
+	for (int i = 0; i < itemCount; ++i)
+	{
+		if (ritems[i]->Visible)
+		{
+			runs.push_back({ itemPsos[i], ritems[i]->Geo });
+		}
+	}
+	sort(runs.begin(), runs.end());
+	runs.erase(unique(runs.begin(), runs.end()), runs.end());
+	CHECK(cmdList.Calls.size() == runs.size());
+
+	// The PSO is bound once per PSO run, never twice in a row.
+	bool psoRunsDistinct = true;
+	for (size_t i = 0; i < cmdList.PsoBinds.size(); ++i)
+	{
+		for (size_t j = 0; j < i; ++j)
+		{
+			psoRunsDistinct = psoRunsDistinct && cmdList.PsoBinds[i] != cmdList.PsoBinds[j];
+		}
+	}
+	CHECK(psoRunsDistinct);
+	CHECK(cmdList.PsoBinds.size() == psoCount);
+
+	// Vertex and index buffer are bound as a pair, only where the geometry changes between calls.
+	UINT geometryChanges = 0;
+	for (size_t i = 0; i < cmdList.Calls.size(); ++i)
+	{
+		if (i == 0 || cmdList.Calls[i].VertexBuffer != cmdList.Calls[i - 1].VertexBuffer)
+		{
+			++geometryChanges;
+		}
+	}
+
+	UINT vertexBinds = 0;
+	bool paired = true;
+	for (size_t i = 0; i < cmdList.Commands.size(); ++i)
+	{
+		if (cmdList.Commands[i] == 'V')
+		{
+			++vertexBinds;
+			paired = paired && i + 1 < cmdList.Commands.size() && cmdList.Commands[i + 1] == 'I';
+		}
+	}
+	CHECK(paired);
+	CHECK(vertexBinds == geometryChanges);
+	CHECK(geometryChanges < cmdList.Calls.size());
+	CHECK(count(cmdList.Commands.begin(), cmdList.Commands.end(), 'T') == 1);
+
+	// Each call asks for a PSO, two buffers and a topology; whatever was not issued was saved.
+	const UINT binds = (UINT)(cmdList.Commands.size() - cmdList.Calls.size());
+	CHECK(stats.BindsIssued == binds);
+	CHECK(stats.BindsIssued == psoCount + 2 * geometryChanges + 1);
+	CHECK(stats.BindsSaved == 4 * (UINT)cmdList.Calls.size() - binds);
+	CHECK(stats.IndirectCalls == cmdList.Calls.size());
+	CHECK(stats.Draws == records.size());
+	CHECK(stats.Instances == (UINT)visibleCount);
+}
@@ -0,0 +1,127 @@
+#include "Test.h"
+#include "../Private/PrivateProject/HeightTileCache.h"
+#include <thread>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	const wchar_t* TileFile = L"HeightTileCacheTests.tiles";
+
+	// 8 x 8 tiles of 32 quads, one world unit apart.
+	const int Width = 257;
+	const int Depth = 257;
+	const int TileSize = 32;
+	const float OriginX = -128.0f;
+	const float OriginZ = -128.0f;
+
+	// (TileSize + 1)^2 heights and normals.
+	const size_t TileBytes = (TileSize + 1) * (TileSize + 1) * (sizeof(float) + sizeof(XMFLOAT3));
+
+	float HeightAt(float x, float z)
+	{
+		return 20.0f * sinf(0.05f * x) * cosf(0.07f * z);
+	}
+
+	void WriteTiles()
+	{
+		vector<float> heights(Width * Depth);
+		for (int i = 0; i < Depth; ++i)
+		{
+			for (int j = 0; j < Width; ++j)
+			{
+				heights[i * Width + j] = HeightAt(OriginX + j, OriginZ + i);
+			}
+		}
+
+		HeightTileCache::WriteTileFile(TileFile, heights, Width, Depth, 1.0f, OriginX, OriginZ, TileSize);
+	}
+
+	// Updates until every tile the cache asked for has been loaded and adopted, and returns the most
+	// memory that was resident after any of those updates. With the eye held still, Update only
+	// requests tiles that fit the budget, so this ends however fast the loader thread runs.
+	size_t Settle(HeightTileCache& cache, const XMFLOAT3& eyePos, float loadRadius)
+	{
+		cache.Update(eyePos, loadRadius);
+		size_t peakBytes = cache.ResidentBytes();
+
+		while (cache.PendingTileCount() > 0)
+		{
+			this_thread::yield();
+			cache.Update(eyePos, loadRadius);
+			peakBytes = max(peakBytes, cache.ResidentBytes());
+		}
+
+		return peakBytes;
+	}
+
+	float HeightError(HeightTileCache& cache, const XMFLOAT3& eyePos)
+	{
+		float height = 0.0f;
+		if (!cache.TryGetHeight(eyePos.x, eyePos.z, height))
+		{
+			return FLT_MAX;
+		}
+		return fabsf(height - HeightAt(eyePos.x, eyePos.z));
+	}
+}
+
+TEST(HeightTileCacheLoadsTheTilesInRange)
+{
+	WriteTiles();
+	{
+		HeightTileCache cache(TileFile, 64 * TileBytes);
+		CHECK(cache.IsOpen());
+		CHECK(cache.Header().TileCountX == 8 && cache.Header().TileCountZ == 8);
+
+		// The eye sits on a tile corner, so a radius under one tile covers the four tiles around it.
+		XMFLOAT3 eyePos(0.0f, 0.0f, 0.0f);
+		Settle(cache, eyePos, 16.0f);
+
+		CHECK(cache.ResidentTileCount() == 4);
+		CHECK(cache.ResidentBytes() == 4 * TileBytes);
+		CHECK(cache.FindTile(3, 3) != nullptr && cache.FindTile(4, 4) != nullptr);
+		CHECK(cache.FindTile(0, 0) == nullptr);
+
+		// Interpolating the quantized samples stays within a hundredth of the 40 unit range.
+		float error = 0.0f;
+		for (float x = -15.0f; x < 15.0f; x += 0.7f)
+		{
+			error = max(error, HeightError(cache, XMFLOAT3(x, 0.0f, 0.5f * x)));
+		}
+		CHECK(error < 0.4f);
+	}
+	_wremove(TileFile);
+}
+
+TEST(HeightTileCacheFlyThroughStaysWithinBudget)
+{
+	WriteTiles();
+	{
+		// A radius of 80 wants up to 30 tiles, far more than the budget holds.
+		const size_t budget = 6 * TileBytes;
+		const float loadRadius = 80.0f;
+		HeightTileCache cache(TileFile, budget);
+
+		// A diagonal pass over the whole map and back, settling at every step.
+		size_t peakBytes = 0;
+		const int steps = 120;
+		for (int step = 0; step < steps; ++step)
+		{
+			float t = (float)step / (steps - 1);
+			float s = 1.0f - fabsf(2.0f * t - 1.0f);
+			XMFLOAT3 eyePos(-120.0f + 240.0f * s, 30.0f, -100.0f + 200.0f * s);
+
+			peakBytes = max(peakBytes, Settle(cache, eyePos, loadRadius));
+		}
+		CHECK(peakBytes <= budget);
+
+		// Standing still, the cache fills the budget with the tiles nearest the eye.
+		XMFLOAT3 eyePos(0.0f, 30.0f, 0.0f);
+		Settle(cache, eyePos, loadRadius);
+		CHECK(cache.ResidentBytes() == budget);
+		CHECK(cache.FindTile(3, 3) != nullptr && cache.FindTile(3, 4) != nullptr);
+		CHECK(cache.FindTile(4, 3) != nullptr && cache.FindTile(4, 4) != nullptr);
+	}
+	_wremove(TileFile);
+}
@@ -0,0 +1,249 @@
+#include "Test.h"
+#include "../Private/PrivateProject/HeightfieldQuery.h"
+#include <random>
+#include <cmath>
+
+namespace
+{
+	// Sizes that are not powers of two, so the pyramid has partial nodes on its far edges.
+	const int Width = 75;
+	const int Depth = 53;
+	const float OriginX = -50.0f;
+	const float OriginZ = -30.0f;
+	const float Spacing = 1.5f;
+
+	vector<float> BuildHeights()
+	{
+		mt19937 random(31);
+		uniform_real_distribution<float> noise(-0.5f, 0.5f);
+
+		vector<float> heights(Width * Depth);
+		for (int i = 0; i < Depth; ++i)
+		{
+			for (int j = 0; j < Width; ++j)
+			{
+				float x = OriginX + j * Spacing;
+				float z = OriginZ + i * Spacing;
+				heights[i * Width + j] = 6.0f * sinf(0.11f * x) * cosf(0.07f * z) + noise(random);
+			}
+		}
+		return heights;
+	}
+
+	struct Double3
+	{
+		double X = 0.0;
+		double Y = 0.0;
+		double Z = 0.0;
+	};
+
+	Double3 operator-(const Double3& a, const Double3& b)
+	{
+		return { a.X - b.X, a.Y - b.Y, a.Z - b.Z };
+	}
+
+	Double3 Cross(const Double3& a, const Double3& b)
+	{
+		return { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X };
+	}
+
+	double Dot(const Double3& a, const Double3& b)
+	{
+		return a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+	}
+
+	// Moller-Trumbore in double precision. Returns the distance along the unit direction, or -1.
+	double IntersectTriangle(const Double3& origin, const Double3& dir, const Double3& a, const Double3& b, const Double3& c)
+	{
+		Double3 e1 = b - a;
+		Double3 e2 = c - a;
+		Double3 p = Cross(dir, e2);
+		double det = Dot(e1, p);
+		if (fabs(det) < 1e-12)
+		{
+			return -1.0;
+		}
+
+		Double3 s = origin - a;
+		double u = Dot(s, p) / det;
+		Double3 q = Cross(s, e1);
+		double v = Dot(dir, q) / det;
+		if (u < 0.0 || v < 0.0 || u + v > 1.0)
+		{
+			return -1.0;
+		}
+
+		return Dot(e2, q) / det;
+	}
+
+	// Tests every triangle of the grid, split the way HeightfieldQuery documents.
+	double BruteForceIntersect(const vector<float>& heights, const HeightfieldRay& ray)
+	{
+		Double3 origin = { ray.Origin.x, ray.Origin.y, ray.Origin.z };
+		Double3 dir = { ray.Direction.x, ray.Direction.y, ray.Direction.z };
+		double length = sqrt(Dot(dir, dir));
+		dir = { dir.X / length, dir.Y / length, dir.Z / length };
+
+		auto vertex = [&heights](int i, int j) -> Double3
+			{
+				return { OriginX + j * (double)Spacing, heights[i * Width + j], OriginZ + i * (double)Spacing };
+			};
+
+		double closest = -1.0;
+		for (int i = 0; i < Depth - 1; ++i)
+		{
+			for (int j = 0; j < Width - 1; ++j)
+			{
+				Double3 v00 = vertex(i, j);
+				Double3 v01 = vertex(i, j + 1);
+				Double3 v10 = vertex(i + 1, j);
+				Double3 v11 = vertex(i + 1, j + 1);
+
+				for (double t : { IntersectTriangle(origin, dir, v00, v10, v01), IntersectTriangle(origin, dir, v01, v10, v11) })
+				{
+					if (t >= 0.0 && t <= ray.MaxDistance && (closest < 0.0 || t < closest))
+					{
+						closest = t;
+					}
+				}
+			}
+		}
+		return closest;
+	}
+
+	vector<HeightfieldRay> BuildRays(int count)
+	{
+		mt19937 random(2000);
+		uniform_real_distribution<float> x(OriginX - 20.0f, OriginX + Width * Spacing + 20.0f);
+		uniform_real_distribution<float> z(OriginZ - 20.0f, OriginZ + Depth * Spacing + 20.0f);
+		uniform_real_distribution<float> y(-10.0f, 30.0f);
+		uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		uniform_real_distribution<float> maxDistance(5.0f, 150.0f);
+
+		vector<HeightfieldRay> rays(count);
+		for (int k = 0; k < count; ++k)
+		{
+			HeightfieldRay& ray = rays[k];
+			ray.Origin = XMFLOAT3(x(random), y(random), z(random));
+
+			// Mostly downwards, with grazing and upward rays mixed in, plus some straight down.
+			if (k % 10 == 0)
+			{
+				ray.Direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+			}
+			else
+			{
+				ray.Direction = XMFLOAT3(unit(random), unit(random) - 0.4f, unit(random));
+			}
+
+			if (k % 3 == 0)
+			{
+				ray.MaxDistance = maxDistance(random);
+			}
+		}
+		return rays;
+	}
+}
+
+TEST(HeightfieldQueryRaysMatchBruteForce)
+{
+	vector<float> heights = BuildHeights();
+	HeightfieldQuery query(heights, Width, Depth, OriginX, OriginZ, Spacing);
+
+	vector<HeightfieldRay> rays = BuildRays(2000);
+
+	int hits = 0;
+	bool sameHits = true;
+	bool sameDistances = true;
+	bool onSurface = true;
+	for (const HeightfieldRay& ray : rays)
+	{
+		double expected = BruteForceIntersect(heights, ray);
+
+		HeightfieldHit hit;
+		bool found = query.Intersect(ray, hit);
+
+		sameHits = sameHits && found == (expected >= 0.0);
+		if (found && expected >= 0.0)
+		{
+			++hits;
+			sameDistances = sameDistances && fabs(hit.Distance - expected) < 1e-3 * (1.0 + expected);
+			onSurface = onSurface && fabsf(hit.Position.y - query.HeightAt(hit.Position.x, hit.Position.z)) < 1e-3f;
+		}
+	}
+
+	CHECK(sameHits);
+	CHECK(sameDistances);
+	CHECK(onSurface);
+
+	// Both outcomes are well represented.
+	CHECK(hits > 250 && hits < 1750);
+}
+
+TEST(HeightfieldQueryBatchMatchesSingleRays)
+{
+	vector<float> heights = BuildHeights();
+	HeightfieldQuery query(heights, Width, Depth, OriginX, OriginZ, Spacing);
+
+	// Not a multiple of the batch size.
+	vector<HeightfieldRay> rays = BuildRays(1000);
+	vector<HeightfieldHit> hits(rays.size());
+	query.IntersectRays(rays.data(), rays.size(), hits.data());
+
+	bool same = true;
+	for (size_t k = 0; k < rays.size(); ++k)
+	{
+		HeightfieldHit hit;
+		query.Intersect(rays[k], hit);
+		same = same && hit.Hit == hits[k].Hit && hit.Distance == hits[k].Distance;
+	}
+	CHECK(same);
+}
+
+TEST(HeightfieldQueryHeightAtInterpolatesTheTriangles)
+{
+	vector<float> heights = BuildHeights();
+	HeightfieldQuery query(heights, Width, Depth, OriginX, OriginZ, Spacing);
+
+	// Grid samples are returned exactly.
+	bool samplesMatch = true;
+	for (int i = 0; i < Depth; i += 7)
+	{
+		for (int j = 0; j < Width; j += 5)
+		{
+			samplesMatch = samplesMatch && query.HeightAt(OriginX + j * Spacing, OriginZ + i * Spacing) == heights[i * Width + j];
+		}
+	}
+	CHECK(samplesMatch);
+
+	// Inside the grid a vertical ray from high above lands at HeightAt.
+	mt19937 random(95);
+	uniform_real_distribution<float> x(OriginX, OriginX + (Width - 1) * Spacing);
+	uniform_real_distribution<float> z(OriginZ, OriginZ + (Depth - 1) * Spacing);
+
+	bool raysAgree = true;
+	for (int k = 0; k < 500; ++k)
+	{
+		HeightfieldRay ray;
+		ray.Origin = XMFLOAT3(x(random), 100.0f, z(random));
+
+		double expected = BruteForceIntersect(heights, ray);
+		float height = query.HeightAt(ray.Origin.x, ray.Origin.z);
+		raysAgree = raysAgree && expected >= 0.0 && fabs(height - (100.0 - expected)) < 1e-3;
+	}
+	CHECK(raysAgree);
+
+	// Outside the grid the height is clamped to the nearest edge.
+	CHECK(query.HeightAt(OriginX - 10.0f, OriginZ) == heights[0]);
+	CHECK(query.HeightAt(OriginX + Width * Spacing + 10.0f, OriginZ + (Depth - 1) * Spacing + 10.0f) == heights[Width * Depth - 1]);
+
+	vector<XMFLOAT2> points = { XMFLOAT2(0.3f, 0.7f), XMFLOAT2(-20.0f, 12.5f), XMFLOAT2(40.0f, -29.0f) };
+	vector<float> batch(points.size());
+	query.HeightsAt(points.data(), points.size(), batch.data());
+	bool batchMatches = true;
+	for (size_t k = 0; k < points.size(); ++k)
+	{
+		batchMatches = batchMatches && batch[k] == query.HeightAt(points[k].x, points[k].y);
+	}
+	CHECK(batchMatches);
+}
@@ -0,0 +1,186 @@
+#include "Test.h"
+#include "../Chapter20/Shadows/JobSystem.h"
+#include <stdexcept>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	JobSystem& Jobs()
+	{
+		JobSystem& jobs = JobSystem::GetInstance();
+		if (jobs.WorkerCount() == 0)
+		{
+			jobs.Initialize(4);
+		}
+		return jobs;
+	}
+}
+
+TEST(ParallelForRethrowsOnTheCaller)
+{
+	JobSystem& jobs = Jobs();
+
+	bool caught = false;
+	try
+	{
+		jobs.ParallelFor(0, 100000, [](int i)
+			{
+				if (i == 77777)
+				{
+					throw runtime_error("ParallelFor");
+				}
+			}, 16);
+	}
+	catch (const runtime_error& e)
+	{
+		caught = string(e.what()) == "ParallelFor";
+	}
+	CHECK(caught);
+
+	// Every range retired, so the next call runs normally.
+	atomic<int> sum{ 0 };
+	jobs.ParallelFor(0, 1000, [&sum](int i) { sum += i; });
+	CHECK(sum == 999 * 1000 / 2);
+}
+
+TEST(WaitRethrowsTheFirstJobException)
+{
+	JobSystem& jobs = Jobs();
+
+	JobCounter counter;
+	atomic<int> ran{ 0 };
+	for (int i = 0; i < 8; ++i)
+	{
+		jobs.Submit([&ran, i]()
+			{
+				++ran;
+				if (i == 3)
+				{
+					throw runtime_error("Submit");
+				}
+			}, &counter);
+	}
+
+	bool caught = false;
+	try
+	{
+		jobs.Wait(counter);
+	}
+	catch (const runtime_error&)
+	{
+		caught = true;
+	}
+	CHECK(caught);
+	CHECK(ran == 8);
+	CHECK(counter.Count == 0);
+
+	// The error is handed out once; the counter can be reused.
+	jobs.Submit([&ran]() { ++ran; }, &counter);
+	jobs.Wait(counter);
+	CHECK(ran == 9);
+}
+
+namespace
+{
+	// Enough arithmetic per call that the optimizer keeps it and the scheduler is not all that is measured.
+	float Work(int i, int iterations)
+	{
+		float x = (float)i;
+		for (int k = 0; k < iterations; ++k)
+		{
+			x = sqrtf(x + 1.0f);
+		}
+		return x;
+	}
+
+	template<typename F>
+	double TimeRuns(int runs, F&& run)
+	{
+		run();
+
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < runs; ++i)
+		{
+			run();
+		}
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / runs;
+	}
+
+	vector<int> BenchmarkWorkerCounts()
+	{
+		int hardware = max(1, (int)thread::hardware_concurrency());
+
+		vector<int> counts = { 1, 2, 4 };
+		if (hardware > 4)
+		{
+			counts.push_back(hardware);
+		}
+		return counts;
+	}
+}
+
+BENCHMARK(JobSystemParallelFor)
+{
+	JobSystem& jobs = JobSystem::GetInstance();
+
+	const int count = 1 << 20;
+	vector<float> results(count);
+
+	for (int workers : BenchmarkWorkerCounts())
+	{
+		jobs.Shutdown();
+		jobs.Initialize(workers);
+
+		// Light items with a small grain stress the range splitting, heavy ones the scaling.
+		double light = TimeRuns(20, [&]()
+			{
+				jobs.ParallelFor(0, count, [&results](int i) { results[i] = Work(i, 1); }, 64);
+			});
+		double heavy = TimeRuns(5, [&]()
+			{
+				jobs.ParallelFor(0, count, [&results](int i) { results[i] = Work(i, 16); }, 64);
+			});
+
+		printf("  %d workers: light %.3f ms (%.1f M items/s), heavy %.3f ms (%.1f M items/s)\n", workers,
+			light, count / light / 1000.0, heavy, count / heavy / 1000.0);
+	}
+
+	// Later tests start from the default pool again.
+	jobs.Shutdown();
+}
+
+BENCHMARK(JobSystemTaskGraph)
+{
+	JobSystem& jobs = JobSystem::GetInstance();
+
+	// A frame shaped graph: one task fans out to independent branches of two tasks each, which all
+	// join in a last task.
+	const int branches = 64;
+	vector<float> results(2 * branches + 2);
+
+	TaskGraph graph;
+	int first = graph.AddTask("first", [&results]() { results[0] = Work(0, 2000); });
+	int last = graph.AddTask("last", [&results]() { results[1] = Work(1, 2000); });
+	for (int b = 0; b < branches; ++b)
+	{
+		int slot = 2 + 2 * b;
+		int a = graph.AddTask("a", [&results, slot]() { results[slot] = Work(slot, 2000); });
+		int c = graph.AddTask("b", [&results, slot]() { results[slot + 1] = Work(slot + 1, 2000); });
+		graph.Precede(first, a);
+		graph.Precede(a, c);
+		graph.Precede(c, last);
+	}
+
+	for (int workers : BenchmarkWorkerCounts())
+	{
+		jobs.Shutdown();
+		jobs.Initialize(workers);
+
+		double run = TimeRuns(50, [&]() { graph.Run(jobs); });
+
+		printf("  %d workers: %.3f ms per run (%.0f tasks/s)\n", workers, run, graph.TaskCount() / run * 1000.0);
+	}
+
+	jobs.Shutdown();
+}
@@ -0,0 +1,272 @@
+#include "Test.h"
+#include "../Chapter20/Shadows/MatrixKernels.h"
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Remainders of both the eight lane blocks and the pairs of StoreTransposed3x4.
+	const size_t Counts[] = { 0, 1, 2, 7, 8, 9, 13, 16, 35 };
+
+	// Matrices inside larger structs, at a stride that is not a multiple of 16 or 32 bytes.
+	struct Instance
+	{
+		XMFLOAT4X4 World;
+		float Padding[3];
+	};
+
+	XMMATRIX RandomRotation(mt19937& random)
+	{
+		uniform_real_distribution<float> angle(0.0f, XM_2PI);
+		return XMMatrixRotationRollPitchYaw(angle(random), angle(random), angle(random));
+	}
+
+	XMMATRIX RandomTranslation(mt19937& random)
+	{
+		uniform_real_distribution<float> offset(-100.0f, 100.0f);
+		return XMMatrixTranslation(offset(random), offset(random), offset(random));
+	}
+
+	vector<Instance> RandomInstances(size_t count, bool scaled, unsigned seed)
+	{
+		mt19937 random(seed);
+		uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+		vector<Instance> instances(count);
+		for (Instance& instance : instances)
+		{
+			XMMATRIX m = RandomRotation(random) * RandomTranslation(random);
+			if (scaled)
+			{
+				m = XMMatrixScaling(scale(random), scale(random), scale(random)) * m;
+			}
+			XMStoreFloat4x4(&instance.World, m);
+			instance.Padding[0] = instance.Padding[1] = instance.Padding[2] = -7.0f;
+		}
+		return instances;
+	}
+
+	// Largest difference, relative to the size of the expected element where that is above one.
+	float MaxError(CXMMATRIX a, CXMMATRIX b)
+	{
+		XMFLOAT4X4 x;
+		XMFLOAT4X4 y;
+		XMStoreFloat4x4(&x, a);
+		XMStoreFloat4x4(&y, b);
+
+		float error = 0.0f;
+		for (int j = 0; j < 16; ++j)
+		{
+			float expected = y.m[j / 4][j % 4];
+			error = max(error, fabsf(x.m[j / 4][j % 4] - expected) / max(1.0f, fabsf(expected)));
+		}
+		return error;
+	}
+
+	// Runs the checks once on the AVX path, where the CPU has it, and once on the DirectXMath path.
+	template<typename Func>
+	void ForBothPaths(Func func)
+	{
+		for (bool avx : { true, false })
+		{
+			MatrixKernels::SetAvxEnabled(avx);
+			func();
+		}
+		MatrixKernels::SetAvxEnabled(true);
+	}
+
+	typedef void (*BatchedInverse)(const XMFLOAT4X4*, size_t, XMFLOAT4X4*, size_t, size_t);
+
+	void CheckBatchedInverse(BatchedInverse inverse, bool scaled)
+	{
+		ForBothPaths([inverse, scaled]()
+			{
+				for (size_t count : Counts)
+				{
+					vector<Instance> src = RandomInstances(count, scaled, (unsigned)count);
+					vector<Instance> dst = RandomInstances(count + 1, false, 99);
+					const XMFLOAT4X4 untouched = dst[count].World;
+
+					inverse(&src.data()->World, sizeof(Instance), &dst.data()->World, sizeof(Instance), count);
+
+					float error = 0.0f;
+					bool paddingKept = true;
+					for (size_t i = 0; i < count; ++i)
+					{
+						XMMATRIX expected = XMMatrixInverse(nullptr, XMLoadFloat4x4(&src[i].World));
+						error = max(error, MaxError(XMLoadFloat4x4(&dst[i].World), expected));
+						paddingKept = paddingKept && dst[i].Padding[0] == -7.0f && dst[i].Padding[2] == -7.0f;
+					}
+					CHECK(error < 1e-3f);
+					CHECK(paddingKept);
+					CHECK(MaxError(XMLoadFloat4x4(&dst[count].World), XMLoadFloat4x4(&untouched)) == 0.0f);
+				}
+			});
+	}
+
+	// Best of a few runs, in nanoseconds per matrix.
+	template<typename Func>
+	double TimePerMatrix(size_t count, Func func)
+	{
+		double best = 1e30;
+		for (int run = 0; run < 5; ++run)
+		{
+			auto start = chrono::steady_clock::now();
+			func();
+			best = min(best, chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+		}
+		return best / count;
+	}
+}
+
+TEST(MatrixKernelsStoreTransposed3x4)
+{
+	ForBothPaths([]()
+		{
+			for (size_t count : Counts)
+			{
+				vector<Instance> src = RandomInstances(count + 3, true, 3);
+
+				// Out of order with repeats, like the dirty list of a frame.
+				vector<int> indices(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					indices[i] = (int)((i * 5 + 2) % (count + 3));
+				}
+
+				// Three rows per output and a fourth one that must stay untouched.
+				for (const int* order : { (const int*)nullptr, (const int*)indices.data() })
+				{
+					vector<XMFLOAT4> dst(4 * count, XMFLOAT4(-1.0f, -1.0f, -1.0f, -1.0f));
+					MatrixKernels::StoreTransposed3x4(&src.data()->World, sizeof(Instance), order,
+						dst.data(), 4 * sizeof(XMFLOAT4), count);
+
+					bool same = true;
+					for (size_t i = 0; i < count; ++i)
+					{
+						const XMFLOAT4X4& m = src[order != nullptr ? order[i] : i].World;
+						for (int row = 0; row < 3; ++row)
+						{
+							const XMFLOAT4& out = dst[4 * i + row];
+							same = same && out.x == m.m[0][row] && out.y == m.m[1][row] && out.z == m.m[2][row] && out.w == m.m[3][row];
+						}
+						const XMFLOAT4& guard = dst[4 * i + 3];
+						same = same && guard.x == -1.0f && guard.w == -1.0f;
+					}
+					CHECK(same);
+				}
+			}
+		});
+}
+
+TEST(MatrixKernelsInverseAffine)
+{
+	CheckBatchedInverse(MatrixKernels::InverseAffine, true);
+}
+
+TEST(MatrixKernelsInverseRigid)
+{
+	CheckBatchedInverse(MatrixKernels::InverseRigid, false);
+
+	vector<Instance> views = RandomInstances(16, false, 5);
+	float error = 0.0f;
+	for (const Instance& view : views)
+	{
+		XMMATRIX m = XMLoadFloat4x4(&view.World);
+		error = max(error, MaxError(MatrixKernels::InverseRigid(m), XMMatrixInverse(nullptr, m)));
+	}
+	CHECK(error < 1e-3f);
+}
+
+TEST(MatrixKernelsInverseProjection)
+{
+	// Reversed depth and off center frusta included.
+	const XMMATRIX projections[] =
+	{
+		XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f),
+		XMMatrixPerspectiveFovLH(0.4f * XM_PI, 1.0f, 1000.0f, 0.1f),
+		XMMatrixPerspectiveOffCenterLH(-0.3f, 0.7f, -0.2f, 0.4f, 0.5f, 500.0f),
+		XMMatrixOrthographicLH(40.0f, 30.0f, 1.0f, 200.0f),
+		XMMatrixOrthographicOffCenterLH(-10.0f, 30.0f, -5.0f, 15.0f, -20.0f, 80.0f),
+	};
+
+	for (const XMMATRIX& proj : projections)
+	{
+		CHECK(MaxError(MatrixKernels::InverseProjection(proj), XMMatrixInverse(nullptr, proj)) < 1e-3f);
+	}
+}
+
+TEST(MatrixKernelsInverseViewProj)
+{
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(30.0f, 20.0f, -45.0f, 1.0f), XMVectorSet(2.0f, 0.0f, 5.0f, 1.0f),
+		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f);
+
+	XMMATRIX invView;
+	XMMATRIX invProj;
+	XMMATRIX invViewProj;
+	MatrixKernels::InverseViewProj(view, proj, invView, invProj, invViewProj);
+
+	CHECK(MaxError(invView, XMMatrixInverse(nullptr, view)) < 1e-3f);
+	CHECK(MaxError(invProj, XMMatrixInverse(nullptr, proj)) < 1e-3f);
+	CHECK(MaxError(invViewProj, XMMatrixInverse(nullptr, XMMatrixMultiply(view, proj))) < 1e-3f);
+}
+
+BENCHMARK(MatrixKernels)
+{
+	const size_t count = 4096;
+	const size_t stride = sizeof(XMFLOAT4X4);
+
+	vector<XMFLOAT4X4> rigid(count);
+	vector<XMFLOAT4X4> affine(count);
+	vector<Instance> instances = RandomInstances(count, false, 1);
+	for (size_t i = 0; i < count; ++i)
+	{
+		rigid[i] = instances[i].World;
+	}
+	instances = RandomInstances(count, true, 2);
+	for (size_t i = 0; i < count; ++i)
+	{
+		affine[i] = instances[i].World;
+	}
+
+	vector<XMFLOAT4X4> result(count);
+	vector<int> indices(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		indices[i] = (int)((i * 7) % count);
+	}
+
+	auto directXMathInverse = [&result](const vector<XMFLOAT4X4>& src)
+		{
+			for (size_t i = 0; i < src.size(); ++i)
+			{
+				XMStoreFloat4x4(&result[i], XMMatrixInverse(nullptr, XMLoadFloat4x4(&src[i])));
+			}
+		};
+
+	printf("  %s, ns per matrix (kernel, DirectXMath):\n", MatrixKernels::HasAvx() ? "AVX" : "no AVX");
+
+	double kernel = TimePerMatrix(count, [&]()
+		{
+			MatrixKernels::StoreTransposed3x4(affine.data(), stride, indices.data(), (XMFLOAT4*)result.data(), stride, count);
+		});
+	double directXMath = TimePerMatrix(count, [&]()
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				XMStoreFloat4x4(&result[i], XMMatrixTranspose(XMLoadFloat4x4(&affine[indices[i]])));
+			}
+		});
+	printf("  StoreTransposed3x4: %.2f, %.2f\n", kernel, directXMath);
+
+	kernel = TimePerMatrix(count, [&]() { MatrixKernels::InverseAffine(affine.data(), stride, result.data(), stride, count); });
+	directXMath = TimePerMatrix(count, [&]() { directXMathInverse(affine); });
+	printf("  InverseAffine: %.2f, %.2f\n", kernel, directXMath);
+
+	kernel = TimePerMatrix(count, [&]() { MatrixKernels::InverseRigid(rigid.data(), stride, result.data(), stride, count); });
+	directXMath = TimePerMatrix(count, [&]() { directXMathInverse(rigid); });
+	printf("  InverseRigid: %.2f, %.2f\n", kernel, directXMath);
+}
@@ -0,0 +1,45 @@
+#include "Test.h"
+#include "../Private/PrivateProject/OceanWaves.h"
+#include <chrono>
+
+namespace
+{
+	void TimeOcean(int n, OceanSpectrum spectrum)
+	{
+		OceanSettings settings;
+		settings.Spectrum = spectrum;
+
+		OceanWaves ocean(n, 250.0f, settings);
+
+		// The first updates include page faults on the field buffers.
+		for (int i = 0; i < 3; ++i)
+		{
+			ocean.Update(1.0f / 60.0f);
+		}
+
+		const int frames = 30;
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < frames; ++i)
+		{
+			ocean.Update(1.0f / 60.0f);
+		}
+		double update = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / frames;
+
+		// Position, normal and texture coordinates, 16 byte aligned like an upload buffer.
+		vector<__m128> vertices((size_t)ocean.VertexCount() * 2);
+		start = chrono::steady_clock::now();
+		ocean.StreamVertices(vertices.data(), 0);
+		double stream = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		printf("  %dx%d %s: Update %.3f ms, StreamVertices %.3f ms\n", n, n,
+			spectrum == OceanSpectrum::Phillips ? "Phillips" : "JONSWAP", update, stream);
+	}
+}
+
+BENCHMARK(OceanUpdate)
+{
+	TimeOcean(256, OceanSpectrum::Phillips);
+	TimeOcean(256, OceanSpectrum::Jonswap);
+	TimeOcean(512, OceanSpectrum::Phillips);
+	TimeOcean(512, OceanSpectrum::Jonswap);
+}
@@ -0,0 +1,199 @@
+#include "Test.h"
+#include "../Chapter20/Shadows/PipelineStateHash.h"
+#include <vector>
+#include <string>
+#include <cstring>
+#include <climits>
+
+namespace
+{
+	// What a description points to. Every PipelineInputs owns its own copies, so two of them with the
+	// same contents give descriptions with equal values behind different pointers.
+	struct PipelineInputs
+	{
+		vector<unsigned char> VS = vector<unsigned char>(64, 0x11);
+		vector<unsigned char> PS = vector<unsigned char>(96, 0x22);
+		vector<string> Semantics = { "POSITION", "NORMAL", "TEXCOORD" };
+		vector<D3D12_INPUT_ELEMENT_DESC> Elements;
+		DXGI_FORMAT RtvFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+		void BuildElements()
+		{
+			const DXGI_FORMAT formats[] = { DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R32G32_FLOAT };
+			const UINT offsets[] = { 0, 12, 24 };
+
+			Elements.resize(Semantics.size());
+			for (size_t i = 0; i < Semantics.size(); ++i)
+			{
+				Elements[i].SemanticName = Semantics[i].c_str();
+				Elements[i].SemanticIndex = 0;
+				Elements[i].Format = formats[i];
+				Elements[i].InputSlot = 0;
+				Elements[i].AlignedByteOffset = offsets[i];
+				Elements[i].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+				Elements[i].InstanceDataStepRate = 0;
+			}
+		}
+	};
+
+	// Fills every member one at a time into memory set to fill, so the padding between members keeps
+	// whatever fill left there. Copying a whole struct would copy its padding too.
+	void BuildDesc(unsigned char fill, PipelineInputs& inputs, D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		inputs.BuildElements();
+		memset(&desc, fill, sizeof(desc));
+
+		// Neither is part of the hash: the root signature is hashed by the caller and CachedPSO is a cache.
+		desc.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(&inputs);
+		desc.CachedPSO.pCachedBlob = &inputs;
+		desc.CachedPSO.CachedBlobSizeInBytes = sizeof(inputs);
+
+		desc.VS.pShaderBytecode = inputs.VS.data();
+		desc.VS.BytecodeLength = inputs.VS.size();
+		desc.PS.pShaderBytecode = inputs.PS.data();
+		desc.PS.BytecodeLength = inputs.PS.size();
+		for (D3D12_SHADER_BYTECODE* shader : { &desc.DS, &desc.HS, &desc.GS })
+		{
+			shader->pShaderBytecode = nullptr;
+			shader->BytecodeLength = 0;
+		}
+
+		desc.StreamOutput.pSODeclaration = nullptr;
+		desc.StreamOutput.NumEntries = 0;
+		desc.StreamOutput.pBufferStrides = nullptr;
+		desc.StreamOutput.NumStrides = 0;
+		desc.StreamOutput.RasterizedStream = 0;
+
+		desc.BlendState.AlphaToCoverageEnable = false;
+		desc.BlendState.IndependentBlendEnable = false;
+		for (D3D12_RENDER_TARGET_BLEND_DESC& rt : desc.BlendState.RenderTarget)
+		{
+			rt.BlendEnable = false;
+			rt.LogicOpEnable = false;
+			rt.SrcBlend = D3D12_BLEND_ONE;
+			rt.DestBlend = D3D12_BLEND_ZERO;
+			rt.BlendOp = D3D12_BLEND_OP_ADD;
+			rt.SrcBlendAlpha = D3D12_BLEND_ONE;
+			rt.DestBlendAlpha = D3D12_BLEND_ZERO;
+			rt.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+			rt.LogicOp = D3D12_LOGIC_OP_NOOP;
+			rt.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+		}
+		desc.SampleMask = UINT_MAX;
+
+		desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+		desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+		desc.RasterizerState.FrontCounterClockwise = false;
+		desc.RasterizerState.DepthBias = 0;
+		desc.RasterizerState.DepthBiasClamp = 0.0f;
+		desc.RasterizerState.SlopeScaledDepthBias = 0.0f;
+		desc.RasterizerState.DepthClipEnable = true;
+		desc.RasterizerState.MultisampleEnable = false;
+		desc.RasterizerState.AntialiasedLineEnable = false;
+		desc.RasterizerState.ForcedSampleCount = 0;
+		desc.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+
+		desc.DepthStencilState.DepthEnable = true;
+		desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+		desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+		desc.DepthStencilState.StencilEnable = false;
+		desc.DepthStencilState.StencilReadMask = 0xff;
+		desc.DepthStencilState.StencilWriteMask = 0xff;
+		for (D3D12_DEPTH_STENCILOP_DESC* op : { &desc.DepthStencilState.FrontFace, &desc.DepthStencilState.BackFace })
+		{
+			op->StencilFailOp = D3D12_STENCIL_OP_KEEP;
+			op->StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+			op->StencilPassOp = D3D12_STENCIL_OP_KEEP;
+			op->StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+		}
+
+		desc.InputLayout.pInputElementDescs = inputs.Elements.data();
+		desc.InputLayout.NumElements = (UINT)inputs.Elements.size();
+		desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+		desc.NumRenderTargets = 1;
+		for (DXGI_FORMAT& format : desc.RTVFormats)
+		{
+			format = DXGI_FORMAT_UNKNOWN;
+		}
+		desc.RTVFormats[0] = inputs.RtvFormat;
+		desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.NodeMask = 0;
+		desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+	}
+
+	uint64_t HashOf(PipelineInputs& inputs, unsigned char fill = 0, uint64_t rootSignatureHash = 7)
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+		BuildDesc(fill, inputs, desc);
+		return HashPipelineState(desc, rootSignatureHash);
+	}
+}
+
+TEST(HashBytesIsFnv1a)
+{
+	// Reference values of 64 bit FNV-1a; the shader and pipeline caches both key files on it.
+	CHECK(HashBytes("", 0) == 0xcbf29ce484222325ull);
+	CHECK(HashBytes("a", 1) == 0xaf63dc4c8601ec8cull);
+	CHECK(HashBytes("foobar", 6) == 0x85944171f73967e8ull);
+
+	// Continuing from a hash is the same as hashing the joined bytes.
+	CHECK(HashBytes("bar", 3, HashBytes("foo", 3)) == HashBytes("foobar", 6));
+}
+
+TEST(PipelineHashFollowsPointers)
+{
+	// Equal bytecode, semantics and layouts at different addresses, with different root signature
+	// and cached blob pointers.
+	PipelineInputs a;
+	PipelineInputs b;
+	CHECK(a.VS.data() != b.VS.data());
+	CHECK(a.Semantics[0].c_str() != b.Semantics[0].c_str());
+	CHECK(HashOf(a) == HashOf(b));
+}
+
+TEST(PipelineHashIgnoresPadding)
+{
+	PipelineInputs inputs;
+	CHECK(HashOf(inputs, 0x00) == HashOf(inputs, 0xcd));
+	CHECK(HashOf(inputs, 0x00) == HashOf(inputs, 0xff));
+}
+
+TEST(PipelineHashSeesEveryInput)
+{
+	PipelineInputs base;
+	const uint64_t baseHash = HashOf(base);
+
+	PipelineInputs rtv;
+	rtv.RtvFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	CHECK(HashOf(rtv) != baseHash);
+
+	// One byte in the middle of the pixel shader.
+	PipelineInputs shaderByte;
+	shaderByte.PS[40] ^= 1;
+	CHECK(HashOf(shaderByte) != baseHash);
+
+	// Same bytes, one longer.
+	PipelineInputs shaderLength;
+	shaderLength.VS.push_back(0x11);
+	CHECK(HashOf(shaderLength) != baseHash);
+
+	PipelineInputs semantic;
+	semantic.Semantics[2] = "TEXCOORE";
+	CHECK(HashOf(semantic) != baseHash);
+
+	PipelineInputs element;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+	BuildDesc(0, element, desc);
+	element.Elements[1].AlignedByteOffset = 16;
+	CHECK(HashPipelineState(desc, 7) != baseHash);
+
+	PipelineInputs fewerElements;
+	fewerElements.Semantics.pop_back();
+	CHECK(HashOf(fewerElements) != baseHash);
+
+	CHECK(HashOf(base, 0, 8) != baseHash);
+}
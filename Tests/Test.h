@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <cstdio>
+
+using namespace std;
+
+// A minimal registry: TEST functions run by default, BENCHMARK functions only with --benchmark.
+// CHECK reports a failure and carries on, so one run lists every broken expectation.
+struct TestCase
+{
+	const char* Name = nullptr;
+	void (*Func)() = nullptr;
+	bool Benchmark = false;
+};
+
+vector<TestCase>& TestCases();
+void ReportFailure(const char* file, int line, const char* expression);
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*func)(), bool benchmark)
+	{
+		TestCases().push_back({ name, func, benchmark });
+	}
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistrar name##Registrar(#name, name, false); \
+	static void name()
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static TestRegistrar name##Registrar(#name, name, true); \
+	static void name()
+
+#define CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			ReportFailure(__FILE__, __LINE__, #expression); \
+		} \
+	} while (false)
@@ -0,0 +1,62 @@
+#include "Test.h"
+#include <cstring>
+
+namespace
+{
+	int gFailures = 0;
+}
+
+vector<TestCase>& TestCases()
+{
+	static vector<TestCase> cases;
+	return cases;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	++gFailures;
+}
+
+// Tests.exe [--benchmark] [name]: runs the tests, or the benchmarks, whose name contains name.
+int main(int argc, char* argv[])
+{
+	bool benchmark = false;
+	const char* filter = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			benchmark = true;
+		}
+		else
+		{
+			filter = argv[i];
+		}
+	}
+
+	int run = 0;
+	int failed = 0;
+	for (const TestCase& test : TestCases())
+	{
+		if (test.Benchmark != benchmark || (filter != nullptr && strstr(test.Name, filter) == nullptr))
+		{
+			continue;
+		}
+
+		printf("%s\n", test.Name);
+		fflush(stdout);
+
+		const int failuresBefore = gFailures;
+		test.Func();
+
+		++run;
+		if (gFailures != failuresBefore)
+		{
+			++failed;
+		}
+	}
+
+	printf("%d run, %d failed\n", run, failed);
+	return failed == 0 ? 0 : 1;
+}
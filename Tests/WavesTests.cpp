@@ -0,0 +1,129 @@
+#include "Test.h"
+#include "../Private/PrivateProject/Waves.h"
+#include <random>
+#include <limits>
+#include <cmath>
+
+namespace
+{
+	// Odd sizes, so the last batch of four columns and the last tile are partial.
+	const int Rows = 150;
+	const int Cols = 203;
+	const float SpatialStep = 0.5f;
+
+	float KernelWeight(const WaveImpulse& impulse, double distSq)
+	{
+		double radius = impulse.Radius;
+		if (impulse.Kernel == WaveKernel::Gaussian)
+		{
+			double sigma = radius / 3.0;
+			return (float)(impulse.Magnitude * exp(-distSq / (2.0 * sigma * sigma)));
+		}
+		return (float)(impulse.Magnitude * (0.5 * cos(sqrt(distSq) * XM_PI / radius) + 0.5));
+	}
+}
+
+TEST(WavesImpulsesMatchScalarSum)
+{
+	Waves waves(Rows, Cols, SpatialStep, 0.03f, 4.0f, 0.2f);
+
+	// Centers reach past the edges of the grid, so some impulses are only partly inside.
+	mt19937 random(28);
+	uniform_real_distribution<float> x(-60.0f, 60.0f);
+	uniform_real_distribution<float> z(-45.0f, 45.0f);
+	uniform_real_distribution<float> radius(0.5f, 8.0f);
+	uniform_real_distribution<float> magnitude(-1.0f, 1.0f);
+
+	vector<WaveImpulse> impulses(500);
+	for (int k = 0; k < (int)impulses.size(); ++k)
+	{
+		impulses[k].Position = XMFLOAT3(x(random), 0.0f, z(random));
+		impulses[k].Radius = radius(random);
+		impulses[k].Magnitude = magnitude(random);
+		impulses[k].Kernel = k % 2 == 0 ? WaveKernel::Gaussian : WaveKernel::Cosine;
+	}
+
+	waves.Disturb(impulses);
+
+	// Cells within rounding of an impulse's radius may land on either side of it, so their weight
+	// is allowed as slack instead of being added to the expected height.
+	vector<float> expected(Rows * Cols, 0.0f);
+	vector<float> slack(Rows * Cols, 0.0f);
+	for (const WaveImpulse& impulse : impulses)
+	{
+		double radiusSq = (double)impulse.Radius * impulse.Radius;
+		for (int i = 1; i < Rows - 1; ++i)
+		{
+			for (int j = 1; j < Cols - 1; ++j)
+			{
+				const XMFLOAT3& p = waves.Position(i * Cols + j);
+				double dx = p.x - impulse.Position.x;
+				double dz = p.z - impulse.Position.z;
+				double distSq = dx * dx + dz * dz;
+
+				if (fabs(distSq - radiusSq) < 1e-3 * radiusSq)
+				{
+					slack[i * Cols + j] += fabsf(KernelWeight(impulse, distSq));
+				}
+				else if (distSq < radiusSq)
+				{
+					expected[i * Cols + j] += KernelWeight(impulse, distSq);
+				}
+			}
+		}
+	}
+
+	bool bordersStill = true;
+	bool interiorMatches = true;
+	for (int i = 0; i < Rows; ++i)
+	{
+		for (int j = 0; j < Cols; ++j)
+		{
+			float height = waves.Position(i * Cols + j).y;
+			if (i == 0 || j == 0 || i == Rows - 1 || j == Cols - 1)
+			{
+				bordersStill = bordersStill && height == 0.0f;
+			}
+			else
+			{
+				float error = fabsf(height - expected[i * Cols + j]);
+				interiorMatches = interiorMatches && error <= 1e-3f + slack[i * Cols + j];
+			}
+		}
+	}
+	CHECK(bordersStill);
+	CHECK(interiorMatches);
+}
+
+TEST(WavesIgnoresImpulsesItCannotPlace)
+{
+	Waves waves(Rows, Cols, SpatialStep, 0.03f, 4.0f, 0.2f);
+
+	const float nan = numeric_limits<float>::quiet_NaN();
+	const float infinity = numeric_limits<float>::infinity();
+
+	vector<WaveImpulse> impulses(8);
+	impulses[0].Position = XMFLOAT3(nan, 0.0f, 0.0f);
+	impulses[1].Position = XMFLOAT3(0.0f, 0.0f, -infinity);
+	impulses[2].Position = XMFLOAT3(1e30f, 0.0f, 0.0f);
+	impulses[3].Position = XMFLOAT3(0.0f, 0.0f, -1e30f);
+	impulses[4].Radius = nan;
+	impulses[5].Radius = infinity;
+	impulses[6].Radius = 0.0f;
+	impulses[7].Radius = -2.0f;
+	for (WaveImpulse& impulse : impulses)
+	{
+		impulse.Magnitude = 1.0f;
+	}
+
+	uint64_t version = waves.Version();
+	waves.Disturb(impulses);
+
+	bool still = true;
+	for (int k = 0; k < waves.VertexCount(); ++k)
+	{
+		still = still && waves.Position(k).y == 0.0f;
+	}
+	CHECK(still);
+	CHECK(waves.Version() == version);
+}